@@ -36,6 +36,10 @@
 #define LCD_WRAPPER_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include "lcd_stats.h"
+#include "lcd_timing.h"
+#include "lcd_wait.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,17 +47,40 @@ extern "C" {
 
 typedef struct LCD LCD;
 
+// modes for LCD_printRows, same values as in lcd.hpp
+#ifndef LCD_PRINT_WRAP
+#define LCD_PRINT_WRAP 0x00
+#define LCD_PRINT_CLIP 0x01
+#define LCD_PRINT_ELLIPSIS 0x02
+#endif
+
+// LCD objects are created in static storage, no heap is used. This is the number of
+// displays that can exist at the same time, it only matters when compiling LCD_wrapper.cpp.
+#ifndef LCD_MAX_INSTANCES
+#define LCD_MAX_INSTANCES 2
+#endif
+
 /**
  * @brief Creates an instance of the LCD object.
  *
+ * The object is constructed in a static pool of LCD_MAX_INSTANCES objects.
+ * Creating and destroying displays is not thread safe.
+ *
  * @param portdata Pointer to the GPIO port for data pins.
  * @param portctrlRW Pointer to the GPIO port for RW control pin.
  * @param portctrlEN Pointer to the GPIO port for EN control pin.
  * @param portctrlRS Pointer to the GPIO port for RS control pin.
- * @return Pointer to the created LCD object.
+ * @return Pointer to the created LCD object, or NULL if the pool is exhausted.
  */
 LCD* LCD_create(void* portdata, void* portctrlRW, void* portctrlEN, void* portctrlRS);
 
+/**
+ * @brief Destroys an LCD object created by LCD_create, making its storage available again.
+ *
+ * @param lcd Pointer to the LCD object. NULL is ignored.
+ */
+void LCD_destroy(LCD* lcd);
+
 /**
  * @brief Initializes the control pins of the LCD.
  *
@@ -64,6 +91,18 @@ LCD* LCD_create(void* portdata, void* portctrlRW, void* portctrlEN, void* portct
  */
 void LCD_initCtrlPins(LCD* lcd, uint16_t ctrlRW, uint16_t ctrlEN, uint16_t ctrlRS);
 
+/**
+ * @brief Sets the enable line of the second controller of a 40x4 panel.
+ *
+ * Call before LCD_Begin. Rows 0-1 are driven through the first enable line and
+ * rows 2-3 through this one.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param portctrlEN2 Pointer to the GPIO port for the second EN control pin.
+ * @param ctrlEN2 GPIO pin number for the second EN control pin.
+ */
+void LCD_initSecondEnable(LCD* lcd, void* portctrlEN2, uint16_t ctrlEN2);
+
 /**
  * @brief Initializes the data pins of the LCD.
  *
@@ -98,6 +137,27 @@ void LCD_print(LCD* lcd, const char* message);
 
 int LCD_printFormatted(LCD* lcd, const char* format, ...);
 
+/**
+ * @brief Prints the given message within the rows of the LCD.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param message The message to be printed.
+ * @param mode LCD_PRINT_WRAP (0), LCD_PRINT_CLIP (1) or LCD_PRINT_ELLIPSIS (2).
+ * @return The number of characters printed.
+ */
+int LCD_printRows(LCD* lcd, const char* message, int mode);
+
+/**
+ * @brief Writes a whole screen of character codes, cols * rows bytes row by row.
+ *
+ * On 40x4 panels both controllers are written in turn, at about twice the speed.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param cells The character codes.
+ * @return The number of characters written.
+ */
+int LCD_writeFrame(LCD* lcd, const uint8_t* cells);
+
 /**
  * @brief Outputs a character to the LCD display.
  *
@@ -140,6 +200,16 @@ void LCD_Begin(LCD* lcd, int cols, int rows);
  */
 void LCD_createChar(LCD* lcd, uint8_t location, uint8_t charmap[]);
 
+/**
+ * @brief Creates several custom characters in consecutive CGRAM locations.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param first The CGRAM location of the first character (0-7).
+ * @param charmaps The patterns, 8 bytes per character.
+ * @param count The number of characters.
+ */
+void LCD_createChars(LCD* lcd, uint8_t first, const uint8_t charmaps[], uint8_t count);
+
 /**
  * @brief Disables autoscroll on the LCD.
  *
@@ -224,6 +294,113 @@ void LCD_clear(LCD* lcd);
  */
 void LCD_home(LCD* lcd);
 
+/**
+ * @brief Enables double buffered drawing in the hidden part of DDRAM.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @return 1 if page flipping is active, 0 if the display is too wide for two pages.
+ */
+int LCD_beginPageFlip(LCD* lcd);
+
+/**
+ * @brief Disables double buffered drawing and shows page 0 again.
+ *
+ * @param lcd Pointer to the LCD object.
+ */
+void LCD_endPageFlip(LCD* lcd);
+
+/**
+ * @brief Brings the page drawn since the last flip into view.
+ *
+ * @param lcd Pointer to the LCD object.
+ */
+void LCD_flipPage(LCD* lcd);
+
+/**
+ * @brief Copies the performance counters of the LCD.
+ *
+ * The counters are only maintained when the library is built with LCD_STATS set to 1,
+ * otherwise all counters read as zero.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param stats Receives the counters.
+ */
+void LCD_getStats(LCD* lcd, LCD_Stats* stats);
+
+/**
+ * @brief Sets all performance counters of the LCD to zero.
+ *
+ * @param lcd Pointer to the LCD object.
+ */
+void LCD_resetStats(LCD* lcd);
+
+/**
+ * @brief Sleeps the core through the waits for the controller, see lcd_wait.h.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param sleep The function that sleeps the core, or NULL to spin in every wait.
+ * @param context Passed to the function.
+ * @param min_sleep_us Waits shorter than this are spun, 0 for LCD_SLEEP_MIN_US.
+ */
+void LCD_setWaitStrategy(LCD* lcd, LCD_SleepFunc sleep, void* context, uint32_t min_sleep_us);
+
+/**
+ * @brief Copies the time the LCD spent sleeping and spinning in waits.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param stats Receives the counters.
+ */
+void LCD_getWaitStats(LCD* lcd, LCD_WaitStats* stats);
+
+/**
+ * @brief Measures the execution times of the controller with the busy flag.
+ *
+ * Call right after LCD_Begin. Needs the RW pin connected.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param margin_percent Safety margin added to the measured times.
+ * @return 1 if the measured profile is in use, 0 if the busy flag could not be read.
+ */
+int LCD_calibrate(LCD* lcd, uint8_t margin_percent);
+
+/**
+ * @brief Copies the timing profile in use, for example to store it for later boots.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param timing Receives the profile.
+ */
+void LCD_getTiming(LCD* lcd, LCD_Timing* timing);
+
+/**
+ * @brief Uses a timing profile measured earlier by LCD_calibrate.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param timing The profile.
+ */
+void LCD_setTiming(LCD* lcd, const LCD_Timing* timing);
+
+/**
+ * @brief Checks the bus alignment and recovers it without a full initialization.
+ *
+ * Call periodically on displays exposed to interference. Only cells that read back
+ * wrong are rewritten.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @return 1 if the bus was resynchronized, 0 if it was found aligned.
+ */
+int LCD_resync(LCD* lcd);
+
+/**
+ * @brief Checks a few DDRAM and CGRAM cells and rewrites those that changed.
+ *
+ * Each call continues where the previous one stopped and stays within the budget.
+ *
+ * @param lcd Pointer to the LCD object.
+ * @param budget_us The maximum time the call may take.
+ * @return The number of cells rewritten.
+ */
+size_t LCD_scrub(LCD* lcd, uint32_t budget_us);
+
 
 
 
@@ -95,21 +95,57 @@
 #define LCD_5x10DOTS 0x04
 #define LCD_5x8DOTS 0x00
 
+// controllers per panel, 40x4 panels have two with separate enable lines
+#define LCD_MAX_CONTROLLERS 2
+
+// timing calibration
+#define LCD_CALIBRATION_ROUNDS 4
+#define LCD_BUSY_TIMEOUT_US 10000
+#define LCD_ADDRESS_UPDATE_US 4     // address counter update after busy flag clears (tADD)
+
+// modes for row aware printing
+#define LCD_PRINT_WRAP 0x00
+#define LCD_PRINT_CLIP 0x01
+#define LCD_PRINT_ELLIPSIS 0x02
+
+// marks clipped text in LCD_PRINT_ELLIPSIS mode, right arrow in the A00 character ROM
+#ifndef LCD_ELLIPSIS_CHAR
+#define LCD_ELLIPSIS_CHAR 0x7E
+#endif
 
 #include <iostream>
 #include <string>
+#include "lcd_stats.h"
+#include "lcd_timing.h"
+#include "lcd_wait.h"
+#include "lcd_trace.hpp"
 
 class LCD {
+	friend class LCDAsync;     // steps through Begin() and multi-byte operations
+	friend class LCDGroup;     // drives the bus of several displays at once
+	friend class LCDKeypad;    // reads keys on the data lines between transfers
+	friend class LCDAnimator;  // rewrites changed CGRAM rows without moving the cursor
+	friend class LCDScreenStack;  // compares snapshots with the controller state
+	friend class LCDMirror;    // sends the controller state to a remote viewer
+	friend class LCDIsrPrint;  // keeps the cursor position around messages from interrupts
+	friend class LCDBudget;    // checks the bus time left before each byte
+	friend class LCDTrace;     // timestamps events with the cycle counter
 public:
 	LCD(GPIO_TypeDef* portdata, GPIO_TypeDef* portctrlRW, GPIO_TypeDef* portctrlEN, GPIO_TypeDef* portctrlRS);
     void initDataPins(uint16_t val4, uint16_t val5, uint16_t val6, uint16_t val7);
     void initCtrlPins(uint16_t ctrlRW, uint16_t ctrlEN, uint16_t ctrlRS) ;
+    void initSecondEnable(GPIO_TypeDef* portctrlEN2, uint16_t ctrlEN2);
     size_t printLCD(const std::string& message = "");
     int printFormatted(const char* format, ...);
     void putch(uint8_t ch) ;
+    size_t writeCells(const uint8_t* cells, size_t len);
+    size_t writeFrame(const uint8_t* cells);
+    size_t printRows(const std::string& message, uint8_t mode = LCD_PRINT_WRAP);
+    size_t printRows(const char* message, size_t len, uint8_t mode);
     void setCursor(uint8_t x=0, uint8_t y=0);
     void Begin ( int cols, int rows );
-    void createChar(uint8_t location, uint8_t charmap[]);
+    void createChar(uint8_t location, const uint8_t charmap[]);
+    void createChars(uint8_t first, const uint8_t charmaps[], uint8_t count);
     void noAutoscroll(void) ;
     void autoscroll(void) ;
     void leftToRight(void);
@@ -122,6 +158,26 @@ public:
 	void cursor(void);
 	void clear(void);
 	void home(void);
+	bool beginPageFlip(void);
+	void endPageFlip(void);
+	void flipPage(void);
+	uint8_t getCols(void) const { return _numcols; }
+	uint8_t getRows(void) const { return _numlines; }
+	void getStats(LCD_Stats* stats) const;
+	void resetStats(void);
+	bool calibrate(uint8_t margin_percent = 25);
+	void getTiming(LCD_Timing* timing) const;
+	void setTiming(const LCD_Timing* timing);
+	bool resync(void);
+	size_t scrub(uint32_t budget_us);
+	uint32_t getBusyTime(void) const;
+	void setBusyHook(void (*hook)(uint32_t us, void* context), void* context);
+	void setWaitStrategy(LCD_SleepFunc sleep, void* context, uint32_t min_sleep_us = LCD_SLEEP_MIN_US);
+	void getWaitStats(LCD_WaitStats* stats) const;
+	void resetWaitStats(void);
+#if LCD_TRACE
+	void setTrace(LCDTrace* trace);
+#endif
 
 
 private:
@@ -129,9 +185,16 @@ private:
     GPIO_TypeDef *vPortCtrlRW;
 	GPIO_TypeDef *vPortCtrlEN;
 	GPIO_TypeDef *vPortCtrlRS;
+	GPIO_TypeDef *vPortCtrlEN2 = nullptr;
 	uint16_t d4, d5, d6, d7;
 	uint16_t _data_pins[8];
 	uint16_t vCtrlRW, vCtrlEN, vCtrlRS;
+	uint16_t vCtrlEN2 = 0;
+
+	uint8_t _controllers = 1;  // 2 on panels with a second enable line
+	uint8_t _cur = 0;          // controller holding the cursor, rows 0-1 or rows 2-3
+	uint8_t _pin = 0xFF;       // controller all transfers go to, 0xFF to route by content
+	uint8_t _en_mask = 1;      // controllers pulsed by pulseEnable(), one bit each
 
 	uint8_t _displayfunction;
 	uint8_t _displaycontrol;
@@ -139,15 +202,86 @@ private:
 
 	uint8_t _initialized;
 
-	uint8_t _numlines;
+	uint8_t _numlines = 0;    // 0 until Begin()
+	uint8_t _numcols = 0;
 	uint8_t _row_offsets[4];
+	uint8_t _page_span = 0;   // DDRAM columns between the two pages, 0 when page flipping is off
+	uint8_t _front_page = 0;  // page currently shown in the display window (0 or 1)
+	uint8_t _col = 0, _row = 0;  // cursor position as last set or advanced by printing
 	uint8_t _fourbit_mode = 1;
 	uint8_t dotsize = LCD_5x8DOTS;
+	LCD_Timing _timing = {};  // calibrated execution times, worst case delays while not valid
+
+	// Controller state as it should be after everything sent, kept up to date by send()
+	uint8_t _ddram[LCD_MAX_CONTROLLERS][80];  // DDRAM content, indexed by ddramIndex()
+	uint8_t _cgram[64];       // CGRAM content, the same in all controllers
+	uint8_t _cg_defined = 0;  // CGRAM locations written since Begin(), one bit per location
+	uint8_t _ac[LCD_MAX_CONTROLLERS] = {};          // address counter
+	bool _ac_cgram[LCD_MAX_CONTROLLERS] = {};       // the address counter points into CGRAM
+	uint32_t _sent[LCD_MAX_CONTROLLERS] = {};       // cycle count when the last byte was sent
+	uint32_t _exec[LCD_MAX_CONTROLLERS] = {};       // its execution time in cycles
+	uint8_t _entry = LCD_ENTRYLEFT;  // entry mode bits as last sent
+	uint8_t _shift = 0;       // display shift in columns to the left
+	uint16_t _scrub_pos = 0;  // next cell checked by scrub(), per controller 80 DDRAM then 64 CGRAM cells
+	uint32_t _scrub_read = 0;   // slowest cell read back by scrub() in cycles, 0 until measured
+	uint32_t _scrub_write = 0;  // slowest cell rewritten by scrub() in cycles, 0 until measured
+	void (*_busy_hook)(uint32_t us, void* context) = nullptr;  // called before waiting for a controller
+	void* _busy_context = nullptr;
+	LCD_SleepFunc _sleep = nullptr;  // called for waits of at least _sleep_min_us, spinning otherwise
+	void* _sleep_context = nullptr;
+	uint32_t _sleep_min_us = LCD_SLEEP_MIN_US;
+	uint64_t _sleep_cycles = 0;   // time in the sleep function
+	uint64_t _spin_cycles = 0;    // time spun in waits
+	uint32_t _sleeps = 0, _spins = 0;
 
+	void prepare(int cols, int rows);
 	void setRowOffsets(int row0, int row1, int row2, int row3);
-	inline void command(uint8_t value) ;
-	inline size_t write(uint8_t value);
+	uint8_t drawOffset(void);
+	void advanceCursor(size_t n);
+	bool restoreCursor(uint8_t ctrl, uint8_t address);
+	void delayMs(uint32_t ms);
+	void delayUs(uint32_t us);
+	void waitUntil(uint32_t start, uint32_t span);
+	uint32_t waitBusy(void);
+	uint8_t readNibble(void);
+	void setDataInput(bool input, uint32_t pull = GPIO_NOPULL);
+	uint8_t readByte(GPIO_PinState mode);
+	uint8_t active(void) const { return (_pin != 0xFF) ? _pin : _cur; }
+	uint8_t route(uint8_t value, GPIO_PinState mode) const;
+	void selectController(uint8_t ctrl);
+	void waitReady(uint8_t mask);
+	void writeEnable(uint8_t mask, GPIO_PinState state);
+	void track(uint8_t ctrl, uint8_t value, GPIO_PinState mode, bool shared);
+	void stepAddress(uint8_t ctrl, bool decrement);
+	uint8_t ddramIndex(uint8_t address) const;
+	uint8_t ddramAddress(uint8_t index) const;
+	void realign(void);
+	size_t repair(bool cgram, uint8_t first, uint8_t count);
+	uint32_t byteCycles(void) const;
+	static uint32_t cycles(void);
+	static uint32_t cyclesToUs(uint32_t cycles);
+	inline void writePin(GPIO_TypeDef* port, uint16_t pin, uint8_t signal, GPIO_PinState state);
+#if LCD_TRACE
+	LCDTrace* _trace = nullptr;
+#endif
+
+#if LCD_STATS
+	// Records the latency of the outermost public method call it is created in
+	struct StatScope {
+		LCD* lcd;
+		uint8_t method;
+		uint32_t start;
+		StatScope(LCD* owner, uint8_t m);
+		~StatScope();
+	};
+	LCD_Stats _stats = {};
+	uint8_t _stat_depth = 0;
+#endif
+	void command(uint8_t value) ;
+	size_t write(uint8_t value);
 	void send(uint8_t value, GPIO_PinState mode);
+	void transfer(uint8_t mask, uint8_t value, GPIO_PinState mode);
+	void account(uint8_t mask, uint8_t value, GPIO_PinState mode);
 	void pulseEnable(void);
 	void write4bits(uint8_t value);
 	void write8bits(uint8_t value);
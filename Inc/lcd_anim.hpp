@@ -0,0 +1,122 @@
+/**
+ * @file lcd_anim.hpp
+ * @brief Animated custom characters, updated with only the CGRAM rows that change.
+ *
+ * Text showing a custom character is redrawn by the controller whenever the character's
+ * CGRAM pattern changes, so an animated icon needs no DDRAM writes at all. Consecutive
+ * frames of spinners, battery gauges or signal bars differ in a few rows only:
+ * lcdGlyphAnimation() compares the frames at compile time and records, for each step to the
+ * next frame, which rows change. LCDAnimator then writes just those rows, setting the CGRAM
+ * address only where the address counter is not already there:
+ *
+ * @code
+ * constexpr auto battery = lcdGlyphAnimation(
+ *     lcdCharmap(".###.", "#...#", "#...#", "#...#", "#...#", "#...#", "#####"),
+ *     lcdCharmap(".###.", "#...#", "#...#", "#...#", "#...#", "#####", "#####"),
+ *     lcdCharmap(".###.", "#...#", "#...#", "#...#", "#####", "#####", "#####"),
+ *     lcdCharmap(".###.", "#...#", "#...#", "#####", "#####", "#####", "#####"));
+ *
+ * LCDAnimator anim(lcd);
+ * anim.add(2, battery, 250);      // CGRAM location 2, a frame every 250 ms
+ * lcd.putch(2);
+ * for (;;) anim.tick();           // in the main loop
+ * @endcode
+ *
+ * A step of the battery above costs one address command and one data byte, plus one
+ * command to return the address counter to the cursor, instead of the 10 transfers of
+ * createChar(). The CGRAM locations given to add() belong to the animator: do not redefine
+ * them while the animation runs.
+ *
+ * Call tick() from the context that uses the display. Needs C++14.
+ */
+
+#ifndef LCD_ANIM_H
+#define LCD_ANIM_H
+
+#include "lcd_glyph.hpp"
+
+// Animations one animator runs, at most one per CGRAM location.
+#ifndef LCD_ANIM_MAX
+#define LCD_ANIM_MAX 8
+#endif
+
+// Shortest frame period. Liquid crystal takes about this long to settle, faster frames smear.
+#ifndef LCD_ANIM_MIN_PERIOD_MS
+#define LCD_ANIM_MIN_PERIOD_MS 50
+#endif
+
+/**
+ * @brief The frames of an animated custom character and the rows each step changes.
+ *
+ * @tparam F The number of frames.
+ */
+template <size_t F>
+struct LCDGlyphAnimation {
+    uint8_t rows[F][8];     // pattern of each frame
+    uint8_t changed[F];     // rows that differ from frame i to the next frame, one bit each
+};
+
+/**
+ * @brief Builds an animation from its frames, which play in a loop.
+ *
+ * Declare the result constexpr so that it is built at compile time and kept in flash.
+ *
+ * @param frames 2 to 255 patterns, see lcdCharmap().
+ * @return The animation.
+ */
+template <typename... Frames>
+constexpr LCDGlyphAnimation<sizeof...(Frames)> lcdGlyphAnimation(const Frames&... frames) {
+    static_assert(sizeof...(Frames) >= 2 && sizeof...(Frames) <= 255, "an animation has 2 to 255 frames");
+
+    LCDGlyphAnimation<sizeof...(Frames)> anim = {};
+    const LCDCharmap maps[] = { frames... };
+    const size_t count = sizeof...(Frames);
+    for (size_t f = 0; f < count; f++) {
+        const LCDCharmap& next = maps[(f + 1) % count];
+        for (uint8_t i = 0; i < 8; i++) {
+            anim.rows[f][i] = maps[f].rows[i];
+            if (maps[f].rows[i] != next.rows[i]) anim.changed[f] |= 1 << i;
+        }
+    }
+    return anim;
+}
+
+class LCDAnimator {
+public:
+    explicit LCDAnimator(LCD& lcd);
+
+    /**
+     * @brief Starts an animation, see addFrames().
+     */
+    template <size_t F>
+    bool add(uint8_t location, const LCDGlyphAnimation<F>& anim, uint16_t period_ms) {
+        return addFrames(location, &anim.rows[0][0], anim.changed, F, period_ms);
+    }
+
+    bool remove(uint8_t location);
+    bool pause(uint8_t location, bool paused);
+    bool show(uint8_t location, uint8_t frame);
+    size_t tick(void);
+
+private:
+    struct Entry {
+        const uint8_t* rows;        // frame patterns, 8 bytes each
+        const uint8_t* changed;     // rows changed by each step
+        uint8_t frames;
+        uint8_t frame;              // frame shown
+        uint8_t location;
+        bool paused;
+        uint16_t period;            // ms per frame
+        uint32_t last;              // HAL tick the shown frame is due from
+    };
+
+    LCD& _lcd;
+    Entry _entries[LCD_ANIM_MAX];
+    uint8_t _count = 0;
+
+    bool addFrames(uint8_t location, const uint8_t* rows, const uint8_t* changed, uint8_t frames, uint16_t period_ms);
+    Entry* find(uint8_t location);
+    size_t step(Entry& e, uint8_t frame, uint8_t changed);
+};
+
+#endif // LCD_ANIM_H
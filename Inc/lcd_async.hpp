@@ -0,0 +1,186 @@
+/**
+ * @file lcd_async.hpp
+ * @brief Awaitable LCD operations for cooperative schedulers, built on C++20 coroutines.
+ *
+ * The LCD methods wait for the controller inside the call, in HAL_Delay() or in a busy
+ * loop, so a cooperative scheduler stalls while the display executes. LCDAsync provides
+ * the operations as coroutines that suspend at each controller wait instead, and UI code
+ * is still written as a plain sequence:
+ *
+ * @code
+ * LCDTask ui(LCDAsync& lcd) {
+ *     co_await lcd.begin(20, 4);
+ *     for (;;) {
+ *         co_await lcd.setCursor(0, 0);
+ *         co_await lcd.print("Hello");
+ *         co_await lcd.sleep(500000);
+ *     }
+ * }
+ *
+ * LCDAsync lcd_async(lcd);
+ * LCDTask task = ui(lcd_async);
+ * task.start();
+ * for (;;) {
+ *     lcd_async.poll();       // resumes the coroutine once its wait is over
+ *     other_work();
+ * }
+ * @endcode
+ *
+ * A waiting coroutine is resumed by poll(). The wakeup hook set with setWakeup() is told
+ * how long each wait lasts, so a scheduler can arm a timer and call poll() when it
+ * expires instead of polling all the time.
+ *
+ * Coroutine frames come from a static pool of LCD_ASYNC_FRAMES slots of
+ * LCD_ASYNC_FRAME_SIZE bytes, never from the heap. When no slot is free, or the frame is
+ * larger than a slot, the coroutine is not created and co_await on it returns false.
+ * largestFrame() tells the size needed by the coroutines used so far.
+ *
+ * The waits come from the timing profile of the display, so begin() installs the datasheet
+ * worst case when neither calibrate() nor setTiming() provided one. It stays installed on
+ * the LCD, whose own methods then use it too (see LCDAsync::begin()). Drive each display
+ * from one coroutine at a time, and not from interrupts. Pointers given to the operations
+ * must stay valid until the operation completes.
+ *
+ * Needs C++20. In older language modes this module compiles to nothing.
+ */
+
+#ifndef LCD_ASYNC_H
+#define LCD_ASYNC_H
+
+#include "lcd.hpp"
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+
+// Number of coroutine frames in the static pool, at most 32.
+#ifndef LCD_ASYNC_FRAMES
+#define LCD_ASYNC_FRAMES 4
+#endif
+
+// Size of a pool slot, the largest coroutine frame that can be created.
+#ifndef LCD_ASYNC_FRAME_SIZE
+#define LCD_ASYNC_FRAME_SIZE 256
+#endif
+
+// Controller waits shorter than this are busy waited, a suspension would cost more.
+#ifndef LCD_ASYNC_SPIN_US
+#define LCD_ASYNC_SPIN_US 10
+#endif
+
+// Timing profile used by begin() when the display has none: the HD44780 execution times
+// at the lowest oscillator frequency of the datasheet, with margin.
+#ifndef LCD_ASYNC_COMMAND_US
+#define LCD_ASYNC_COMMAND_US 80
+#endif
+#ifndef LCD_ASYNC_CLEAR_US
+#define LCD_ASYNC_CLEAR_US 3000
+#endif
+
+static_assert(LCD_ASYNC_FRAMES >= 1 && LCD_ASYNC_FRAMES <= 32, "LCD_ASYNC_FRAMES must be 1 to 32");
+
+/**
+ * @brief A coroutine started by co_await on it, or by start() at the top level.
+ */
+class LCDTask {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    struct promise_type {
+        std::coroutine_handle<> continuation;   // the awaiting coroutine, resumed at the end
+
+        struct Finish {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(Handle self) noexcept {
+                std::coroutine_handle<> next = self.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        LCDTask get_return_object() { return LCDTask(Handle::from_promise(*this)); }
+        static LCDTask get_return_object_on_allocation_failure() { return LCDTask(nullptr); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        Finish final_suspend() const noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {}
+
+        static void* operator new(size_t size) noexcept;
+        static void operator delete(void* frame) noexcept;
+    };
+
+    LCDTask(LCDTask&& other) noexcept : _handle(other._handle) { other._handle = nullptr; }
+    LCDTask(const LCDTask&) = delete;
+    LCDTask& operator=(const LCDTask&) = delete;
+    ~LCDTask() { if (_handle) _handle.destroy(); }
+
+    bool start(void);
+    bool valid(void) const { return (bool)_handle; }
+    bool done(void) const { return !_handle || _handle.done(); }
+
+    // co_await runs the task to its end, and returns false if it could not be created
+    bool await_ready() const noexcept { return done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        _handle.promise().continuation = caller;
+        return _handle;
+    }
+    bool await_resume() const noexcept { return valid(); }
+
+    static uint8_t framesInUse(void);
+    static size_t largestFrame(void);
+
+private:
+    explicit LCDTask(Handle handle) : _handle(handle) {}
+    Handle _handle;
+};
+
+class LCDAsync {
+public:
+    /**
+     * @brief Suspends the awaiting coroutine until poll() finds the time is over.
+     */
+    struct Wait {
+        LCDAsync& owner;
+        uint32_t us;
+
+        bool await_ready() const noexcept { return us == 0; }
+        void await_suspend(std::coroutine_handle<> waiter) { owner.suspend(waiter, us); }
+        void await_resume() const noexcept {}
+    };
+
+    LCDAsync(LCD& lcd, uint32_t (*clock)(void) = nullptr, uint32_t clock_hz = 0);
+    void setWakeup(void (*wakeup)(uint32_t delay_us, void* context), void* context);
+    bool poll(void);
+    bool waiting(void) const { return (bool)_waiter; }
+
+    LCDTask begin(int cols, int rows);
+    LCDTask print(const char* text);
+    LCDTask writeCells(const uint8_t* cells, size_t len);
+    LCDTask setCursor(uint8_t x, uint8_t y);
+    LCDTask createChar(uint8_t location, const uint8_t charmap[]);
+    LCDTask clear(void) { return call(&LCD::clear); }
+    LCDTask home(void) { return call(&LCD::home); }
+    LCDTask display(void) { return call(&LCD::display); }
+    LCDTask noDisplay(void) { return call(&LCD::noDisplay); }
+    LCDTask cursor(void) { return call(&LCD::cursor); }
+    LCDTask noCursor(void) { return call(&LCD::noCursor); }
+    Wait sleep(uint32_t us) { return Wait{ *this, us }; }
+
+private:
+    LCD& _lcd;
+    uint32_t (*_clock)(void);
+    uint32_t _clock_hz;
+    void (*_wakeup)(uint32_t delay_us, void* context) = nullptr;
+    void* _wakeup_context = nullptr;
+    std::coroutine_handle<> _waiter;    // the suspended coroutine, null when none
+    uint32_t _start = 0;                // clock when it was suspended
+    uint32_t _ticks = 0;                // clock ticks it waits
+
+    LCDTask call(void (LCD::*method)(void));
+    Wait ready(void);
+    void suspend(std::coroutine_handle<> waiter, uint32_t us);
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // LCD_ASYNC_H
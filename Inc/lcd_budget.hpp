@@ -0,0 +1,84 @@
+/**
+ * @file lcd_budget.hpp
+ * @brief Printing in slices of bounded bus time, continued across calls.
+ *
+ * printLCD() returns when the whole text is sent, so the time it blocks grows with the
+ * length of the text. LCDBudget sends text one bus byte at a time and checks before each
+ * byte that it still fits in the budget of the call, counting the execution time the
+ * controller still needs for the previous byte. What does not fit is returned as an
+ * LCDContinuation, which the next call resumes:
+ *
+ * @code
+ * LCDBudget budget(lcd);
+ * LCDContinuation status = budget.print("Pressure 1.013 bar", 100);
+ *
+ * for (;;) {                                      // control loop
+ *     control_step();
+ *     if (!status.done()) status = budget.resume(status, 100);
+ * }
+ * @endcode
+ *
+ * A call takes at most its budget, plus the time spent in interrupt handlers. Within a
+ * call the waits for the controller spin, as the busy hook and the sleep strategy could
+ * overrun the budget; both are used again outside of it. The bound needs a timing
+ * profile, from calibrate() or setTiming(): the default delays take milliseconds per
+ * byte, so short budgets then send nothing. The bus time of a byte is assumed to be
+ * LCD_BUDGET_BYTE_US at first, and the slowest transfer seen replaces it when it is
+ * longer.
+ *
+ * Like printRows(), the text flows left to right within the rows of the display, and
+ * the end of a row is handled by LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS.
+ * Other code may use the display between two calls: the continuation keeps its place on
+ * the screen and moves the cursor back there first.
+ */
+
+#ifndef LCD_BUDGET_H
+#define LCD_BUDGET_H
+
+#include "lcd.hpp"
+
+// Bus time of one byte assumed until a slower transfer is measured: the enable pulses
+// and the pin writes, without the execution time of the controller.
+#ifndef LCD_BUDGET_BYTE_US
+#define LCD_BUDGET_BYTE_US 20
+#endif
+
+/**
+ * @brief The part of a text still to be printed, and where it goes.
+ */
+struct LCDContinuation {
+    const uint8_t* text;    // next character
+    size_t len;             // characters left, 0 when done or the rest was clipped
+    uint8_t col, row;       // position of the next character
+    uint8_t mode;           // LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS
+
+    bool done(void) const { return !len; }
+};
+
+class LCDBudget {
+public:
+    explicit LCDBudget(LCD& lcd);
+    LCDContinuation print(const char* text, uint32_t budget_us, uint16_t max_bytes = 0,
+                          uint8_t mode = LCD_PRINT_WRAP);
+    LCDContinuation print(const uint8_t* cells, size_t len, uint32_t budget_us, uint16_t max_bytes = 0,
+                          uint8_t mode = LCD_PRINT_WRAP);
+    LCDContinuation resume(LCDContinuation next, uint32_t budget_us, uint16_t max_bytes = 0);
+
+    uint32_t byteTime(void) const;
+    uint32_t minBudget(void) const;
+    uint32_t lastCallTime(void) const { return _last_call_us; }
+    uint32_t maxCallTime(void) const { return _max_call_us; }
+
+private:
+    LCD& _lcd;
+    uint32_t _byte_cycles = 0;      // slowest transfer measured, 0 until one is
+    uint32_t _last_call_us = 0;
+    uint32_t _max_call_us = 0;
+
+    uint8_t seekBytes(uint8_t row) const;
+    uint32_t busyCycles(void) const;
+    uint32_t transferCycles(void) const;
+    uint32_t executeCycles(void) const;
+};
+
+#endif // LCD_BUDGET_H
@@ -0,0 +1,78 @@
+/**
+ * @file lcd_charset.hpp
+ * @brief UTF-8 text output translated to the HD44780 character ROM.
+ *
+ * The HD44780 is sold with different character ROMs. A00 holds ASCII (with ¥ in place of
+ * the backslash), half width katakana and a set of Greek and math symbols. A02 holds ASCII
+ * and an upper half that follows ISO 8859-1. LCDText decodes UTF-8 byte by byte and looks
+ * each code point up in tables that are generated at compile time and kept in flash.
+ * Code points that are not in the ROM can be shown with custom glyphs, which are loaded
+ * into CGRAM on demand.
+ */
+
+#ifndef LCD_CHARSET_H
+#define LCD_CHARSET_H
+
+#include "lcd.hpp"
+
+// Character code used for code points that are neither in the ROM nor in the glyph set.
+#ifndef LCD_CHARSET_REPLACEMENT
+#define LCD_CHARSET_REPLACEMENT '?'
+#endif
+
+enum LCDCharRom : uint8_t {
+    LCD_ROM_A00,    // Japanese standard font
+    LCD_ROM_A02     // European standard font
+};
+
+/**
+ * @brief A custom glyph for a code point that is not in the character ROM.
+ */
+struct LCDGlyph {
+    uint32_t codepoint;
+    uint8_t rows[8];
+};
+
+/**
+ * @brief Streaming UTF-8 decoder.
+ *
+ * Bytes are fed one at a time, so a string can be decoded in pieces. Malformed input,
+ * overlong forms and surrogates decode to U+FFFD.
+ */
+class LCDUtf8Decoder {
+public:
+    bool feed(uint8_t byte, uint32_t& codepoint);
+    void reset(void) { _need = 0; }
+
+private:
+    uint32_t _cp = 0;
+    uint32_t _min = 0;
+    uint8_t _need = 0;
+};
+
+class LCDText {
+public:
+    LCDText(LCD& lcd, LCDCharRom rom = LCD_ROM_A00);
+    void setGlyphs(const LCDGlyph* glyphs, uint8_t count, uint8_t firstSlot = 0);
+    size_t print(const char* utf8);
+    size_t translate(const char* utf8, uint8_t* out, size_t outlen);
+
+    static uint16_t lookup(LCDCharRom rom, uint32_t codepoint);
+
+private:
+    LCD& _lcd;
+    LCDCharRom _rom;
+    LCDUtf8Decoder _decoder;
+    const LCDGlyph* _glyphs = nullptr;
+    uint8_t _glyph_count = 0;
+    uint8_t _first_slot = 0;
+    uint32_t _slot_cp[8];       // code point loaded in each CGRAM slot, 0 when free
+    uint32_t _slot_use[8];      // glyph use that last showed each slot, 0 when free
+    uint32_t _uses = 0;         // glyph uses counted by print()
+    uint32_t _print_start = 0;  // first use of the running print()
+
+    size_t translateCodepoint(uint32_t cp, uint8_t* out, bool upload);
+    int glyphSlot(uint32_t cp, bool upload);
+};
+
+#endif // LCD_CHARSET_H
@@ -0,0 +1,53 @@
+/**
+ * @file lcd_console.hpp
+ * @brief Scrolling text console on top of the LCD class.
+ *
+ * The console keeps the text of the whole screen in RAM and interprets the control
+ * characters '\\n', '\\r', '\\t' and '\\b'. Text wraps at the last column and the console
+ * scrolls up one line when the bottom row is full. After each print only the cells that
+ * differ from what is already on the display are sent, so a burst of log lines costs one
+ * screen of differences instead of one redraw per line.
+ */
+
+#ifndef LCD_CONSOLE_H
+#define LCD_CONSOLE_H
+
+#include "lcd.hpp"
+
+// Tab stops are placed every LCD_CONSOLE_TABSIZE columns.
+#ifndef LCD_CONSOLE_TABSIZE
+#define LCD_CONSOLE_TABSIZE 4
+#endif
+
+// Largest display handled by a console (20x4 or 40x2). Each console keeps three bytes per
+// cell, so a 40x4 panel needs 160. A display with more cells is handled with its top rows
+// only. Override before including to change.
+#ifndef LCD_CONSOLE_MAX_CELLS
+#define LCD_CONSOLE_MAX_CELLS 80
+#endif
+
+class LCDConsole {
+public:
+    LCDConsole(LCD& lcd);
+    size_t print(const char* text);
+    int printFormatted(const char* format, ...);
+    void putch(char ch);
+    void clear(void);
+    void flush(void);
+    void invalidate(void);
+
+private:
+    LCD& _lcd;
+    uint8_t _cols, _rows;
+    uint8_t _col = 0, _row = 0;
+    uint8_t _text[LCD_CONSOLE_MAX_CELLS];    // intended screen content
+    uint8_t _shown[LCD_CONSOLE_MAX_CELLS];   // content last sent to the display
+    uint8_t _known[LCD_CONSOLE_MAX_CELLS];   // 1 when the matching _shown cell is valid
+
+    bool sized(void);
+    void interpret(char ch);
+    void newline(void);
+    void scrollUp(void);
+};
+
+#endif // LCD_CONSOLE_H
@@ -0,0 +1,160 @@
+/**
+ * @file lcd_glyph.hpp
+ * @brief Custom character sets built at compile time and kept in flash.
+ *
+ * lcdCharmap() turns a glyph drawn as text art, one string of 5 pixels per row, into the
+ * 8 CGRAM bytes of a custom character. lcdGlyphSet() collects glyphs into one table,
+ * merges glyphs with the same pattern into one CGRAM location and maps each glyph, by its
+ * position in the argument list, to its location:
+ *
+ * @code
+ * constexpr LCDCharmap bell = lcdCharmap(
+ *     "..#..",
+ *     ".###.",
+ *     ".###.",
+ *     ".###.",
+ *     "#####",
+ *     ".....",
+ *     "..#..");
+ *
+ * enum { GLYPH_BELL, GLYPH_HEART, GLYPH_ALARM };
+ * constexpr auto icons = lcdGlyphSet(
+ *     bell,
+ *     lcdCharmap(".....", ".#.#.", "#####", "#####", ".###.", "..#..", "....."),
+ *     bell);                                  // same pattern, same location
+ *
+ * icons.upload(lcd, 1);                       // locations 1 and 2
+ * lcd.putch(icons.code(GLYPH_HEART, 1));
+ * @endcode
+ *
+ * upload() sets the CGRAM address once and writes all patterns with the address counter
+ * stepping on, 1 + 8n transfers for n glyphs, straight from the table in flash.
+ *
+ * Glyphs from BDF fonts are converted by Tools/lcd_glyphc.py into a header with the same
+ * lcdGlyphSet() table and an enum of glyph IDs. Needs C++14.
+ */
+
+#ifndef LCD_GLYPH_H
+#define LCD_GLYPH_H
+
+#include "lcd.hpp"
+
+// Marks a lit pixel in a glyph row, '.' and ' ' are dark. Override before including to change.
+#ifndef LCD_GLYPH_PIXEL
+#define LCD_GLYPH_PIXEL '#'
+#endif
+
+/**
+ * @brief The CGRAM pattern of a custom character, 5 pixels per row in bits 4 to 0.
+ */
+struct LCDCharmap {
+    uint8_t rows[8];
+};
+
+/**
+ * @brief A set of custom characters ready for CGRAM.
+ *
+ * @tparam N The number of glyphs, which may exceed 8 as long as there are at most 8
+ *         distinct patterns.
+ */
+template <size_t N>
+struct LCDGlyphSet {
+    uint8_t rows[8 * 8];    // distinct patterns in CGRAM order, 8 bytes each
+    uint8_t slot[N];        // location of each glyph relative to the first one
+    uint8_t count;          // number of distinct patterns
+
+    /**
+     * @brief Writes the patterns to consecutive CGRAM locations, see LCD::createChars().
+     * @param first The location of the first pattern.
+     */
+    void upload(LCD& lcd, uint8_t first = 0) const { lcd.createChars(first, rows, count); }
+
+    /**
+     * @brief Returns the character code of a glyph after upload(lcd, first).
+     * @param id The position of the glyph in the lcdGlyphSet() arguments.
+     */
+    constexpr uint8_t code(size_t id, uint8_t first = 0) const { return first + slot[id]; }
+};
+
+namespace lcd_glyph_detail {
+    // Not constexpr: reaching them while building a table at compile time makes the build
+    // fail. A table built at run time takes the fallbacks documented below instead.
+    inline void badPixel(void) {}
+    inline void tooManyPatterns(void) {}
+
+    template <size_t Len>
+    constexpr bool lengthsMatch() { return true; }
+
+    template <size_t Len, size_t N, size_t... Rest>
+    constexpr bool lengthsMatch() { return N == Len && lengthsMatch<Len, Rest...>(); }
+
+    constexpr bool sameRows(const uint8_t* a, const uint8_t* b) {
+        for (uint8_t i = 0; i < 8; i++) {
+            if (a[i] != b[i]) return false;
+        }
+        return true;
+    }
+}
+
+/**
+ * @brief Builds a glyph from text art.
+ *
+ * The 8th row is the one the underline cursor uses and may be left out, it is dark then.
+ * Declare the result constexpr, or use it in a constexpr glyph set, so that it is built
+ * and checked at compile time. Built at run time, a pixel character other than
+ * LCD_GLYPH_PIXEL, '.' or ' ' is not reported and stays dark.
+ *
+ * @param rows 7 or 8 rows of exactly 5 pixels, LCD_GLYPH_PIXEL for lit, '.' or ' ' for dark.
+ * @return The pattern.
+ */
+template <size_t... N>
+constexpr LCDCharmap lcdCharmap(const char (&... rows)[N]) {
+    static_assert(sizeof...(N) == 7 || sizeof...(N) == 8, "a glyph has 7 or 8 rows");
+    static_assert(lcd_glyph_detail::lengthsMatch<6, N...>(), "every glyph row must have exactly 5 pixels");
+
+    LCDCharmap map = {};
+    const char* text[] = { rows... };
+    for (uint8_t y = 0; y < sizeof...(N); y++) {
+        for (uint8_t x = 0; x < 5; x++) {
+            char c = text[y][x];
+            if (c == LCD_GLYPH_PIXEL)
+                map.rows[y] |= 0x10 >> x;
+            else if (c != '.' && c != ' ')
+                lcd_glyph_detail::badPixel();
+        }
+    }
+    return map;
+}
+
+/**
+ * @brief Builds a glyph set, merging glyphs with the same pattern.
+ *
+ * Declare the result constexpr, so that a set with more than 8 distinct patterns fails
+ * to build. Built at run time, the glyphs beyond the 8th pattern are not reported and get
+ * the location of the 8th.
+ *
+ * @param glyphs The glyphs, their positions are the IDs given to LCDGlyphSet::code().
+ * @return The set.
+ */
+template <typename... Glyphs>
+constexpr LCDGlyphSet<sizeof...(Glyphs)> lcdGlyphSet(const Glyphs&... glyphs) {
+    static_assert(sizeof...(Glyphs) >= 1, "a glyph set needs at least one glyph");
+
+    LCDGlyphSet<sizeof...(Glyphs)> set = {};
+    const LCDCharmap maps[] = { glyphs... };
+    for (size_t g = 0; g < sizeof...(Glyphs); g++) {
+        uint8_t s = 0;
+        while (s < set.count && !lcd_glyph_detail::sameRows(&set.rows[8 * s], maps[g].rows)) s++;
+        if (s == 8) {
+            lcd_glyph_detail::tooManyPatterns();
+            s = 7;
+        } else if (s == set.count) {
+            for (uint8_t i = 0; i < 8; i++) set.rows[8 * s + i] = maps[g].rows[i];
+            set.count++;
+        }
+        set.slot[g] = s;
+    }
+    return set;
+}
+
+#endif // LCD_GLYPH_H
@@ -0,0 +1,63 @@
+/**
+ * @file lcd_group.hpp
+ * @brief Bit-parallel updates of several displays whose data pins share one GPIO port.
+ *
+ * Displays wired to different pin groups of the same data port are normally written one
+ * after the other, each byte waiting its own execution time. An LCDGroup sends one byte
+ * to every display at once: the nibbles of all displays are merged into a single BSRR
+ * store per nibble, and all enable lines are pulsed together. The displays then execute
+ * in parallel, so N displays showing different content are updated in about the time of
+ * one:
+ *
+ * @code
+ * LCDGroup group;
+ * group.add(left);        // after Begin() and calibrate() of each display
+ * group.add(right);
+ * const uint8_t* frames[] = { left_cells, right_cells };
+ * group.writeFrame(frames);
+ * @endcode
+ *
+ * The displays must have the same geometry and a timing profile, and each its own enable
+ * line. RS and RW may be shared. Displays with two controllers cannot be grouped.
+ */
+
+#ifndef LCD_GROUP_H
+#define LCD_GROUP_H
+
+#include "lcd.hpp"
+
+// Displays in a group. Four 4-bit displays fill a 16-pin port.
+#ifndef LCD_GROUP_MAX
+#define LCD_GROUP_MAX 4
+#endif
+
+class LCDGroup {
+public:
+    bool add(LCD& lcd);
+    uint8_t size(void) const { return _count; }
+
+    void setCursor(uint8_t x, uint8_t y);
+    size_t writeCells(const uint8_t* const cells[], size_t len);
+    size_t writeFrame(const uint8_t* const frames[]);
+    void clear(void);
+
+private:
+    struct PortWrite {
+        GPIO_TypeDef* port;
+        uint32_t bsrr;      // pins to set in the low half, pins to reset in the high half
+    };
+
+    LCD* _members[LCD_GROUP_MAX];
+    uint8_t _count = 0;
+    uint16_t _data_mask = 0;        // data pins in use on the shared port
+    PortWrite _writes[3 * LCD_GROUP_MAX + 1];
+    uint8_t _write_count = 0;
+
+    void transfer(const uint8_t values[], GPIO_PinState mode);
+    void stage(LCD& lcd, GPIO_TypeDef* port, uint16_t pin, uint8_t signal, GPIO_PinState state);
+    void stageNibble(const uint8_t values[], uint8_t shift);
+    void flush(void);
+    void pulseEnable(void);
+};
+
+#endif // LCD_GROUP_H
@@ -0,0 +1,75 @@
+/**
+ * @file lcd_isr.hpp
+ * @brief Messages posted from interrupt handlers in bounded time, shown later.
+ *
+ * Printing from an interrupt handler is not possible: the LCD class waits for the
+ * controller, uses HAL_Delay() when it has no timing profile, and must not be entered
+ * while the interrupted code is in the middle of a transfer. LCDIsrPrint gives each
+ * interrupt source a slot, reserved beforehand with a place on the screen. post() only
+ * copies the message into its slot, and drain(), called from the context that owns the
+ * display, shows the slots that changed:
+ *
+ * @code
+ * LCDIsrPrint faults(lcd);
+ * faults.reserve(0, 0, 3, 20);            // slot 0: row 3, 20 columns
+ *
+ * void TIM1_BRK_IRQHandler(void) {
+ *     faults.postHex(0, "BRK fault ", TIM1->SR);
+ * }
+ *
+ * for (;;) { faults.drain(); ... }        // main loop
+ * @endcode
+ *
+ * post() and postHex() run the same loop for every message: they always copy
+ * LCD_ISR_TEXT_MAX characters, padding with spaces after the end of the text, with no
+ * data dependent exit, and they neither wait, lock, nor call into the HAL. Their worst
+ * case is thus fixed by LCD_ISR_TEXT_MAX and can be measured once with the DWT cycle
+ * counter. A slot has a sequence counter that is odd while the slot is written, so drain()
+ * never shows a half written message, and posting needs no compare-and-swap, which also
+ * makes it usable on Cortex-M0.
+ *
+ * Each slot must have a single writer: give interrupts that can preempt each other
+ * different slots. A message posted again before drain() replaces the previous one.
+ */
+
+#ifndef LCD_ISR_H
+#define LCD_ISR_H
+
+#include "lcd.hpp"
+#include <atomic>
+
+// Slots, one per interrupt source or priority level that posts.
+#ifndef LCD_ISR_SLOTS
+#define LCD_ISR_SLOTS 4
+#endif
+
+// Characters of a message. Every post copies this many.
+#ifndef LCD_ISR_TEXT_MAX
+#define LCD_ISR_TEXT_MAX 20
+#endif
+
+class LCDIsrPrint {
+public:
+    explicit LCDIsrPrint(LCD& lcd);
+
+    // Setup and display side, from the context that owns the display
+    bool reserve(uint8_t slot, uint8_t x, uint8_t y, uint8_t width);
+    size_t drain(void);
+
+    // Interrupt side, constant time
+    bool post(uint8_t slot, const char* text);
+    bool postHex(uint8_t slot, const char* text, uint32_t value);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;     // odd while the text is written
+        char text[LCD_ISR_TEXT_MAX];
+        uint32_t shown;                     // sequence of the text on the display
+        uint8_t x, y, width;                // width 0 while not reserved
+    };
+
+    LCD& _lcd;
+    Slot _slots[LCD_ISR_SLOTS];
+};
+
+#endif // LCD_ISR_H
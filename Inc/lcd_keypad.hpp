@@ -0,0 +1,90 @@
+/**
+ * @file lcd_keypad.hpp
+ * @brief Key scanning on the LCD data lines, between display transfers.
+ *
+ * The controller only looks at D4-D7 while EN is pulsed, so between transfers the data
+ * lines can read keys. Each key connects a data line to a row line: the data pins are
+ * briefly switched to inputs with pull-ups, each row line is pulled low in turn, and a
+ * pressed key reads as a low data line. Up to LCD_KEYPAD_MAX_ROWS rows of 4 keys cost
+ * one GPIO per row instead of one per key. Without rows, 4 keys connect the data lines
+ * to ground directly.
+ *
+ * The rows are open-drain and released while the display is written, so a pressed key
+ * does not load the data lines. Direct keys to ground need a series resistor (1 kOhm)
+ * for the same reason.
+ *
+ * With a timing profile, scans run in the time a byte waits for the controller to execute
+ * the previous one (see LCD::setBusyHook()), so scanning during display updates costs no
+ * extra time. poll() scans when the display is idle. Keys are debounced over
+ * LCD_KEYPAD_DEBOUNCE scans taken at least LCD_KEYPAD_PERIOD_MS apart.
+ *
+ * Call poll() from the context that uses the display, never from an interrupt that can
+ * preempt a display transfer.
+ */
+
+#ifndef LCD_KEYPAD_H
+#define LCD_KEYPAD_H
+
+#include "lcd.hpp"
+
+// Row lines, 4 keys each.
+#ifndef LCD_KEYPAD_MAX_ROWS
+#define LCD_KEYPAD_MAX_ROWS 4
+#endif
+
+// Minimum time between two scans.
+#ifndef LCD_KEYPAD_PERIOD_MS
+#define LCD_KEYPAD_PERIOD_MS 5
+#endif
+
+// Equal scans in a row before a key change is accepted.
+#ifndef LCD_KEYPAD_DEBOUNCE
+#define LCD_KEYPAD_DEBOUNCE 4
+#endif
+
+// Settling time of the data lines after a row is selected.
+#ifndef LCD_KEYPAD_SETTLE_US
+#define LCD_KEYPAD_SETTLE_US 2
+#endif
+
+// Controller wait long enough for a scan in it, smaller waits are left alone.
+#ifndef LCD_KEYPAD_GAP_US
+#define LCD_KEYPAD_GAP_US 20
+#endif
+
+static_assert(LCD_KEYPAD_MAX_ROWS <= 4, "a 16-bit key mask holds 4 rows of 4 keys");
+
+class LCDKeypad {
+public:
+    explicit LCDKeypad(LCD& lcd);
+    bool addRow(GPIO_TypeDef* port, uint16_t pin);
+    void begin(void);
+    void end(void);
+    bool poll(void);
+
+    uint16_t keys(void) const { return _keys; }
+    uint16_t takePressed(void);
+    uint32_t scans(void) const { return _scans; }
+    uint32_t gapScans(void) const { return _gap_scans; }
+
+private:
+    LCD& _lcd;
+    GPIO_TypeDef* _row_ports[LCD_KEYPAD_MAX_ROWS];
+    uint16_t _row_pins[LCD_KEYPAD_MAX_ROWS];
+    uint8_t _rows = 0;
+    uint32_t _last_scan = 0;        // HAL tick of the last scan
+    bool _scanned = false;
+    uint16_t _raw = 0;              // last scan, one bit per key, row * 4 + data line
+    uint8_t _stable = 0;            // scans in a row equal to _raw
+    uint16_t _keys = 0;             // debounced state
+    uint16_t _pressed = 0;          // keys pressed since takePressed()
+    uint32_t _scans = 0;
+    uint32_t _gap_scans = 0;
+
+    bool due(void) const;
+    void scan(void);
+    uint8_t readLines(void);
+    static void busyGap(uint32_t us, void* context);
+};
+
+#endif // LCD_KEYPAD_H
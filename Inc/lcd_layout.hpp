@@ -0,0 +1,81 @@
+/**
+ * @file lcd_layout.hpp
+ * @brief Fixed region layout on top of the LCD class.
+ *
+ * A layout is a set of regions (label, numeric field, bar, icon) that are declared once
+ * with their position and width. Updating a region renders it into a small cell buffer,
+ * compares it with what is already on the display and only sends the cells that changed,
+ * with a cursor address command only where the changed cells are not contiguous.
+ *
+ * Regions on rows past LCD_LAYOUT_MAX_CELLS are rejected, which by default leaves rows 2
+ * and 3 of a 40x4 panel out of reach.
+ */
+
+#ifndef LCD_LAYOUT_H
+#define LCD_LAYOUT_H
+
+#include "lcd.hpp"
+
+// Maximum number of regions in one layout. Override before including to change.
+#ifndef LCD_LAYOUT_MAX_REGIONS
+#define LCD_LAYOUT_MAX_REGIONS 16
+#endif
+
+// Largest display handled by a layout (20x4 or 40x2). Each layout keeps two bytes per cell,
+// so a 40x4 panel needs 160. Override before including to change.
+#ifndef LCD_LAYOUT_MAX_CELLS
+#define LCD_LAYOUT_MAX_CELLS 80
+#endif
+#define LCD_LAYOUT_MAX_WIDTH 40
+
+class LCDLayout {
+public:
+    enum RegionType : uint8_t {
+        REGION_LABEL,
+        REGION_NUMBER,
+        REGION_BAR,
+        REGION_ICON
+    };
+
+    LCDLayout(LCD& lcd);
+    int addLabel(uint8_t x, uint8_t y, uint8_t width, const char* text = "");
+    int addNumber(uint8_t x, uint8_t y, uint8_t width, uint8_t decimals = 0);
+    int addBar(uint8_t x, uint8_t y, uint8_t width, uint16_t max, uint8_t fill = 0xFF);
+    int addIcon(uint8_t x, uint8_t y, uint8_t glyph = ' ');
+
+    void setText(int id, const char* text);
+    void setNumber(int id, int32_t value);
+    void setBar(int id, uint16_t value);
+    void setIcon(int id, uint8_t glyph);
+
+    void invalidate(void);
+    void redraw(void);
+
+    size_t bytesSent(void) const { return _bytes; }
+    void resetBytesSent(void) { _bytes = 0; }
+
+private:
+    struct Region {
+        RegionType type;
+        uint8_t x, y, width;
+        uint8_t decimals;   // NUMBER: digits after the decimal point
+        uint8_t fill;       // BAR: character code for a filled cell
+        uint16_t max;       // BAR: value that fills the whole bar
+        int32_t value;      // NUMBER/BAR value, ICON glyph
+        const char* text;   // LABEL text, must stay valid while the layout is used
+    };
+
+    LCD& _lcd;
+    uint8_t _cols, _rows;
+    Region _regions[LCD_LAYOUT_MAX_REGIONS];
+    uint8_t _count = 0;
+    uint8_t _shown[LCD_LAYOUT_MAX_CELLS];   // cells last sent to the display
+    uint8_t _known[LCD_LAYOUT_MAX_CELLS];   // 1 when the matching _shown cell is valid
+    size_t _bytes = 0;
+
+    int addRegion(RegionType type, uint8_t x, uint8_t y, uint8_t width);
+    void render(const Region& r, uint8_t* cells);
+    void update(int id);
+};
+
+#endif // LCD_LAYOUT_H
@@ -0,0 +1,91 @@
+/**
+ * @file lcd_mirror.hpp
+ * @brief Mirrors the display content to a remote viewer as a compact delta stream.
+ *
+ * An LCDMirror compares what the panel shows, as tracked by the LCD class, with what it
+ * has already sent, and emits only the differences over a byte oriented transport such as
+ * a UART. flush() touches no display pin: it reads the RAM copy of the controller state,
+ * so it can run after every update without delaying the display. Tools/lcd_mirror.py
+ * decodes the stream on the host and shows the screen.
+ *
+ * The stream is a sequence of packets:
+ *
+ * | Byte | Content                                                         |
+ * |------|-----------------------------------------------------------------|
+ * | 0    | LCD_MIRROR_SYNC                                                 |
+ * | 1    | type                                                            |
+ * | 2    | payload length n                                                |
+ * | 3..  | payload                                                         |
+ * | 3+n  | sum of the type, length and payload bytes, modulo 256           |
+ *
+ * | Type | Payload                                                         |
+ * |------|-----------------------------------------------------------------|
+ * | 'G'  | cols, rows: geometry, the viewer clears its screen              |
+ * | 'C'  | row, col, codes: a run of cells                                 |
+ * | 'R'  | address, patterns: CGRAM bytes from the address on              |
+ * | 'M'  | display control bits, entry mode bits, cursor col, cursor row   |
+ * | 'E'  | sequence number: end of an update, the viewer shows the screen  |
+ *
+ * The first flush, and the first after invalidate(), sends the whole state, starting with
+ * 'G'. A viewer that connects late or sees a bad checksum waits for the next 'G', so call
+ * invalidate() when a viewer connects or now and then on a lossy link.
+ */
+
+#ifndef LCD_MIRROR_H
+#define LCD_MIRROR_H
+
+#include "lcd.hpp"
+
+// First byte of every packet.
+#define LCD_MIRROR_SYNC 0xA5
+
+// Largest display mirrored (40x4).
+#ifndef LCD_MIRROR_MAX_CELLS
+#define LCD_MIRROR_MAX_CELLS 160
+#endif
+
+// Unchanged cells between two changed ones that are sent rather than starting a new run.
+// A run costs 6 bytes of framing.
+#ifndef LCD_MIRROR_GAP
+#define LCD_MIRROR_GAP 5
+#endif
+
+/**
+ * @brief Sends one packet over the transport.
+ *
+ * @param data The packet.
+ * @param len The packet length.
+ * @param context The context given to the LCDMirror constructor.
+ * @return true if the whole packet was taken, false if there is no room for it now.
+ */
+typedef bool (*LCDMirrorWrite)(const uint8_t* data, size_t len, void* context);
+
+class LCDMirror {
+public:
+    LCDMirror(LCD& lcd, LCDMirrorWrite write, void* context);
+    size_t flush(void);
+    void invalidate(void) { _valid = false; }
+    uint32_t bytesSent(void) const { return _bytes; }
+
+private:
+    LCD& _lcd;
+    LCDMirrorWrite _write;
+    void* _context;
+    bool _valid = false;            // the viewer has all of the state below
+    uint8_t _cols = 0, _rows = 0;
+    uint8_t _cells[LCD_MIRROR_MAX_CELLS];
+    uint8_t _cgram[64];
+    uint8_t _cg_defined = 0;
+    uint8_t _mode[4];               // display control, entry mode, cursor col, cursor row
+    uint8_t _seq = 0;
+    bool _end_pending = false;      // an update was sent without its 'E'
+    uint32_t _bytes = 0;
+    uint8_t _packet[3 + 65 + 1];    // largest payload: CGRAM address and 64 patterns
+
+    uint8_t visible(uint8_t x, uint8_t y) const;
+    bool send(uint8_t type, const uint8_t* head, uint8_t head_len, const uint8_t* data, uint8_t len);
+    bool flushCgram(size_t& sent);
+    bool flushCells(size_t& sent);
+};
+
+#endif // LCD_MIRROR_H
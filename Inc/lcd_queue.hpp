@@ -0,0 +1,95 @@
+/**
+ * @file lcd_queue.hpp
+ * @brief Multi-producer access to one LCD through a lock-free operation queue.
+ *
+ * The LCD class is not thread safe: two tasks printing at the same time interleave the
+ * nibbles on the 4-bit bus. With LCDQueue, any number of tasks or interrupts submit
+ * complete operations (a positioned print, a control change) into a bounded lock-free
+ * queue, and a single bus owner task executes them in order with process(). Each
+ * operation is executed as a whole, and no lock is held while the bus owner waits for
+ * the display.
+ *
+ * The queue uses one sequence number per slot (bounded MPMC queue by D. Vyukov), which
+ * needs only compare-and-swap on a 32-bit word, available on Cortex-M3 and later.
+ */
+
+#ifndef LCD_QUEUE_H
+#define LCD_QUEUE_H
+
+#include "lcd.hpp"
+#include <atomic>
+
+// Number of queued operations, must be a power of two.
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 16
+#endif
+
+// Longest text carried by one operation.
+#ifndef LCD_QUEUE_TEXT_MAX
+#define LCD_QUEUE_TEXT_MAX 40
+#endif
+
+static_assert((LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)) == 0, "LCD_QUEUE_SIZE must be a power of two");
+
+/**
+ * @brief One complete display operation.
+ */
+struct LCDOperation {
+    enum Type : uint8_t {
+        PRINT_AT,       // text at x, y
+        PRINT,          // text at the current cursor position
+        CLEAR,
+        HOME,
+        DISPLAY_ON,
+        DISPLAY_OFF,
+        CURSOR_ON,
+        CURSOR_OFF,
+        CREATE_CHAR     // 8 rows in text, location in x
+    };
+
+    Type type;
+    uint8_t x, y;
+    uint8_t len;
+    uint8_t text[LCD_QUEUE_TEXT_MAX];
+};
+
+class LCDQueue {
+public:
+    LCDQueue(LCD& lcd);
+
+    // Setup, before any producer runs
+    void setNotify(void (*notify)(void* context), void* context);
+
+    // Producer side, safe from any task or interrupt
+    bool submit(const LCDOperation& op);
+    bool printAt(uint8_t x, uint8_t y, const char* text);
+    bool print(const char* text);
+    bool clear(void);
+    bool home(void);
+    bool display(bool on);
+    bool cursor(bool on);
+    bool createChar(uint8_t location, const uint8_t charmap[]);
+    uint32_t dropped(void) const { return _dropped.load(std::memory_order_relaxed); }
+
+    // Consumer side, only from the task that owns the display
+    size_t process(size_t max = LCD_QUEUE_SIZE);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        LCDOperation op;
+    };
+
+    LCD& _lcd;
+    Slot _slots[LCD_QUEUE_SIZE];
+    std::atomic<uint32_t> _enqueue_pos;
+    uint32_t _dequeue_pos = 0;
+    std::atomic<uint32_t> _dropped;
+    void (*_notify)(void* context) = nullptr;
+    void* _notify_context = nullptr;
+
+    bool submitText(LCDOperation::Type type, uint8_t x, uint8_t y, const char* text);
+    void execute(const LCDOperation& op);
+};
+
+#endif // LCD_QUEUE_H
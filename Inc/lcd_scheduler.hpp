@@ -0,0 +1,83 @@
+/**
+ * @file lcd_scheduler.hpp
+ * @brief Rate limited display updates with latest-value-wins coalescing.
+ *
+ * Producers post new text for a field as often as they like. Only the latest text of each
+ * field is kept, and poll() flushes the changed fields at a fixed frame rate, within a bus
+ * time budget per frame. Fields that do not fit in the budget stay pending and are served
+ * first in the next frame, so the display cost is bounded no matter how fast the
+ * producers run. The first changed field of a frame is flushed even when it does not fit,
+ * so a budget that is too small slows the updates down but never stops them.
+ *
+ * The fields are label regions of an LCDLayout, so a flush only sends changed cells.
+ */
+
+#ifndef LCD_SCHEDULER_H
+#define LCD_SCHEDULER_H
+
+#include "lcd_layout.hpp"
+#include <atomic>
+
+// Widest field, in characters.
+#ifndef LCD_SCHEDULER_FIELD_MAX
+#define LCD_SCHEDULER_FIELD_MAX 20
+#endif
+
+// Bus time assumed per byte until a real one has been measured, a calibrated display with
+// margin. The first field of a frame is always flushed, so on a slower display the
+// measured time replaces this after one field.
+#ifndef LCD_SCHEDULER_BYTE_US
+#define LCD_SCHEDULER_BYTE_US 100
+#endif
+
+// Default bus time budget of a frame.
+#ifndef LCD_SCHEDULER_BUDGET_US
+#define LCD_SCHEDULER_BUDGET_US 5000
+#endif
+
+static_assert((1 + LCD_SCHEDULER_FIELD_MAX) * LCD_SCHEDULER_BYTE_US <= LCD_SCHEDULER_BUDGET_US,
+              "LCD_SCHEDULER_BUDGET_US must cover the widest field at LCD_SCHEDULER_BYTE_US");
+
+class LCDScheduler {
+public:
+    LCDScheduler(LCDLayout& layout, uint32_t (*clock_us)(void) = nullptr);
+    int addField(uint8_t x, uint8_t y, uint8_t width);
+    void post(int field, const char* text);
+    int postFormatted(int field, const char* format, ...);
+    void setFrameRate(uint16_t fps);
+    void setBudget(uint32_t us);
+    bool poll(void);
+
+    uint32_t lastFrameTime(void) const { return _last_frame_us; }
+    uint32_t maxFrameTime(void) const { return _max_frame_us; }
+    uint32_t postsCoalesced(void) const { return _coalesced.load(std::memory_order_relaxed); }
+
+private:
+    struct Field {
+        int region;
+        uint8_t width;
+        std::atomic<uint32_t> sequence;         // odd while a producer is writing
+        std::atomic<bool> dirty;
+        char pending[LCD_SCHEDULER_FIELD_MAX + 1];
+        char shown[LCD_SCHEDULER_FIELD_MAX + 1];
+    };
+
+    LCDLayout& _layout;
+    uint32_t (*_clock_us)(void);
+    Field _fields[LCD_LAYOUT_MAX_REGIONS];
+    uint8_t _count = 0;
+    uint8_t _next = 0;                  // field served first in the next frame
+    uint32_t _period_us = 100000;       // 10 frames per second
+    uint32_t _budget_us = LCD_SCHEDULER_BUDGET_US;
+    uint32_t _byte_us = LCD_SCHEDULER_BYTE_US;
+    bool _byte_us_measured = false;
+    uint32_t _frame_start = 0;
+    uint32_t _last_frame_us = 0;
+    uint32_t _max_frame_us = 0;
+    std::atomic<uint32_t> _coalesced;
+
+    bool takePending(Field& f);
+    static uint32_t tickClock(void);
+};
+
+#endif // LCD_SCHEDULER_H
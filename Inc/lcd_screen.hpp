@@ -0,0 +1,132 @@
+/**
+ * @file lcd_screen.hpp
+ * @brief Screen templates built at compile time and kept in flash.
+ *
+ * A screen template is the fixed text of a whole screen with field slots marked by runs
+ * of LCD_SCREEN_FIELD_CHAR. lcdScreen() turns it into a constant table at compile time,
+ * checking that there is one string per row and that every row has exactly the template
+ * width, and numbers the field slots in reading order:
+ *
+ * @code
+ * enum { FIELD_TEMP, FIELD_RPM };
+ * constexpr auto mainScreen = lcdScreen<16, 2>(
+ *     "Temp: ####  C   ",
+ *     "RPM:  #####     ");
+ *
+ * LCDScreenView view(lcd);
+ * view.enter(mainScreen);                     // fixed text, sent once
+ * view.setFormatted(FIELD_TEMP, "%4d", temp); // only the 4 cells of the field
+ * @endcode
+ *
+ * Declared constexpr at namespace scope, the table lives in flash and no RAM copy or
+ * std::string is needed to show the screen. Needs C++14.
+ */
+
+#ifndef LCD_SCREEN_H
+#define LCD_SCREEN_H
+
+#include "lcd.hpp"
+
+// Marks the cells of a field slot in a template. Override before including to change.
+#ifndef LCD_SCREEN_FIELD_CHAR
+#define LCD_SCREEN_FIELD_CHAR '#'
+#endif
+
+// Maximum number of field slots in one template.
+#ifndef LCD_SCREEN_MAX_FIELDS
+#define LCD_SCREEN_MAX_FIELDS 8
+#endif
+
+struct LCDField {
+    uint8_t x, y, width;
+};
+
+template <uint8_t Cols, uint8_t Rows>
+struct LCDScreen {
+    char text[Rows][Cols];      // fixed text, field slots hold spaces
+    LCDField fields[LCD_SCREEN_MAX_FIELDS];
+    uint8_t count;              // number of field slots
+};
+
+namespace lcd_screen_detail {
+    // Not constexpr: reaching it while building a template at compile time makes the build
+    // fail. A template built at run time keeps the extra marker cells as plain spaces.
+    inline void tooManyFields(void) {}
+
+    template <size_t Len>
+    constexpr bool lengthsMatch() { return true; }
+
+    template <size_t Len, size_t N, size_t... Rest>
+    constexpr bool lengthsMatch() { return N == Len && lengthsMatch<Len, Rest...>(); }
+}
+
+/**
+ * @brief Builds a screen template from one string per row.
+ *
+ * Adjacent marker cells form one field, so two fields need at least one other character
+ * between them. Declare the result constexpr so that it is built, and checked, at compile
+ * time. Built at run time, fields past LCD_SCREEN_MAX_FIELDS are not reported and their
+ * cells stay plain spaces.
+ *
+ * @tparam Cols The template width, up to the 40 characters of a DDRAM line.
+ * @tparam Rows The number of rows, 1 to 4.
+ * @param rows The rows, each exactly Cols characters long.
+ * @return The template.
+ */
+template <uint8_t Cols, uint8_t Rows, size_t... N>
+constexpr LCDScreen<Cols, Rows> lcdScreen(const char (&... rows)[N]) {
+    static_assert(Cols >= 1 && Cols <= 40, "a screen template is 1 to 40 columns wide");
+    static_assert(Rows >= 1 && Rows <= 4, "a screen template has 1 to 4 rows");
+    static_assert(sizeof...(N) == Rows, "give one string per row");
+    static_assert(lcd_screen_detail::lengthsMatch<Cols + 1, N...>(), "every row must have exactly Cols characters");
+
+    LCDScreen<Cols, Rows> screen = {};
+    const char* text[] = { rows... };
+    for (uint8_t y = 0; y < Rows; y++) {
+        bool open = false;      // the previous cell belongs to the last field
+        for (uint8_t x = 0; x < Cols; x++) {
+            char c = text[y][x];
+            if (c != LCD_SCREEN_FIELD_CHAR) {
+                screen.text[y][x] = c;
+                open = false;
+                continue;
+            }
+            screen.text[y][x] = ' ';
+            if (open) {
+                screen.fields[screen.count - 1].width++;
+            } else if (screen.count == LCD_SCREEN_MAX_FIELDS) {
+                lcd_screen_detail::tooManyFields();
+            } else {
+                screen.fields[screen.count++] = LCDField{ x, y, 1 };
+                open = true;
+            }
+        }
+    }
+    return screen;
+}
+
+class LCDScreenView {
+public:
+    explicit LCDScreenView(LCD& lcd);
+
+    /**
+     * @brief Shows a screen template, see enterText().
+     */
+    template <uint8_t Cols, uint8_t Rows>
+    bool enter(const LCDScreen<Cols, Rows>& screen) {
+        return enterText(&screen.text[0][0], Cols, Rows, screen.fields, screen.count);
+    }
+
+    bool set(uint8_t field, const char* value);
+    int setFormatted(uint8_t field, const char* format, ...);
+    uint8_t fieldCount(void) const { return _count; }
+
+private:
+    LCD& _lcd;
+    const LCDField* _fields = nullptr;
+    uint8_t _count = 0;
+
+    bool enterText(const char* text, uint8_t cols, uint8_t rows, const LCDField* fields, uint8_t count);
+};
+
+#endif // LCD_SCREEN_H
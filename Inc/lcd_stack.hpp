@@ -0,0 +1,74 @@
+/**
+ * @file lcd_stack.hpp
+ * @brief Screen stack with snapshots, for menu navigation without redraws.
+ *
+ * Going back to a menu screen normally means clear(), which stalls for about 2 ms, and
+ * printing the whole screen again. An LCDScreenStack saves a snapshot of the screen on
+ * push(): the cells, the custom characters, the cursor position and the display and entry
+ * modes. pop() goes back by sending only what differs from the screen shown, with a cursor
+ * address command only where changed cells are not contiguous:
+ *
+ * @code
+ * LCDScreenStack stack(lcd);
+ * stack.push();           // entering a submenu
+ * drawSubmenu();          // ideally with show() or showFrame(), see below
+ * ...
+ * stack.pop();            // back: the differences only
+ * @endcode
+ *
+ * Menus that are entered often can keep their own LCDSnapshot, taken once with capture(),
+ * and enter with push(&snapshot), so going forward is a diff as well. showFrame() brings
+ * the screen to any content given as a frame of cells the same way.
+ *
+ * The differences are found against the content the LCD class knows it has sent, so text
+ * printed by any other means is taken into account.
+ */
+
+#ifndef LCD_STACK_H
+#define LCD_STACK_H
+
+#include "lcd.hpp"
+
+// Screens a stack holds. Override before including to change.
+#ifndef LCD_STACK_DEPTH
+#define LCD_STACK_DEPTH 4
+#endif
+
+// Largest display handled by a screen stack (20x4 or 40x2).
+#define LCD_STACK_MAX_CELLS 80
+
+/**
+ * @brief Everything needed to bring a screen back.
+ */
+struct LCDSnapshot {
+    uint8_t cells[LCD_STACK_MAX_CELLS];     // row by row, cols * rows used
+    uint8_t cgram[64];                      // custom character patterns
+    uint8_t cg_defined;                     // locations of cgram that are defined, one bit each
+    uint8_t displaycontrol;                 // display, cursor and blink bits
+    uint8_t displaymode;                    // entry mode bits
+    uint8_t col, row;                       // cursor position
+    uint8_t ctrl, address;                  // controller holding the cursor and its DDRAM address
+    uint8_t cols, rows;                     // geometry of the display it was taken from
+};
+
+class LCDScreenStack {
+public:
+    explicit LCDScreenStack(LCD& lcd);
+    bool capture(LCDSnapshot& snapshot);
+    size_t show(const LCDSnapshot& snapshot);
+    size_t showFrame(const uint8_t* cells);
+    bool push(const LCDSnapshot* next = nullptr);
+    bool pop(void);
+    uint8_t depth(void) const { return _depth; }
+
+private:
+    LCD& _lcd;
+    LCDSnapshot _stack[LCD_STACK_DEPTH];
+    uint8_t _depth = 0;
+
+    bool fits(void) const;
+    uint8_t shown(uint8_t x, uint8_t y);
+    size_t showCgram(const LCDSnapshot& snapshot);
+};
+
+#endif // LCD_STACK_H
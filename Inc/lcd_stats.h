@@ -0,0 +1,51 @@
+/**
+ * @file lcd_stats.h
+ * @brief Performance counters of an LCD instance, shared by the C++ class and the C wrapper.
+ *
+ * The counters are only maintained when the library is built with LCD_STATS set to 1.
+ * The setting changes the size of the LCD class, so it must be the same for every file
+ * of the project, typically given as a compiler flag (-DLCD_STATS=1).
+ */
+
+#ifndef LCD_STATS_H
+#define LCD_STATS_H
+
+#include <stdint.h>
+
+#ifndef LCD_STATS
+#define LCD_STATS 0
+#endif
+
+// Public methods with their own call statistics
+enum LCD_StatMethod {
+    LCD_STAT_BEGIN,
+    LCD_STAT_PRINT,         // printLCD, printFormatted, printRows, putch, writeCells
+    LCD_STAT_SETCURSOR,
+    LCD_STAT_CREATECHAR,
+    LCD_STAT_CLEAR,         // clear, home
+    LCD_STAT_CONTROL,       // display, cursor, scroll and entry mode changes
+    LCD_STAT_FLIP,
+    LCD_STAT_RESYNC,        // resync, scrub
+    LCD_STAT_METHODS
+};
+
+// Latency histogram: bucket i counts calls taking less than 4^(i+1) microseconds,
+// the last bucket counts everything slower.
+#define LCD_STAT_BUCKETS 8
+
+typedef struct {
+    uint32_t calls;
+    uint32_t total_us;
+    uint32_t max_us;
+    uint32_t histogram[LCD_STAT_BUCKETS];
+} LCD_MethodStats;
+
+typedef struct {
+    uint32_t commands;      // command bytes sent
+    uint32_t data_bytes;    // data bytes sent
+    uint32_t en_pulses;     // enable pulses, two per byte in 4-bit mode
+    uint32_t stall_us;      // time spent waiting in delays
+    LCD_MethodStats method[LCD_STAT_METHODS];
+} LCD_Stats;
+
+#endif /* LCD_STATS_H */
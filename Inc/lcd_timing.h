@@ -0,0 +1,22 @@
+/**
+ * @file lcd_timing.h
+ * @brief Timing profile of an LCD controller, shared by the C++ class and the C wrapper.
+ *
+ * A profile is measured by LCD::calibrate() and can be stored, for example in flash or in
+ * backup registers, and given back with LCD::setTiming() on later boots to skip the
+ * calibration.
+ */
+
+#ifndef LCD_TIMING_H
+#define LCD_TIMING_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t command_us;    // execution time of a command, margin included
+    uint16_t data_us;       // execution time of a data write, margin included
+    uint16_t clear_us;      // execution time of clear and return home, margin included
+    uint8_t valid;          // 1 when the profile is in use, 0 for the worst case delays
+} LCD_Timing;
+
+#endif /* LCD_TIMING_H */
@@ -0,0 +1,68 @@
+/**
+ * @file lcd_trace.hpp
+ * @brief Recording of the LCD bus signals for offline timing analysis.
+ *
+ * When the library is built with LCD_TRACE set to 1, an LCD with a trace attached records
+ * every change of its RS, RW, EN and data pins with a timestamp. Reads are recorded too:
+ * LCD_TRACE_DIR shows when the data pins are inputs, and while they are, the data signals
+ * carry the levels read from the controller, such as the busy flag on D7. The trace can be written
+ * as a VCD file for GTKWave, or exported in a compact binary form that replay() turns
+ * back into pin changes, for example to drive a simulated controller.
+ *
+ * LCD_TRACE changes the size of the LCD class, so it must be the same for every file of
+ * the project, typically given as a compiler flag (-DLCD_TRACE=1).
+ */
+
+#ifndef LCD_TRACE_H
+#define LCD_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LCD_TRACE
+#define LCD_TRACE 0
+#endif
+
+// Signal numbers
+#define LCD_TRACE_RS 0
+#define LCD_TRACE_RW 1
+#define LCD_TRACE_EN 2
+#define LCD_TRACE_D0 3      // D0-D7 are LCD_TRACE_D0 + bit
+#define LCD_TRACE_EN2 11    // enable of the second controller on 40x4 panels
+#define LCD_TRACE_DIR 12    // 1 while the data pins are inputs, driven by the controller
+#define LCD_TRACE_SIGNALS 13
+
+struct LCDTraceEvent {
+    uint32_t time;      // clock ticks
+    uint8_t signal;
+    uint8_t level;
+};
+
+class LCDTrace {
+public:
+    LCDTrace(LCDTraceEvent* buffer, size_t capacity,
+             uint32_t (*clock)(void) = nullptr, uint32_t clock_hz = 0);
+    void record(uint8_t signal, uint8_t level);
+    void reset(void);
+
+    size_t count(void) const { return _count; }
+    uint32_t dropped(void) const { return _dropped; }
+    const LCDTraceEvent* events(void) const { return _events; }
+
+    size_t writeVcd(void (*out)(const char* text, size_t len, void* context), void* context) const;
+    size_t exportBinary(uint8_t* out, size_t len) const;
+    static size_t replay(const uint8_t* data, size_t len,
+                         void (*pin)(uint64_t time_ns, uint8_t signal, uint8_t level, void* context),
+                         void* context);
+
+private:
+    LCDTraceEvent* _events;
+    size_t _capacity;
+    size_t _count = 0;
+    uint32_t _dropped = 0;
+    uint32_t (*_clock)(void);
+    uint32_t _clock_hz;
+    uint8_t _level[LCD_TRACE_SIGNALS];      // last recorded level, 0xFF when unknown
+};
+
+#endif // LCD_TRACE_H
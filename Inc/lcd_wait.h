@@ -0,0 +1,74 @@
+/**
+ * @file lcd_wait.h
+ * @brief Low-power waits of an LCD instance, shared by the C++ class and the C wrapper.
+ *
+ * The LCD waits for the controller between bytes, and for milliseconds during Begin()
+ * and, without a timing profile, after each byte. By default these waits spin on the
+ * cycle counter or in HAL_Delay() with the core at full clock. A sleep function given to
+ * LCD::setWaitStrategy() is called for waits of at least a threshold instead, and can
+ * put the core to sleep until a timer wakes it; shorter waits, like the enable pulse, are
+ * still spun. A typical sleep function arms a low-power timer for the given time and
+ * executes WFI:
+ *
+ * @code
+ * static uint32_t lcdSleep(uint32_t us, void* context) {
+ *     uint32_t ticks = us / 31;                   // LPTIM on LSE, 32768 Hz
+ *     if (!ticks) return 0;
+ *     HAL_LPTIM_SetOnce_Start_IT(&hlptim1, 0xFFFF, ticks);
+ *     HAL_SuspendTick();
+ *     HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+ *     HAL_ResumeTick();
+ *     uint32_t slept = HAL_LPTIM_ReadCounter(&hlptim1) * 31;
+ *     HAL_LPTIM_SetOnce_Stop_IT(&hlptim1);
+ *     return slept;
+ * }
+ * @endcode
+ *
+ * The function may return early, after any interrupt: the LCD sleeps again or spins for
+ * what is left. It returns the time it slept, which the LCD trusts when the cycle counter
+ * stopped during the sleep, as it does in stop modes.
+ */
+
+#ifndef LCD_WAIT_H
+#define LCD_WAIT_H
+
+#include <stdint.h>
+
+// Default threshold: shorter waits are spun, since sleeping and waking up takes a few
+// microseconds and a timer setup.
+#ifndef LCD_SLEEP_MIN_US
+#define LCD_SLEEP_MIN_US 50
+#endif
+
+/**
+ * @brief Sleeps the core for at most the given time.
+ *
+ * @param us The time to sleep in microseconds, at least the threshold.
+ * @param context The context given with the function.
+ * @return The time slept in microseconds.
+ */
+typedef uint32_t (*LCD_SleepFunc)(uint32_t us, void* context);
+
+typedef struct {
+    uint32_t sleep_us;      // time spent in the sleep function
+    uint32_t spin_us;       // time spent spinning at full clock
+    uint32_t sleeps;        // waits that slept
+    uint32_t spins;         // waits that spun, entirely or for the rest after a sleep
+} LCD_WaitStats;
+
+/**
+ * @brief Estimates the energy the core used in the waits.
+ *
+ * @param stats The wait counters.
+ * @param run_ua The supply current of the running core in microamperes.
+ * @param sleep_ua The supply current while sleeping in microamperes.
+ * @param supply_mv The supply voltage in millivolts.
+ * @return The energy in microjoules.
+ */
+static inline uint32_t LCD_waitEnergy(const LCD_WaitStats* stats, uint32_t run_ua, uint32_t sleep_ua,
+                                      uint32_t supply_mv) {
+    uint64_t charge = (uint64_t)stats->spin_us * run_ua + (uint64_t)stats->sleep_us * sleep_ua;  // pC
+    return (uint32_t)(charge * supply_mv / 1000000000ULL);
+}
+
+#endif /* LCD_WAIT_H */
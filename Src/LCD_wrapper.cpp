@@ -5,36 +5,60 @@
 
 #include "LCD_wrapper.h"
 #include "LCD.hpp"
+#include <new>
+#include <cstring>
 
 /**
- * @struct LCD_Wrapper
- * @brief Wrapper structure to hold an instance of the LCD class.
+ * @brief Static storage for the LCD objects created through the wrapper, so that no
+ *        heap is needed.
  */
-struct LCD_Wrapper {
-    LCD* lcd_cpp; /**< Pointer to the LCD object */
-};
+alignas(LCD) static unsigned char lcd_pool[LCD_MAX_INSTANCES][sizeof(LCD)];
+static bool lcd_pool_used[LCD_MAX_INSTANCES];
 
 /**
  * @brief Create an LCD object and return a pointer to it.
  *
- * This function creates an LCD object by instantiating the LCD class.
- * The provided port data and control pins are used to initialize the LCD.
- * Returns a pointer to the created LCD object.
+ * This function constructs an LCD object in a free slot of a static pool of
+ * LCD_MAX_INSTANCES objects. The provided port data and control pins are used
+ * to initialize the LCD. Returns a pointer to the created LCD object.
  *
  * @param portdata Pointer to the data port
  * @param portctrlRW Pointer to the RW control port
  * @param portctrlEN Pointer to the EN control port
  * @param portctrlRS Pointer to the RS control port
  *
- * @return Pointer to the created LCD object
+ * @return Pointer to the created LCD object, or NULL if all slots are in use
  */
 LCD* LCD_create(void* portdata, void* portctrlRW, void* portctrlEN, void* portctrlRS) {
-    LCD_Wrapper* lcd_wrapper = new LCD_Wrapper;
-    lcd_wrapper->lcd_cpp = new LCD(static_cast<GPIO_TypeDef*>(portdata),
-                                    static_cast<GPIO_TypeDef*>(portctrlRW),
-                                    static_cast<GPIO_TypeDef*>(portctrlEN),
-                                    static_cast<GPIO_TypeDef*>(portctrlRS));
-    return lcd_wrapper->lcd_cpp;
+    for (size_t i = 0; i < LCD_MAX_INSTANCES; i++) {
+        if (lcd_pool_used[i]) continue;
+        lcd_pool_used[i] = true;
+        return new (lcd_pool[i]) LCD(static_cast<GPIO_TypeDef*>(portdata),
+                                     static_cast<GPIO_TypeDef*>(portctrlRW),
+                                     static_cast<GPIO_TypeDef*>(portctrlEN),
+                                     static_cast<GPIO_TypeDef*>(portctrlRS));
+    }
+    return NULL;
+}
+
+/**
+ * @brief Destroy an LCD object created by LCD_create.
+ *
+ * This function destroys the LCD object and returns its slot to the pool, so a
+ * new display can be created in it. The display itself keeps showing its content.
+ *
+ * @param lcd Pointer to the LCD object, NULL is ignored
+ *
+ * @return None
+ */
+void LCD_destroy(LCD* lcd) {
+    for (size_t i = 0; i < LCD_MAX_INSTANCES; i++) {
+        if (lcd_pool_used[i] && lcd == reinterpret_cast<LCD*>(lcd_pool[i])) {
+            lcd->~LCD();
+            lcd_pool_used[i] = false;
+            return;
+        }
+    }
 }
 
 /**
@@ -54,6 +78,22 @@ void LCD_initCtrlPins(LCD* lcd, uint16_t ctrlRW, uint16_t ctrlEN, uint16_t ctrlR
     lcd->initCtrlPins(ctrlRW, ctrlEN, ctrlRS);
 }
 
+/**
+ * @brief Initialize the second enable pin of a 40x4 LCD.
+ *
+ * This function sets the enable pin of the second controller, which drives
+ * rows 2 and 3 of 40x4 displays.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param portctrlEN2 Pointer to the second EN control port
+ * @param ctrlEN2 The control pin for the second enable signal
+ *
+ * @return None
+ */
+void LCD_initSecondEnable(LCD* lcd, void* portctrlEN2, uint16_t ctrlEN2) {
+    lcd->initSecondEnable(static_cast<GPIO_TypeDef*>(portctrlEN2), ctrlEN2);
+}
+
 /**
  * @brief Initialize data pins of the LCD.
  *
@@ -83,8 +123,7 @@ void LCD_initDataPins(LCD* lcd, uint16_t val4, uint16_t val5, uint16_t val6, uin
  * @return None
  */
 void LCD_print(LCD* lcd, const char* message) {
-    std::string str(message);
-    lcd->printLCD(str);
+    lcd->writeCells(reinterpret_cast<const uint8_t*>(message), strlen(message));
 }
 
 /**
@@ -112,13 +151,43 @@ int LCD_printFormatted(LCD* lcd, const char* format, ...) {
 
     // Print the formatted string to the LCD display
     if (n > 0) {
-        std::string str(buffer);
-        lcd->printLCD(str);
+        lcd->writeCells(reinterpret_cast<const uint8_t*>(buffer), strlen(buffer));
     }
 
     return n;
 }
 
+/**
+ * @brief Print a message within the rows of the LCD display.
+ *
+ * This function prints a message from the current cursor position and wraps,
+ * clips or ellipsizes it at the end of each row, depending on the mode.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param message The message to be printed on the display
+ * @param mode LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS
+ *
+ * @return The number of characters printed
+ */
+int LCD_printRows(LCD* lcd, const char* message, int mode) {
+    return (int)lcd->printRows(message, strlen(message), mode);
+}
+
+/**
+ * @brief Write a whole screen to the LCD display.
+ *
+ * This function writes cols * rows character codes, row by row. On displays with
+ * two controllers both halves are written in turn.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param cells The character codes
+ *
+ * @return The number of characters written
+ */
+int LCD_writeFrame(LCD* lcd, const uint8_t* cells) {
+    return (int)lcd->writeFrame(cells);
+}
+
 /**
  * @brief Write a character to the LCD display.
  *
@@ -181,6 +250,23 @@ void LCD_createChar(LCD* lcd, uint8_t location, uint8_t charmap[]) {
     lcd->createChar(location, charmap);
 }
 
+/**
+ * @brief Create several custom characters on the LCD display.
+ *
+ * This function uploads a set of character patterns with a single CGRAM
+ * address command, for example a glyph table generated by lcd_glyph.hpp.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param first The location (0-7) of the first custom character
+ * @param charmaps The character map data, 8 bytes per character
+ * @param count The number of custom characters
+ *
+ * @return None
+ */
+void LCD_createChars(LCD* lcd, uint8_t first, const uint8_t charmaps[], uint8_t count) {
+    lcd->createChars(first, charmaps, count);
+}
+
 /**
  * @brief Disable autoscroll on the LCD display.
  *
@@ -348,3 +434,164 @@ void LCD_clear(LCD* lcd) {
 void LCD_home(LCD* lcd) {
     lcd->home();
 }
+
+/**
+ * @brief Enable double buffered drawing on the LCD display.
+ *
+ * This function makes all following drawing go to the hidden page in DDRAM.
+ * The page is shown with LCD_flipPage.
+ *
+ * @param lcd Pointer to the LCD object
+ *
+ * @return 1 if page flipping is active, 0 if the display is too wide for two pages
+ */
+int LCD_beginPageFlip(LCD* lcd) {
+    return lcd->beginPageFlip() ? 1 : 0;
+}
+
+/**
+ * @brief Disable double buffered drawing on the LCD display.
+ *
+ * This function turns page flipping off and shows page 0 again.
+ *
+ * @param lcd Pointer to the LCD object
+ *
+ * @return None
+ */
+void LCD_endPageFlip(LCD* lcd) {
+    lcd->endPageFlip();
+}
+
+/**
+ * @brief Show the page drawn since the last flip.
+ *
+ * This function shifts the display window to the page that has been drawn,
+ * without ever showing a mix of the two pages.
+ *
+ * @param lcd Pointer to the LCD object
+ *
+ * @return None
+ */
+void LCD_flipPage(LCD* lcd) {
+    lcd->flipPage();
+}
+
+/**
+ * @brief Take a snapshot of the performance counters of the LCD display.
+ *
+ * This function copies the command, data byte, enable pulse and stall time counters,
+ * and the call statistics of each public method.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param stats Receives the counters
+ *
+ * @return None
+ */
+void LCD_getStats(LCD* lcd, LCD_Stats* stats) {
+    lcd->getStats(stats);
+}
+
+/**
+ * @brief Reset the performance counters of the LCD display.
+ *
+ * @param lcd Pointer to the LCD object
+ *
+ * @return None
+ */
+void LCD_resetStats(LCD* lcd) {
+    lcd->resetStats();
+}
+
+/**
+ * @brief Set the function that sleeps the core through the waits of the LCD display.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param sleep The sleep function, or NULL to spin
+ * @param context Passed to the sleep function
+ * @param min_sleep_us Shortest wait that sleeps, 0 for the default
+ *
+ * @return None
+ */
+void LCD_setWaitStrategy(LCD* lcd, LCD_SleepFunc sleep, void* context, uint32_t min_sleep_us) {
+    lcd->setWaitStrategy(sleep, context, min_sleep_us ? min_sleep_us : LCD_SLEEP_MIN_US);
+}
+
+/**
+ * @brief Take a snapshot of the wait counters of the LCD display.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param stats Receives the time slept and spun
+ *
+ * @return None
+ */
+void LCD_getWaitStats(LCD* lcd, LCD_WaitStats* stats) {
+    lcd->getWaitStats(stats);
+}
+
+/**
+ * @brief Calibrate the timing of the LCD display.
+ *
+ * This function measures the command, data and clear execution times with the
+ * busy flag and switches the display to the measured timing profile.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param margin_percent Safety margin added to the measured times
+ *
+ * @return 1 if the measured profile is in use, 0 otherwise
+ */
+int LCD_calibrate(LCD* lcd, uint8_t margin_percent) {
+    return lcd->calibrate(margin_percent) ? 1 : 0;
+}
+
+/**
+ * @brief Get the timing profile of the LCD display.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param timing Receives the profile
+ *
+ * @return None
+ */
+void LCD_getTiming(LCD* lcd, LCD_Timing* timing) {
+    lcd->getTiming(timing);
+}
+
+/**
+ * @brief Set the timing profile of the LCD display.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param timing The profile, as measured earlier by LCD_calibrate
+ *
+ * @return None
+ */
+void LCD_setTiming(LCD* lcd, const LCD_Timing* timing) {
+    lcd->setTiming(timing);
+}
+
+/**
+ * @brief Resynchronize the bus of the LCD display.
+ *
+ * This function checks that the 4-bit interface is still aligned and, when a glitch
+ * has made it lose alignment, recovers it and repairs the cells that were affected.
+ *
+ * @param lcd Pointer to the LCD object
+ *
+ * @return 1 if the bus was resynchronized, 0 if it was found aligned
+ */
+int LCD_resync(LCD* lcd) {
+    return lcd->resync() ? 1 : 0;
+}
+
+/**
+ * @brief Scrub the contents of the LCD display.
+ *
+ * This function reads back the next few cells of DDRAM and CGRAM and rewrites the
+ * ones that no longer hold what was sent, within the given time budget.
+ *
+ * @param lcd Pointer to the LCD object
+ * @param budget_us The maximum time the call may take
+ *
+ * @return The number of cells rewritten
+ */
+size_t LCD_scrub(LCD* lcd, uint32_t budget_us) {
+    return lcd->scrub(budget_us);
+}
@@ -1,5 +1,15 @@
 
 #include "lcd.hpp"
+#include "lcd_trace.hpp"
+#include <cstring>
+
+#if LCD_STATS
+#define LCD_STAT_SCOPE(method) StatScope stat_scope(this, method)
+#define LCD_STAT_COUNT(counter, n) (_stats.counter += (n))
+#else
+#define LCD_STAT_SCOPE(method)
+#define LCD_STAT_COUNT(counter, n)
+#endif
 
 
 /*********** mid level commands, for sending data/cmds */
@@ -59,6 +69,21 @@
         vCtrlRS = ctrlRS;
     }
 
+/**
+
+    @brief Sets the enable line of the second controller of a 40x4 panel.
+    @param portctrlEN2 Pointer to the GPIO port for the second EN control line.
+    @param ctrlEN2 Value for the second control pin EN.
+    @note Call before Begin(). Rows 0-1 are then driven through the first enable line
+          and rows 2-3 through the second, see writeFrame() for updating both at once.
+    @retval None
+    */
+
+    void LCD::initSecondEnable(GPIO_TypeDef* portctrlEN2, uint16_t ctrlEN2) {
+        vPortCtrlEN2 = portctrlEN2;
+        vCtrlEN2 = ctrlEN2;
+    }
+
 /**
 
     @brief Prints the specified message on the LCD.
@@ -67,15 +92,80 @@
     */
 
     size_t LCD::printLCD(const std::string& message) {
+    	LCD_STAT_SCOPE(LCD_STAT_PRINT);
     	if (message.length() == 0) return 0;
     	  size_t n=0;
     	  for (size_t i = 0; i < message.length(); i++) {
     	    if (write(message[i])) n++;
     	    else break;
     	  }
+    	  advanceCursor(n);
     	  return n;
     }
 
+    /**
+     * @brief Prints the message within the rows of the display.
+     *
+     * printLCD() lets the controller advance the DDRAM address, so text longer than a row
+     * continues in invisible DDRAM or, on 4-line displays, in the wrong row. This method
+     * starts at the current cursor position and handles the end of each row according to
+     * the mode:
+     * - LCD_PRINT_WRAP continues on the next row, and stops after the last row.
+     * - LCD_PRINT_CLIP drops the text that does not fit in the current row.
+     * - LCD_PRINT_ELLIPSIS is like clip, but shows LCD_ELLIPSIS_CHAR in the last cell
+     *   when text was dropped.
+     *
+     * The text is sent row by row, with a DDRAM address command only at row boundaries.
+     *
+     * @note The cursor position is known after setCursor(), clear() and home(), and is
+     *       advanced by printing. Text is assumed to flow left to right.
+     * @param message The message to be printed on the LCD.
+     * @param mode LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS.
+     * @return The number of characters printed.
+     */
+    size_t LCD::printRows(const std::string& message, uint8_t mode) {
+        return printRows(message.data(), message.length(), mode);
+    }
+
+    /**
+     * @brief Prints the message within the rows of the display, see above.
+     *
+     * Takes the text as characters and length, so no std::string has to be constructed.
+     *
+     * @param message The characters to be printed on the LCD.
+     * @param len The number of characters.
+     * @param mode LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS.
+     * @return The number of characters printed.
+     */
+    size_t LCD::printRows(const char* message, size_t len, uint8_t mode) {
+        LCD_STAT_SCOPE(LCD_STAT_PRINT);
+        const uint8_t* p = (const uint8_t*)message;
+        size_t n = 0;
+
+        while (len) {
+            if (_col >= _numcols) {
+                if (mode != LCD_PRINT_WRAP || _row + 1 >= _numlines) break;
+                setCursor(0, _row + 1);
+            }
+
+            size_t room = _numcols - _col;
+            size_t chunk = (len < room) ? len : room;
+            if (mode == LCD_PRINT_ELLIPSIS && len > room) {
+                chunk = room - 1;
+            }
+            n += writeCells(p, chunk);
+            p += chunk;
+            len -= chunk;
+
+            if (mode == LCD_PRINT_ELLIPSIS && len) {
+                write(LCD_ELLIPSIS_CHAR);
+                advanceCursor(1);
+                break;
+            }
+        }
+        return n;
+    }
+
     /**
      * @brief Outputs a character to the LCD display.
      *
@@ -88,8 +178,77 @@
      * @return None
      */
     void LCD::putch(uint8_t ch) {
+        LCD_STAT_SCOPE(LCD_STAT_PRINT);
         if (ch == 0) return;
         write(ch);
+        advanceCursor(1);
+    }
+
+    /**
+     * @brief Writes raw character codes to the LCD display.
+     *
+     * Unlike printLCD() and putch(), every byte is sent as is, so code 0 can be used
+     * to show the custom character stored in CGRAM location 0.
+     *
+     * @param cells The character codes to write, starting at the current cursor position.
+     * @param len The number of character codes to write.
+     *
+     * @return The number of characters written.
+     */
+    size_t LCD::writeCells(const uint8_t* cells, size_t len) {
+        LCD_STAT_SCOPE(LCD_STAT_PRINT);
+        size_t n = 0;
+        for (size_t i = 0; i < len; i++) {
+            n += write(cells[i]);
+        }
+        advanceCursor(n);
+        return n;
+    }
+
+    /**
+     * @brief Writes a whole screen of raw character codes.
+     *
+     * On a panel with two controllers, the top and bottom halves are sent byte by byte
+     * in turn, so each controller executes a byte while the other one receives the next.
+     * With a calibrated timing profile this takes about half the time of writing the rows
+     * one after the other. On other panels the rows are written one after the other, with
+     * one DDRAM address command per row.
+     *
+     * @param cells getCols() * getRows() character codes, row by row.
+     *
+     * @return The number of characters written.
+     */
+    size_t LCD::writeFrame(const uint8_t* cells) {
+        LCD_STAT_SCOPE(LCD_STAT_PRINT);
+        size_t n = 0;
+
+        if (_controllers == 1) {
+            for (uint8_t y = 0; y < _numlines; y++) {
+                setCursor(0, y);
+                n += writeCells(cells + y * _numcols, _numcols);
+            }
+            return n;
+        }
+
+        uint8_t half = _numlines / 2;
+        for (uint8_t y = 0; y < half; y++) {
+            const uint8_t* top = cells + y * _numcols;
+            const uint8_t* bottom = cells + (y + half) * _numcols;
+            setCursor(0, y);
+            setCursor(0, y + half);
+            for (uint8_t x = 0; x < _numcols; x++) {
+                _cur = 0;
+                n += write(top[x]);
+                _cur = 1;
+                n += write(bottom[x]);
+            }
+        }
+        // the cursor, if shown, ends up after the last cell
+        if (_displaycontrol & (LCD_CURSORON | LCD_BLINKON)) {
+            command(LCD_DISPLAYCONTROL | _displaycontrol);
+        }
+        advanceCursor(_numcols);
+        return n;
     }
 
     /**
@@ -104,6 +263,7 @@
      * @return The number of characters printed on the LCD display.
      */
     int LCD::printFormatted(const char* format, ...) {
+        LCD_STAT_SCOPE(LCD_STAT_PRINT);
         // Buffer to store the formatted string
     	char buffer[100];
     	int n;
@@ -115,7 +275,7 @@
 
     	// Print the formatted string to the LCD display
     	if ( n > 0 ) {
-    		printLCD(buffer);
+    		writeCells((const uint8_t*)buffer, strlen(buffer));
     	}
     	return n;
     }
@@ -131,6 +291,7 @@
     */
 
     void LCD::setCursor(uint8_t x, uint8_t y) {
+    	LCD_STAT_SCOPE(LCD_STAT_SETCURSOR);
     	const size_t max_lines = sizeof(_row_offsets) / sizeof(*_row_offsets);
     	  if ( y >= max_lines ) {
     	    y = max_lines - 1;    // we count rows starting w/0
@@ -139,7 +300,10 @@
     	    y = _numlines - 1;    // we count rows starting w/0
     	  }
 
-    	  command(LCD_SETDDRAMADDR | (x + _row_offsets[y]));
+    	  selectController((_controllers > 1 && y >= _numlines / 2) ? 1 : 0);
+    	  command(LCD_SETDDRAMADDR | (x + _row_offsets[y] + drawOffset()));
+    	  _col = x;
+    	  _row = y;
     }
 
     /**
@@ -147,16 +311,61 @@
     @brief Creates a custom character and assigns it to the specified CGRAM location.
     @param location The location in CGRAM where the custom character will be stored (0-7).
     @param charmap An array representing the character pattern (8 bytes) to be assigned to the location.
+    @note The DDRAM address is restored afterwards, so printing continues where it left
+          off, see restoreCursor().
     @retval None
     */
     // Allows us to fill the first 8 CGRAM locations
     // with custom characters
-    void LCD::createChar(uint8_t location, uint8_t charmap[]) {
+    void LCD::createChar(uint8_t location, const uint8_t charmap[]) {
+      LCD_STAT_SCOPE(LCD_STAT_CREATECHAR);
+      uint8_t ctrl = _cur, ac = _ac[_cur];
       location &= 0x7; // we only have 8 locations 0-7
-      command(LCD_SETCGRAMADDR | (location << 3));
-      for (int i=0; i<8; i++) {
-        write(charmap[i]);
+      if (_entry & LCD_ENTRYLEFT) {
+        command(LCD_SETCGRAMADDR | (location << 3));
+        for (int i=0; i<8; i++) {
+          write(charmap[i]);
+        }
+      } else {
+        // right to left text decrements the address counter, so start at the last row
+        command(LCD_SETCGRAMADDR | (location << 3) | 7);
+        for (int i=7; i>=0; i--) {
+          write(charmap[i]);
+        }
+      }
+      restoreCursor(ctrl, ac);
+    }
+
+    /**
+
+    @brief Creates several custom characters in consecutive CGRAM locations.
+    @param first The CGRAM location of the first character (0-7).
+    @param charmaps The patterns, 8 bytes per character, one after the other.
+    @param count The number of characters. Locations past 7 are not written.
+    @note The CGRAM address is set once and the address counter steps through the
+          patterns, so n characters take 1 + 8n transfers instead of 9n with createChar().
+          The DDRAM address is restored afterwards, see restoreCursor().
+    @retval None
+    */
+    void LCD::createChars(uint8_t first, const uint8_t charmaps[], uint8_t count) {
+      LCD_STAT_SCOPE(LCD_STAT_CREATECHAR);
+      first &= 0x7;
+      if (count > 8 - first) count = 8 - first;
+      if (!count) return;
+      uint8_t ctrl = _cur, ac = _ac[_cur];
+      if (_entry & LCD_ENTRYLEFT) {
+        command(LCD_SETCGRAMADDR | (first << 3));
+        for (int i=0; i<count * 8; i++) {
+          write(charmaps[i]);
+        }
+      } else {
+        // right to left text decrements the address counter, so start at the last row
+        command(LCD_SETCGRAMADDR | ((first + count) * 8 - 1));
+        for (int i=count * 8 - 1; i>=0; i--) {
+          write(charmaps[i]);
+        }
       }
+      restoreCursor(ctrl, ac);
     }
 
     /**
@@ -166,6 +375,7 @@
     */
 
     void LCD::noAutoscroll(void) {
+      LCD_STAT_SCOPE(LCD_STAT_CONTROL);
       _displaymode &= ~LCD_ENTRYSHIFTINCREMENT;
       command(LCD_ENTRYMODESET | _displaymode);
     }
@@ -177,6 +387,7 @@
     @retval None
     */
     void LCD::autoscroll(void) {
+      LCD_STAT_SCOPE(LCD_STAT_CONTROL);
       _displaymode |= LCD_ENTRYSHIFTINCREMENT;
       command(LCD_ENTRYMODESET | _displaymode);
     }
@@ -187,6 +398,7 @@
     @retval None
     */
     void LCD::rightToLeft(void) {
+      LCD_STAT_SCOPE(LCD_STAT_CONTROL);
       _displaymode &= ~LCD_ENTRYLEFT;
       command(LCD_ENTRYMODESET | _displaymode);
     }
@@ -199,6 +411,7 @@
     */
 
     void LCD::leftToRight(void) {
+      LCD_STAT_SCOPE(LCD_STAT_CONTROL);
       _displaymode |= LCD_ENTRYLEFT;
       command(LCD_ENTRYMODESET | _displaymode);
     }
@@ -209,6 +422,7 @@
     @retval None
     */
     void LCD::scrollDisplayLeft(void) {
+      LCD_STAT_SCOPE(LCD_STAT_CONTROL);
       command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT);
     }
 
@@ -218,6 +432,7 @@
     @retval None
     */
     void LCD::scrollDisplayRight(void) {
+      LCD_STAT_SCOPE(LCD_STAT_CONTROL);
       command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
     }
 
@@ -225,6 +440,7 @@
      * @brief Turns off the display.
      */
     void LCD::noDisplay(void) {
+        LCD_STAT_SCOPE(LCD_STAT_CONTROL);
         _displaycontrol &= ~LCD_DISPLAYON;
         command(LCD_DISPLAYCONTROL | _displaycontrol);
     }
@@ -233,6 +449,7 @@
      * @brief Turns on the display.
      */
     void LCD::display(void) {
+        LCD_STAT_SCOPE(LCD_STAT_CONTROL);
         _displaycontrol |= LCD_DISPLAYON;
         command(LCD_DISPLAYCONTROL | _displaycontrol);
     }
@@ -241,6 +458,7 @@
      * @brief Turns off the underline cursor.
      */
     void LCD::noCursor(void) {
+        LCD_STAT_SCOPE(LCD_STAT_CONTROL);
         _displaycontrol &= ~LCD_CURSORON;
         command(LCD_DISPLAYCONTROL | _displaycontrol);
     }
@@ -249,6 +467,7 @@
      * @brief Turns on the underline cursor.
      */
     void LCD::cursor(void) {
+        LCD_STAT_SCOPE(LCD_STAT_CONTROL);
         _displaycontrol |= LCD_CURSORON;
         command(LCD_DISPLAYCONTROL | _displaycontrol);
     }
@@ -258,8 +477,12 @@
 	 */
     void LCD::clear(void)
     {
+        LCD_STAT_SCOPE(LCD_STAT_CLEAR);
         command(LCD_CLEARDISPLAY);  // clear display, set cursor position to zero
-        HAL_Delay(2);  // this command takes a long time!
+        if (!_timing.valid) delayMs(2);  // this command takes a long time!
+        _front_page = 0;  // clear also resets the display shift
+        _col = 0;
+        _row = 0;
     }
 
     /**
@@ -267,10 +490,142 @@
 	 */
     void LCD::home(void)
     {
+        LCD_STAT_SCOPE(LCD_STAT_CLEAR);
         command(LCD_RETURNHOME);  // set cursor position to zero
-        HAL_Delay(2);  // this command takes a long time!
+        if (!_timing.valid) delayMs(2);  // this command takes a long time!
+        _front_page = 0;  // home also resets the display shift
+        _col = 0;
+        _row = 0;
+    }
+
+    /**
+     * @brief Enables double buffered drawing using the hidden part of DDRAM.
+     *
+     * Each DDRAM line holds 40 characters (80 on a 1-line display), but only `cols` of them
+     * are visible. When the line has room for two complete screens, the second screen is kept
+     * in the hidden columns and all drawing through setCursor() goes to the page that is not
+     * shown. flipPage() then brings the drawn page into view with display shift commands, so
+     * the user never sees a half written screen.
+     *
+     * On 4-line panels rows 2 and 3 continue rows 0 and 1 in DDRAM, so each page needs
+     * 2 * cols columns and page flipping is only possible up to 10 columns.
+     *
+     * @note Call this after Begin(). scrollDisplayLeft()/scrollDisplayRight() move the window
+     *       and must not be mixed with page flipping.
+     * @return true if page flipping is active, false if the panel is too wide for two pages.
+     */
+    bool LCD::beginPageFlip(void) {
+        uint8_t linelength = (_displayfunction & LCD_2LINE) ? 40 : 80;
+        uint8_t span = (_numlines > 2) ? 2 * _numcols : _numcols;
+
+        if (2 * span > linelength) {
+            _page_span = 0;
+            return false;
+        }
+        _page_span = span;
+        return true;
+    }
+
+    /**
+     * @brief Disables double buffered drawing, keeping the page that is shown.
+     *
+     * When page 1 is in front, its cells are copied to page 0 while page 0 is still hidden,
+     * only those that differ, and page 0 is then brought back with a return home command.
+     * What was drawn on the hidden page since the last flip is dropped. The address counter
+     * stays where drawing left it.
+     */
+    void LCD::endPageFlip(void) {
+        if (_page_span && _front_page) {
+            uint8_t linelength = (_displayfunction & LCD_2LINE) ? 40 : 80;
+            uint8_t lines = (_displayfunction & LCD_2LINE) ? 2 : 1;
+            uint8_t entry = _entry;
+            uint8_t ac = _ac[_cur];
+            uint8_t col = _col, row = _row;
+
+            if (entry != LCD_ENTRYLEFT) command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+            for (uint8_t c = 0; c < _controllers; c++) {
+                _pin = c;
+                for (uint8_t line = 0; line < lines; line++) {
+                    const uint8_t* cells = &_ddram[c][line * linelength];
+                    bool in_run = false;
+                    for (uint8_t i = 0; i < _page_span; i++) {
+                        if (cells[i] == cells[_page_span + i]) {
+                            in_run = false;
+                            continue;
+                        }
+                        if (!in_run) command(LCD_SETDDRAMADDR | ddramAddress(line * linelength + i));
+                        in_run = true;
+                        write(cells[_page_span + i]);
+                    }
+                }
+            }
+            _pin = 0xFF;
+            if (entry != LCD_ENTRYLEFT) command(LCD_ENTRYMODESET | entry);
+
+            home();
+            _col = col;
+            _row = row;
+            if (ac) command(LCD_SETDDRAMADDR | ac);
+        }
+        _page_span = 0;
     }
 
+    /**
+     * @brief Shows the page that has been drawn since the last flip.
+     *
+     * Page 0 sits at display shift 0 and is brought back with a single return home command.
+     * Page 1 is brought into view by shifting the display window one column at a time. The
+     * display is blanked during those shifts when it is on, so the intermediate windows, which
+     * contain parts of both pages, are never visible. Shifting left is the shorter way, as a
+     * page takes at most half of a DDRAM line.
+     *
+     * Flipping to page 1 thus costs one shift command per page column, 16 on a 16x2 panel,
+     * plus two display control commands. With a calibrated timing profile the panel is blank
+     * for well under a millisecond, but with the default delays each command takes several
+     * milliseconds and the blank period becomes visible: use calibrate() or setTiming()
+     * together with page flipping.
+     *
+     * After the flip, drawing goes to the page that was just hidden. It still holds the frame
+     * before the last one, so it must be redrawn completely or updated relative to that frame.
+     * The address counter is moved to the same cell of that page, so printing without
+     * setCursor() also stays hidden; an address counter outside the page, e.g. after
+     * printing past its last column, goes to column 0 of row 0.
+     */
+    void LCD::flipPage(void) {
+        LCD_STAT_SCOPE(LCD_STAT_FLIP);
+        if (!_page_span) return;
+        uint8_t col = _col, row = _row;
+        uint8_t from = drawOffset();
+        uint8_t index = ddramIndex(_ac[_cur]);
+        bool cgram = _ac_cgram[_cur];
+
+        if (_front_page) {
+            home();
+        } else {
+            uint8_t blank = _displaycontrol & LCD_DISPLAYON;
+            if (blank) {
+                command(LCD_DISPLAYCONTROL | (_displaycontrol & ~LCD_DISPLAYON));
+            }
+            for (uint8_t i = 0; i < _page_span; i++) {
+                scrollDisplayLeft();
+            }
+            if (blank) {
+                command(LCD_DISPLAYCONTROL | _displaycontrol);
+            }
+            _front_page = 1;
+        }
+
+        // the address counter is on the page now shown, or at its start after home()
+        uint8_t linelength = (_displayfunction & LCD_2LINE) ? 40 : 80;
+        uint8_t line = index / linelength, x = index % linelength;
+        if (cgram || x < from || x >= from + _page_span) {
+            setCursor(0, 0);
+            return;
+        }
+        command(LCD_SETDDRAMADDR | ddramAddress(line * linelength + x - from + drawOffset()));
+        _col = col;
+        _row = row;
+    }
     /**
      * @brief Enables the RCC clock for the GPIO ports used by the LCD.
      *
@@ -283,6 +638,7 @@
         if (vPortCtrlRW != vPortData) enableClock2(vPortCtrlRW);
         if (vPortCtrlRS != vPortCtrlRW) enableClock2(vPortCtrlRS);
         if (vPortCtrlEN != vPortCtrlRS) enableClock2(vPortCtrlEN);
+        if (vPortCtrlEN2) enableClock2(vPortCtrlEN2);
     }
 
     /**
@@ -323,64 +679,13 @@
     */
 
     void LCD::Begin ( int cols, int rows ) {
-    	uint8_t fourbitmode=1;
-    	if (fourbitmode)
-    	    _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
-    	  else
-    	    _displayfunction = LCD_8BITMODE | LCD_1LINE | LCD_5x8DOTS;
-
-    	if (rows > 1) {
-    	    _displayfunction |= LCD_2LINE;
-    	  }
-    	  _numlines = rows;
-    	 setRowOffsets(0x00, 0x40, 0x00 + cols, 0x40 + cols);
-
-    	 // for some 1 line displays you can select a 10 pixel high font
-    	   if ((dotsize != LCD_5x8DOTS) && (rows == 1)) {
-    	     _displayfunction |= LCD_5x10DOTS;
-    	   }
-
-    	   //Initializing GPIO Pins
-    	   enableClock();
-
-    	   GPIO_InitTypeDef gpio_init;
-    	   gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
-    	   gpio_init.Mode = GPIO_MODE_OUTPUT_PP;
-
-    	   // RS:
-    	   gpio_init.Pin = vCtrlRS;
-    	   HAL_GPIO_Init(vPortCtrlRS, &gpio_init);
-
-    	   // RW:
-    	   gpio_init.Pin = vCtrlRW;
-    	   HAL_GPIO_Init(vPortCtrlRW, &gpio_init);
-
-    	   // EN
-    	   gpio_init.Pin = vCtrlEN;
-    	   HAL_GPIO_Init(vPortCtrlEN, &gpio_init);
-
-    	   // Data
-
-    	   if(_fourbit_mode)
-    	     gpio_init.Pin = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3];
-    	   else
-    	     gpio_init.Pin = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3] |
-    	                     _data_pins[4] | _data_pins[5] | _data_pins[6] | _data_pins[7];
-
-    	   HAL_GPIO_Init(vPortData, &gpio_init);
+    	LCD_STAT_SCOPE(LCD_STAT_BEGIN);
+    	prepare(cols, rows);
 
     	   // SEE PAGE 45/46 FOR INITIALIZATION SPECIFICATION!
     	   // according to datasheet, we need at least 40ms after power rises above 2.7V
     	   // so we'll wait 50 just to make sure
-    	   HAL_Delay(50);
-
-    	   // Now we pull both RS and R/W low to begin commands
-    	   HAL_GPIO_WritePin(vPortCtrlRS, vCtrlRS, GPIO_PIN_RESET);
-    	   HAL_GPIO_WritePin(vPortCtrlEN, vCtrlEN, GPIO_PIN_RESET);
-
-    	   if (vCtrlRW != 255) {
-    	     HAL_GPIO_WritePin(vPortCtrlRW, vCtrlRW, GPIO_PIN_RESET);
-    	   }
+    	   delayMs(50);
 
     	   //put the LCD into 4 bit or 8 bit mode
     	   if (! (_displayfunction & LCD_8BITMODE)) {
@@ -389,29 +694,30 @@
 
     	     // we start in 8bit mode, try to set 4 bit mode
     	     write4bits(0x03);
-    	     HAL_Delay(5); // wait min 4.1ms
+    	     delayMs(5); // wait min 4.1ms
 
     	     // second try
     	     write4bits(0x03);
-    	     HAL_Delay(5); // wait min 4.1ms
+    	     delayMs(5); // wait min 4.1ms
 
     	     // third go!
     	     write4bits(0x03);
-    	     HAL_Delay(1);
+    	     delayMs(1);
 
     	     // finally, set to 4-bit interface
     	     write4bits(0x02);
+    	     if (_timing.valid) delayUs(_timing.command_us);
     	   } else {
     	     // this is according to the hitachi HD44780 datasheet
     	     // page 45 figure 23
 
     	     // Send function set command sequence
     	     command(LCD_FUNCTIONSET | _displayfunction);
-    	     HAL_Delay(5);  // wait more than 4.1ms
+    	     delayMs(5);  // wait more than 4.1ms
 
     	     // second try
     	     command(LCD_FUNCTIONSET | _displayfunction);
-    	     HAL_Delay(1);
+    	     delayMs(1);
 
     	     // third go
     	     command(LCD_FUNCTIONSET | _displayfunction);
@@ -435,6 +741,85 @@
     }
 
 
+ /**
+
+    @brief Sets up the geometry and the GPIO pins for Begin(), with the control lines low.
+    @param cols The number of columns on the LCD.
+    @param rows The number of rows on the LCD.
+    @retval None
+    */
+
+    void LCD::prepare(int cols, int rows) {
+    	uint8_t fourbitmode=1;
+    	if (fourbitmode)
+    	    _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+    	  else
+    	    _displayfunction = LCD_8BITMODE | LCD_1LINE | LCD_5x8DOTS;
+
+    	if (rows > 1) {
+    	    _displayfunction |= LCD_2LINE;
+    	  }
+    	  _numlines = rows;
+    	  _numcols = cols;
+    	  _page_span = 0;
+    	  _cg_defined = 0;
+    	  _controllers = (vPortCtrlEN2 && rows > 2) ? 2 : 1;
+    	  _cur = 0;
+    	  _pin = 0xFF;
+    	 if (_controllers > 1)
+    	   setRowOffsets(0x00, 0x40, 0x00, 0x40);  // each controller drives two rows
+    	 else
+    	   setRowOffsets(0x00, 0x40, 0x00 + cols, 0x40 + cols);
+
+    	 // for some 1 line displays you can select a 10 pixel high font
+    	   if ((dotsize != LCD_5x8DOTS) && (rows == 1)) {
+    	     _displayfunction |= LCD_5x10DOTS;
+    	   }
+
+    	   //Initializing GPIO Pins
+    	   enableClock();
+
+    	   GPIO_InitTypeDef gpio_init;
+    	   gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    	   gpio_init.Mode = GPIO_MODE_OUTPUT_PP;
+
+    	   // RS:
+    	   gpio_init.Pin = vCtrlRS;
+    	   HAL_GPIO_Init(vPortCtrlRS, &gpio_init);
+
+    	   // RW:
+    	   gpio_init.Pin = vCtrlRW;
+    	   HAL_GPIO_Init(vPortCtrlRW, &gpio_init);
+
+    	   // EN
+    	   gpio_init.Pin = vCtrlEN;
+    	   HAL_GPIO_Init(vPortCtrlEN, &gpio_init);
+    	   if (_controllers > 1) {
+    	     gpio_init.Pin = vCtrlEN2;
+    	     HAL_GPIO_Init(vPortCtrlEN2, &gpio_init);
+    	   }
+
+    	   // Data
+
+    	   if(_fourbit_mode)
+    	     gpio_init.Pin = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3];
+    	   else
+    	     gpio_init.Pin = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3] |
+    	                     _data_pins[4] | _data_pins[5] | _data_pins[6] | _data_pins[7];
+
+    	   HAL_GPIO_Init(vPortData, &gpio_init);
+
+    	   // Now we pull both RS and R/W low to begin commands
+    	   writePin(vPortCtrlRS, vCtrlRS, LCD_TRACE_RS, GPIO_PIN_RESET);
+    	   _en_mask = (1 << _controllers) - 1;   // initialize all controllers together
+    	   writeEnable(_en_mask, GPIO_PIN_RESET);
+
+    	   if (vCtrlRW != 255) {
+    	     writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_RESET);
+    	   }
+    }
+
+
  /**
 
     @brief Sets the row offsets for the LCD.
@@ -452,6 +837,47 @@
       _row_offsets[3] = row3;
     }
 
+ /**
+
+    @brief Returns the DDRAM column offset of the page that is currently drawn to.
+    @return 0 when page flipping is off, otherwise the offset of the hidden page.
+    */
+
+    uint8_t LCD::drawOffset(void) {
+      if (!_page_span) return 0;
+      return _front_page ? 0 : _page_span;
+    }
+
+ /**
+
+    @brief Advances the tracked cursor column after characters have been written.
+    @param n The number of characters written.
+    @retval None
+    */
+
+    void LCD::advanceCursor(size_t n) {
+      size_t col = _col + n;
+      _col = (col > 0xFF) ? 0xFF : col;
+    }
+
+ /**
+
+    @brief Moves the address counter back to a DDRAM address saved before writing CGRAM.
+    @param ctrl The controller holding the cursor when the address was saved.
+    @param address Its address counter then, _ac[ctrl].
+    @note The address is restored as it was rather than rebuilt from the tracked column,
+          which has no DDRAM address past the end of a row and does not follow the
+          address counter with right to left text.
+    @return true if the DDRAM address command was sent.
+    */
+
+    bool LCD::restoreCursor(uint8_t ctrl, uint8_t address) {
+      selectController(ctrl);
+      if (!_ac_cgram[ctrl] && _ac[ctrl] == address) return false;
+      command(LCD_SETDDRAMADDR | address);
+      return true;
+    }
+
  /**
 
     @brief Sends a command value to the LCD.
@@ -459,7 +885,8 @@
     @retval None
     */
 
-    inline void LCD::command(uint8_t value) {
+    void LCD::command(uint8_t value) {
+      LCD_STAT_COUNT(commands, 1);
       send(value, GPIO_PIN_RESET);
     }
 
@@ -470,7 +897,8 @@
     @return The number of bytes written.
     */
 
-    inline size_t LCD::write(uint8_t value) {
+    size_t LCD::write(uint8_t value) {
+      LCD_STAT_COUNT(data_bytes, 1);
       send(value, GPIO_PIN_SET);
       return 1; // assume sucess
     }
@@ -478,6 +906,25 @@
     /************ low level data pushing commands **********/
     /**
 
+    @brief Sets a bus pin, recording the change when a trace is attached.
+    @param port The GPIO port of the pin.
+    @param pin The GPIO pin.
+    @param signal The signal number used in the trace (LCD_TRACE_RS, LCD_TRACE_EN, ...).
+    @param state The new pin state.
+    @retval None
+    */
+
+    inline void LCD::writePin(GPIO_TypeDef* port, uint16_t pin, uint8_t signal, GPIO_PinState state) {
+      HAL_GPIO_WritePin(port, pin, state);
+#if LCD_TRACE
+      if (_trace) _trace->record(signal, state);
+#else
+      (void)signal;
+#endif
+    }
+
+    /**
+
     @brief Sends a command or data value to the LCD.
     @param value The value to be sent.
     @param mode The mode indicating whether it is a command or data (GPIO_PinState).
@@ -486,34 +933,174 @@
 
     // write either command or data, with automatic 4/8-bit selection
     void LCD::send(uint8_t value, GPIO_PinState mode) {
-      HAL_GPIO_WritePin(vPortCtrlRS, vCtrlRS, mode);
+      uint8_t mask = route(value, mode);
+
+      // with two controllers, only the one holding the cursor shows it
+      if (mode == GPIO_PIN_RESET && (value & 0xF8) == LCD_DISPLAYCONTROL &&
+          (value & (LCD_CURSORON | LCD_BLINKON))) {
+        uint8_t others = mask & ~(1 << _cur);
+        if (others) {
+          transfer(others, value & ~(LCD_CURSORON | LCD_BLINKON), mode);
+          mask &= 1 << _cur;
+        }
+      }
+      if (mask) transfer(mask, value, mode);
+    }
+
+    /**
+
+    @brief Sends a byte to one or more controllers at once.
+    @param mask The controllers, one bit each.
+    @param value The value to be sent.
+    @param mode The mode indicating whether it is a command or data (GPIO_PinState).
+    @retval None
+    */
+
+    void LCD::transfer(uint8_t mask, uint8_t value, GPIO_PinState mode) {
+      // with a calibrated profile, wait for the previous byte to execute only when needed,
+      // so a controller executes while the caller or the other controller goes on
+      if (_timing.valid) waitReady(mask);
+
+      writePin(vPortCtrlRS, vCtrlRS, LCD_TRACE_RS, mode);
 
       // if there is a RW pin indicated, set it low to Write
       if (vCtrlRW != 255) {
-        HAL_GPIO_WritePin(vPortCtrlRW, vCtrlRW, GPIO_PIN_RESET);
+        writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_RESET);
       }
 
+      _en_mask = mask;
       if (_displayfunction & LCD_8BITMODE) {
         write8bits(value);
       } else {
         write4bits(value>>4);
         write4bits(value);
       }
+
+      account(mask, value, mode);
+    }
+
+    /**
+
+    @brief Updates the tracked controller state after a byte has been sent.
+    @param mask The controllers the byte went to, one bit each.
+    @param value The value sent.
+    @param mode The mode indicating whether it is a command or data (GPIO_PinState).
+    @retval None
+    */
+
+    void LCD::account(uint8_t mask, uint8_t value, GPIO_PinState mode) {
+      bool shared = true;
+      for (uint8_t c = 0; c < _controllers; c++) {
+        if (!(mask & (1 << c))) continue;
+        track(c, value, mode, shared);
+        shared = false;
+      }
+
+      if (_timing.valid) {
+        uint32_t us;
+        if (mode == GPIO_PIN_SET)
+          us = _timing.data_us;
+        else if (value == LCD_CLEARDISPLAY || (value & 0xFE) == LCD_RETURNHOME)
+          us = _timing.clear_us;
+        else
+          us = _timing.command_us;
+        uint32_t per_us = SystemCoreClock / 1000000;
+        uint32_t now = cycles();
+        for (uint8_t c = 0; c < _controllers; c++) {
+          if (!(mask & (1 << c))) continue;
+          _sent[c] = now;
+          _exec[c] = us * (per_us ? per_us : 1);
+        }
+      }
+    }
+
+    /**
+
+    @brief Returns the controllers a byte goes to.
+    @param value The value to be sent.
+    @param mode The mode indicating whether it is a command or data (GPIO_PinState).
+    @return The controllers, one bit each. DDRAM addresses and data go to the controller
+            holding the cursor, CGRAM data and all other commands to every controller.
+    */
+
+    uint8_t LCD::route(uint8_t value, GPIO_PinState mode) const {
+      if (_pin != 0xFF) return 1 << _pin;
+      if (_controllers == 1) return 1;
+      if (mode == GPIO_PIN_SET) return _ac_cgram[_cur] ? (1 << _controllers) - 1 : 1 << _cur;
+      if (value & LCD_SETDDRAMADDR) return 1 << _cur;
+      return (1 << _controllers) - 1;
+    }
+
+    /**
+
+    @brief Makes a controller the one that receives DDRAM writes and shows the cursor.
+    @param ctrl The controller, 0 for rows 0-1, 1 for rows 2-3.
+    @retval None
+    */
+
+    void LCD::selectController(uint8_t ctrl) {
+      if (ctrl == _cur) return;
+      _cur = ctrl;
+      if (_displaycontrol & (LCD_CURSORON | LCD_BLINKON)) {
+        command(LCD_DISPLAYCONTROL | _displaycontrol);   // move the cursor over
+      }
+    }
+
+    /**
+
+    @brief Waits until the controllers have executed the last byte sent to them.
+    @param mask The controllers, one bit each.
+    @retval None
+    */
+
+    void LCD::waitReady(uint8_t mask) {
+      for (uint8_t c = 0; c < _controllers; c++) {
+        if (!(mask & (1 << c)) || !_exec[c]) continue;
+        uint32_t elapsed = cycles() - _sent[c];
+        if (elapsed < _exec[c]) {
+          if (_busy_hook) _busy_hook(cyclesToUs(_exec[c] - elapsed), _busy_context);
+          waitUntil(_sent[c], _exec[c]);
+          LCD_STAT_COUNT(stall_us, cyclesToUs(_exec[c] - elapsed));
+        }
+        _exec[c] = 0;
+      }
+    }
+
+    /**
+
+    @brief Sets the enable lines of the given controllers.
+    @param mask The controllers, one bit each.
+    @param state The new pin state.
+    @retval None
+    */
+
+    void LCD::writeEnable(uint8_t mask, GPIO_PinState state) {
+      if (mask & 1) writePin(vPortCtrlEN, vCtrlEN, LCD_TRACE_EN, state);
+      if (mask & 2) writePin(vPortCtrlEN2, vCtrlEN2, LCD_TRACE_EN2, state);
     }
 
     /**
 
-    @brief Generates a pulse on the enable pin of the LCD.
+    @brief Generates a pulse on the enable pins of the controllers selected by _en_mask.
     @retval None
     */
 
     void LCD::pulseEnable(void) {
-      HAL_GPIO_WritePin(vPortCtrlEN, vCtrlEN, GPIO_PIN_RESET);
-      HAL_Delay(1);
-      HAL_GPIO_WritePin(vPortCtrlEN, vCtrlEN, GPIO_PIN_SET);
-      HAL_Delay(1);    // enable pulse must be >450ns
-      HAL_GPIO_WritePin(vPortCtrlEN, vCtrlEN, GPIO_PIN_RESET);
-      HAL_Delay(1);   // commands need > 37us to settle
+      LCD_STAT_COUNT(en_pulses, 1);
+      if (_timing.valid) {
+        // the execution time is waited for in transfer(), only the pulse timing is needed here
+        writeEnable(_en_mask, GPIO_PIN_SET);
+        delayUs(1);    // enable pulse must be >450ns
+        writeEnable(_en_mask, GPIO_PIN_RESET);
+        delayUs(1);    // enable cycle must be >1000ns
+        return;
+      }
+      writeEnable(_en_mask, GPIO_PIN_RESET);
+      delayMs(1);
+      writeEnable(_en_mask, GPIO_PIN_SET);
+      delayMs(1);    // enable pulse must be >450ns
+      writeEnable(_en_mask, GPIO_PIN_RESET);
+      delayMs(1);   // commands need > 37us to settle
     }
 
     /**
@@ -525,7 +1112,7 @@
 
     void LCD::write4bits(uint8_t value) {
       for (int i = 0; i < 4; i++) {
-        HAL_GPIO_WritePin(vPortData, _data_pins[i], ((value >> i) & 0x01)?GPIO_PIN_SET:GPIO_PIN_RESET);
+        writePin(vPortData, _data_pins[i], LCD_TRACE_D0 + 4 + i, ((value >> i) & 0x01)?GPIO_PIN_SET:GPIO_PIN_RESET);
       }
 
       pulseEnable();
@@ -540,10 +1127,769 @@
 
     void LCD::write8bits(uint8_t value) {
       for (int i = 0; i < 8; i++) {
-        HAL_GPIO_WritePin(vPortData, _data_pins[i], ((value >> i) & 0x01)?GPIO_PIN_SET:GPIO_PIN_RESET);
+        writePin(vPortData, _data_pins[i], LCD_TRACE_D0 + i, ((value >> i) & 0x01)?GPIO_PIN_SET:GPIO_PIN_RESET);
       }
 
       pulseEnable();
     }
 
+    /**
+
+    @brief Waits for the given time, counting the wait as stall time.
+    @param ms The time to wait in milliseconds.
+    @note Without LCD_STATS, a timing profile or a wait strategy this is a plain HAL_Delay()
+          and the cycle counter is not touched, so the default delays also work on parts
+          without a DWT (Cortex-M0/M0+).
+    @retval None
+    */
+
+    void LCD::delayMs(uint32_t ms) {
+      if (!LCD_STATS && !_timing.valid && !_sleep) {
+        uint32_t per_us = SystemCoreClock / 1000000;
+        HAL_Delay(ms);
+        _spin_cycles += (uint64_t)ms * 1000 * (per_us ? per_us : 1);
+        _spins++;
+        return;
+      }
+      uint32_t start = cycles();
+      if (_sleep) {
+        uint32_t per_us = SystemCoreClock / 1000000;
+        waitUntil(start, ms * 1000 * (per_us ? per_us : 1));
+      } else {
+        HAL_Delay(ms);
+        _spin_cycles += cycles() - start;
+        _spins++;
+      }
+      LCD_STAT_COUNT(stall_us, cyclesToUs(cycles() - start));
+    }
+
+    /**
+
+    @brief Busy waits for the given time on the DWT cycle counter, counting it as stall time.
+    @param us The time to wait in microseconds.
+    @retval None
+    */
+
+    void LCD::delayUs(uint32_t us) {
+      uint32_t start = cycles();
+      uint32_t per_us = SystemCoreClock / 1000000;
+      waitUntil(start, us * (per_us ? per_us : 1));
+      LCD_STAT_COUNT(stall_us, us);
+    }
+
+    /**
+
+    @brief Waits until the given time has passed since a start on the cycle counter.
+    @param start The cycle count the wait is measured from.
+    @param span The time in cycles.
+    @note With a wait strategy, a wait of at least the sleep threshold is slept and only
+          the rest is spun. The time slept counts as the longer of the cycles seen to pass
+          and the time the sleep function reports, since the cycle counter stops in some
+          sleep modes.
+    @retval None
+    */
+
+    void LCD::waitUntil(uint32_t start, uint32_t span) {
+      uint32_t elapsed = cycles() - start;
+      if (elapsed >= span) return;
+
+      uint32_t per_us = SystemCoreClock / 1000000;
+      if (!per_us) per_us = 1;
+      while (_sleep && (span - elapsed) / per_us >= _sleep_min_us) {
+        uint32_t before = cycles();
+        uint32_t slept = _sleep((span - elapsed) / per_us, _sleep_context);
+        uint32_t counted = cycles() - before;
+        uint32_t reported = slept * per_us;
+        if (reported > counted) start -= reported - counted;   // time the counter missed
+        _sleep_cycles += (reported > counted) ? reported : counted;
+        _sleeps++;
+        elapsed = cycles() - start;
+        if (elapsed >= span) return;
+        if (!slept && !counted) break;  // the sleep function declined, spin the rest
+      }
+
+      uint32_t spin = cycles();
+      while (cycles() - start < span) {
+      }
+      _spin_cycles += cycles() - spin;
+      _spins++;
+    }
+
+    /************ timing calibration **********/
+
+    /**
+     * @brief Measures the execution times of this controller with the busy flag.
+     *
+     * HD44780 clones differ widely in speed, while the default delays cover the slowest.
+     * This method sends a command, a data write and a clear a few times each, measures how
+     * long the busy flag stays set, and switches this display to a timing profile made
+     * of the slowest measurement plus the margin. Afterwards each byte waits its measured
+     * execution time instead of the millisecond delays.
+     *
+     * Call it right after Begin(): it clears the display and returns the cursor home.
+     * The RW pin must be connected, since the busy flag is read from D7.
+     *
+     * @param margin_percent Safety margin added to the measured times.
+     * @return true if the profile is in use, false if the busy flag could not be read.
+     *         The previous timing is kept in that case.
+     */
+    bool LCD::calibrate(uint8_t margin_percent) {
+      if (vCtrlRW == 255) return false;
+
+      LCD_Timing previous = _timing;
+      uint32_t worst[3] = { 0, 0, 0 };   // command, data, clear in cycles
+
+      // no execution waits while measuring, the busy flag is polled instead
+      _timing.valid = 1;
+      _timing.command_us = 0;
+      _timing.data_us = 0;
+      _timing.clear_us = 0;
+
+      for (uint8_t i = 0; i < LCD_CALIBRATION_ROUNDS; i++) {
+        uint32_t t[3];
+        command(LCD_ENTRYMODESET | _displaymode);
+        t[0] = waitBusy();
+        command(LCD_SETDDRAMADDR);
+        waitBusy();
+        write(' ');
+        t[1] = waitBusy();
+        command(LCD_CLEARDISPLAY);
+        t[2] = waitBusy();
+
+        for (uint8_t k = 0; k < 3; k++) {
+          if (t[k] == UINT32_MAX) {
+            _timing = previous;
+            return false;
+          }
+          if (t[k] > worst[k]) worst[k] = t[k];
+        }
+      }
+
+      uint16_t us[3];
+      for (uint8_t k = 0; k < 3; k++) {
+        uint32_t v = cyclesToUs(worst[k]) + LCD_ADDRESS_UPDATE_US;
+        v = v * (100 + margin_percent) / 100 + 1;
+        us[k] = (v > 0xFFFF) ? 0xFFFF : v;
+      }
+      _timing.command_us = us[0];
+      _timing.data_us = us[1];
+      _timing.clear_us = us[2];
+
+      _front_page = 0;
+      _col = 0;
+      _row = 0;
+      return true;
+    }
+
+    /**
+     * @brief Copies the timing profile in use, for example to store it for later boots.
+     *
+     * @param timing Receives the profile. timing->valid is 0 when the default delays are used.
+     */
+    void LCD::getTiming(LCD_Timing* timing) const {
+      *timing = _timing;
+    }
+
+    /**
+     * @brief Uses a timing profile measured earlier by calibrate().
+     *
+     * @param timing The profile. A profile with valid set to 0 returns to the default delays.
+     */
+    void LCD::setTiming(const LCD_Timing* timing) {
+      _timing = *timing;
+    }
+
+    /**
+     * @brief Sets a function that uses the time a byte waits for the controller.
+     *
+     * With a timing profile, a byte sent before the previous one has executed waits for the
+     * rest of its execution time. The hook is called first, with the time left, and can do
+     * short work in it, for example reading keys on the data lines (see LCDKeypad). The
+     * enable lines are low during the call. The work must leave the bus pins as it found
+     * them, and may take longer than the time left, which only delays the byte.
+     *
+     * @param hook The function, or nullptr for none.
+     * @param context Passed to the function.
+     */
+    void LCD::setBusyHook(void (*hook)(uint32_t us, void* context), void* context) {
+      _busy_context = context;
+      _busy_hook = hook;
+    }
+
+    /**
+     * @brief Sets how the waits for the controller are spent, see lcd_wait.h.
+     *
+     * @param sleep The function that sleeps the core, or nullptr to spin in every wait.
+     * @param context Passed to the function.
+     * @param min_sleep_us Waits shorter than this are spun.
+     */
+    void LCD::setWaitStrategy(LCD_SleepFunc sleep, void* context, uint32_t min_sleep_us) {
+      _sleep_context = context;
+      _sleep_min_us = min_sleep_us ? min_sleep_us : 1;
+      _sleep = sleep;
+    }
+
+    /**
+     * @brief Returns the time this display spent sleeping and spinning in waits.
+     *
+     * @param stats Receives the counters. See LCD_waitEnergy() for an energy estimate.
+     */
+    void LCD::getWaitStats(LCD_WaitStats* stats) const {
+      uint32_t per_us = SystemCoreClock / 1000000;
+      if (!per_us) per_us = 1;
+      stats->sleep_us = (uint32_t)(_sleep_cycles / per_us);
+      stats->spin_us = (uint32_t)(_spin_cycles / per_us);
+      stats->sleeps = _sleeps;
+      stats->spins = _spins;
+    }
+
+    /**
+     * @brief Sets the wait counters of this display to zero.
+     */
+    void LCD::resetWaitStats(void) {
+      _sleep_cycles = 0;
+      _spin_cycles = 0;
+      _sleeps = 0;
+      _spins = 0;
+    }
+
+    /**
+     * @brief Returns how long the controllers still execute the last byte sent to them.
+     *
+     * With a timing profile the next byte waits for this time before it is sent, so a
+     * caller that has other work can do it first instead of stalling in the wait.
+     *
+     * @return The remaining execution time in microseconds, rounded up. 0 when the
+     *         controllers are ready, or when the default delays are used, which complete
+     *         inside each call.
+     */
+    uint32_t LCD::getBusyTime(void) const {
+      uint32_t wait = 0;
+      for (uint8_t c = 0; c < _controllers; c++) {
+        if (!_exec[c]) continue;
+        uint32_t elapsed = cycles() - _sent[c];
+        if (elapsed < _exec[c] && _exec[c] - elapsed > wait) wait = _exec[c] - elapsed;
+      }
+      return wait ? cyclesToUs(wait) + 1 : 0;
+    }
+
+    /**
+     * @brief Polls the busy flag until the controller is ready.
+     * @return The time the busy flag stayed set in cycles, or UINT32_MAX on timeout.
+     */
+    uint32_t LCD::waitBusy(void) {
+      uint32_t start = cycles();
+      uint32_t per_us = SystemCoreClock / 1000000;
+      uint32_t timeout = LCD_BUSY_TIMEOUT_US * (per_us ? per_us : 1);
+      uint32_t elapsed;
+
+      setDataInput(true);
+      writePin(vPortCtrlRS, vCtrlRS, LCD_TRACE_RS, GPIO_PIN_RESET);
+      writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_SET);
+      for (;;) {
+        uint8_t busy = readNibble() & 0x8;
+        if (!(_displayfunction & LCD_8BITMODE)) readNibble();   // low nibble, discarded
+        elapsed = cycles() - start;
+        if (!busy) break;
+        if (elapsed > timeout) {
+          elapsed = UINT32_MAX;
+          break;
+        }
+      }
+      writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_RESET);
+      setDataInput(false);
+      return elapsed;
+    }
+
+    /**
+     * @brief Reads D4-D7 during one enable pulse.
+     * @return The nibble, D7 in bit 3.
+     */
+    uint8_t LCD::readNibble(void) {
+      uint8_t value = 0;
+      writeEnable(1 << active(), GPIO_PIN_SET);
+      delayUs(1);    // data output delay is <360ns
+      for (int i = 0; i < 4; i++) {
+        if (HAL_GPIO_ReadPin(vPortData, _data_pins[i]) == GPIO_PIN_SET) value |= 1 << i;
+      }
+#if LCD_TRACE
+      if (_trace) {
+        uint8_t d0 = LCD_TRACE_D0 + ((_displayfunction & LCD_8BITMODE) ? 0 : 4);
+        for (int i = 0; i < 4; i++) _trace->record(d0 + i, (value >> i) & 1);
+      }
+#endif
+      writeEnable(1 << active(), GPIO_PIN_RESET);
+      delayUs(1);
+      return value;
+    }
+
+    /**
+     * @brief Switches the data pins between input, for reading, and output.
+     * @param input true for input, false for output.
+     * @param pull The pull resistors while input, GPIO_NOPULL when the controller drives the lines.
+     */
+    void LCD::setDataInput(bool input, uint32_t pull) {
+      GPIO_InitTypeDef gpio_init = {};
+      gpio_init.Pin = _data_pins[0] | _data_pins[1] | _data_pins[2] | _data_pins[3];
+      gpio_init.Mode = input ? GPIO_MODE_INPUT : GPIO_MODE_OUTPUT_PP;
+      gpio_init.Pull = input ? pull : GPIO_NOPULL;
+      gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+      HAL_GPIO_Init(vPortData, &gpio_init);
+#if LCD_TRACE
+      if (_trace) {
+        _trace->record(LCD_TRACE_DIR, input);
+        // back to output, the pins drive their output levels again
+        uint8_t d0 = LCD_TRACE_D0 + ((_displayfunction & LCD_8BITMODE) ? 0 : 4);
+        for (int i = 0; !input && i < 4; i++) _trace->record(d0 + i, (vPortData->ODR & _data_pins[i]) != 0);
+      }
+#endif
+    }
+
+    /**
+     * @brief Reads the address counter or one byte of DDRAM/CGRAM.
+     *
+     * The controller must not be busy, see waitBusy().
+     *
+     * @param mode GPIO_PIN_RESET for the busy flag and address counter, GPIO_PIN_SET for data.
+     * @return The byte read.
+     */
+    uint8_t LCD::readByte(GPIO_PinState mode) {
+      uint8_t value;
+
+      setDataInput(true);
+      writePin(vPortCtrlRS, vCtrlRS, LCD_TRACE_RS, mode);
+      writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_SET);
+      value = readNibble() << 4;
+      if (!(_displayfunction & LCD_8BITMODE)) value |= readNibble();
+      writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_RESET);
+      setDataInput(false);
+
+      // reading data moves the address counter like writing does
+      if (mode == GPIO_PIN_SET) stepAddress(active(), !(_entry & LCD_ENTRYLEFT));
+      return value;
+    }
+
+    /************ bus resynchronization **********/
+
+    /**
+     * @brief Checks the bus alignment and recovers it without a full initialization.
+     *
+     * A glitch on the enable line makes the controller take a stray nibble, after which
+     * every byte in 4-bit mode is received shifted by half a byte and the display shows
+     * garbage until Begin() is called again. This method reads back the address counter
+     * and compares it to the address the controller should be at. When they differ, it
+     * brings the interface back to 4-bit mode with the short function set sequence,
+     * restores the modes and display shift, and then reads back DDRAM and the CGRAM
+     * locations that were defined, rewriting only the cells that do not hold what was sent.
+     *
+     * The check costs one status read, so the method can be called periodically, for
+     * example once per display update. The recovery takes a few milliseconds with a
+     * calibrated timing profile, instead of Begin() plus a redraw.
+     *
+     * Without the RW pin nothing can be read back: the interface is always realigned and
+     * all of DDRAM and the defined CGRAM locations are rewritten.
+     *
+     * On panels with two controllers, each one is checked and recovered on its own.
+     *
+     * @return true if the bus was resynchronized, false if it was found aligned.
+     */
+    bool LCD::resync(void) {
+      LCD_STAT_SCOPE(LCD_STAT_RESYNC);
+      bool resynced = false;
+
+      // the state to return to, tracking follows the repair commands below
+      uint8_t entry = _entry;
+      uint8_t shift = _shift;
+
+      for (uint8_t c = 0; c < _controllers; c++) {
+        _pin = c;
+        if (vCtrlRW != 255 && waitBusy() != UINT32_MAX &&
+            (readByte(GPIO_PIN_RESET) & 0x7F) == _ac[c]) {
+          continue;
+        }
+        uint8_t ac = _ac[c];
+        bool ac_cgram = _ac_cgram[c];
+
+        realign();
+        command(LCD_FUNCTIONSET | _displayfunction);
+        command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);  // plain increment while repairing
+        command(LCD_RETURNHOME);  // stray commands may have shifted the display
+        if (!_timing.valid) delayMs(2);
+
+        repair(false, 0, sizeof(_ddram[c]));
+        for (uint8_t i = 0; i < 8; i++) {
+          if (_cg_defined & (1 << i)) repair(true, i * 8, 8);
+        }
+
+        uint8_t linelength = (_displayfunction & LCD_2LINE) ? 40 : 80;
+        if (shift <= linelength / 2) {
+          for (uint8_t i = 0; i < shift; i++) command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT);
+        } else {
+          for (uint8_t i = shift; i < linelength; i++) command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
+        }
+        command(LCD_ENTRYMODESET | entry);
+        command(LCD_DISPLAYCONTROL | _displaycontrol);
+        command((ac_cgram ? LCD_SETCGRAMADDR : LCD_SETDDRAMADDR) | ac);
+        resynced = true;
+      }
+      _pin = 0xFF;
+      return resynced;
+    }
+
+    /**
+     * @brief Brings the controller back to 4-bit mode from any nibble alignment.
+     *
+     * Three 0x3 nibbles put the controller in 8-bit mode whether it was waiting for the
+     * high nibble, the low nibble or was already in 8-bit mode, and 0x2 returns it to
+     * 4-bit mode. When it was waiting for the low nibble, the first 0x3 completes a
+     * command, which with RS low can at most move the address or reset the display shift.
+     */
+    void LCD::realign(void) {
+      waitReady(1 << active());
+      _en_mask = 1 << active();
+      writePin(vPortCtrlRS, vCtrlRS, LCD_TRACE_RS, GPIO_PIN_RESET);
+      if (vCtrlRW != 255) {
+        writePin(vPortCtrlRW, vCtrlRW, LCD_TRACE_RW, GPIO_PIN_RESET);
+      }
+
+      if (_displayfunction & LCD_8BITMODE) {
+        for (uint8_t i = 0; i < 3; i++) {
+          write8bits(LCD_FUNCTIONSET | _displayfunction);
+          if (_timing.valid) delayUs(_timing.command_us);
+        }
+        return;
+      }
+
+      write4bits(0x03);
+      if (_timing.valid) delayUs(_timing.clear_us);  // may have completed a return home
+      write4bits(0x03);
+      if (_timing.valid) delayUs(_timing.command_us);
+      write4bits(0x03);
+      if (_timing.valid) delayUs(_timing.command_us);
+      write4bits(0x02);
+      if (_timing.valid) delayUs(_timing.command_us);
+    }
+
+    /**
+     * @brief Rewrites the cells of DDRAM or CGRAM that differ from what was sent.
+     *
+     * With the RW pin, the cells are read back first and each run of mismatches is
+     * rewritten after a single address command. Without it, all cells are rewritten.
+     *
+     * @param cgram true for CGRAM, false for DDRAM.
+     * @param first The first cell, a DDRAM index (see ddramIndex()) or CGRAM address.
+     * @param count The number of cells, at most the size of the DDRAM shadow.
+     * @note Works on the controller returned by active().
+     * @return The number of cells rewritten.
+     */
+    size_t LCD::repair(bool cgram, uint8_t first, uint8_t count) {
+      const uint8_t* want = cgram ? _cgram : _ddram[active()];
+      uint8_t mask = cgram ? 0x1F : 0xFF;   // CGRAM rows are 5 bits wide
+      uint8_t set = cgram ? LCD_SETCGRAMADDR : LCD_SETDDRAMADDR;
+      uint8_t got[sizeof(_ddram[0])];
+      bool verify = (vCtrlRW != 255);
+      size_t fixed = 0;
+
+      if (verify) {
+        command(set | (cgram ? first : ddramAddress(first)));
+        for (uint8_t i = 0; i < count; i++) {
+          waitBusy();
+          got[i] = readByte(GPIO_PIN_SET);
+        }
+      }
+
+      bool in_run = false;
+      for (uint8_t i = 0; i < count; i++) {
+        uint8_t cell = first + i;
+        if (verify && !((got[i] ^ want[cell]) & mask)) {
+          in_run = false;
+          continue;
+        }
+        if (!in_run) command(set | (cgram ? cell : ddramAddress(cell)));
+        in_run = true;
+        write(want[cell]);
+        fixed++;
+      }
+      return fixed;
+    }
+
+    /**
+     * @brief Checks a few DDRAM and CGRAM cells and rewrites those that changed.
+     *
+     * Interference or a brown-out can corrupt single characters, which then stay on
+     * screen until the next redraw. Each call continues where the previous one stopped,
+     * reads cells back and rewrites the ones that no longer hold what was sent, until the
+     * budget is used up. Over successive calls all of DDRAM and the defined CGRAM
+     * locations are covered, so a periodic call replaces clearing and repainting the
+     * screen, without the flicker.
+     *
+     * The time of a read and of a rewrite is measured and the next cell is only started
+     * when it fits, so the call stays within the budget. A mismatch that does not fit is
+     * repaired first in the next call. Needs the RW pin; with the default delays a
+     * rewrite takes milliseconds, so a calibrated timing profile is recommended.
+     *
+     * @note The cells are compared as sent, so call resync() first when the bus may have
+     *       lost its alignment.
+     * @param budget_us The maximum time the call may take.
+     * @return The number of cells rewritten.
+     */
+    size_t LCD::scrub(uint32_t budget_us) {
+      LCD_STAT_SCOPE(LCD_STAT_RESYNC);
+      if (vCtrlRW == 255) return 0;
+
+      const uint16_t cells = sizeof(_ddram[0]) + sizeof(_cgram);   // per controller
+      uint32_t start = cycles();
+      uint32_t per_us = SystemCoreClock / 1000000;
+      uint32_t budget = budget_us * (per_us ? per_us : 1);
+      uint32_t command_cost = byteCycles();
+      uint32_t read_cost = _scrub_read ? _scrub_read : command_cost;
+      uint32_t write_cost = _scrub_write ? _scrub_write : 2 * command_cost;
+      uint8_t ac[LCD_MAX_CONTROLLERS];
+      bool ac_cgram[LCD_MAX_CONTROLLERS];
+      size_t fixed = 0;
+
+      memcpy(ac, _ac, sizeof(ac));
+      memcpy(ac_cgram, _ac_cgram, sizeof(ac_cgram));
+      if (_scrub_pos >= _controllers * cells) _scrub_pos = 0;
+
+      for (uint16_t checked = 0; checked < _controllers * cells; checked++) {
+        uint8_t c = _scrub_pos / cells;
+        uint8_t pos = _scrub_pos % cells;
+        bool cg = pos >= sizeof(_ddram[0]);
+        if (cg && !(_cg_defined & (1 << ((pos - sizeof(_ddram[0])) >> 3)))) {
+          _scrub_pos = (_scrub_pos + 8) % (_controllers * cells);
+          continue;   // undefined CGRAM location, nothing to compare with
+        }
+
+        uint8_t address = cg ? pos - sizeof(_ddram[0]) : ddramAddress(pos);
+        uint8_t set = cg ? LCD_SETCGRAMADDR : LCD_SETDDRAMADDR;
+        bool seek = (_ac_cgram[c] != cg || _ac[c] != address);
+        // room for the read, and for the command that restores the address afterwards
+        if (cycles() - start + (seek ? command_cost : 0) + read_cost + command_cost > budget) break;
+
+        _pin = c;
+        if (seek) command(set | address);
+        uint32_t t = cycles();
+        waitBusy();
+        uint8_t got = readByte(GPIO_PIN_SET);
+        uint8_t want = cg ? _cgram[address] : _ddram[c][pos];
+        uint32_t now = cycles();
+        if (now - t > _scrub_read) _scrub_read = read_cost = now - t;
+
+        if ((got ^ want) & (cg ? 0x1F : 0xFF)) {   // CGRAM rows are 5 bits wide
+          if (now - start + write_cost + command_cost > budget) break;
+          uint8_t entry = _entry;
+          command(set | address);
+          if (entry & LCD_ENTRYSHIFTINCREMENT) command(LCD_ENTRYMODESET | (entry & LCD_ENTRYLEFT));
+          write(want);
+          if (entry & LCD_ENTRYSHIFTINCREMENT) command(LCD_ENTRYMODESET | entry);
+          fixed++;
+          t = now;
+          now = cycles();
+          if (now - t > _scrub_write) _scrub_write = write_cost = now - t;
+        }
+        _scrub_pos = (_scrub_pos + 1) % (_controllers * cells);
+      }
+
+      for (uint8_t c = 0; c < _controllers; c++) {
+        if (_ac[c] == ac[c] && _ac_cgram[c] == ac_cgram[c]) continue;
+        _pin = c;
+        command((ac_cgram[c] ? LCD_SETCGRAMADDR : LCD_SETDDRAMADDR) | ac[c]);
+      }
+      _pin = 0xFF;
+      return fixed;
+    }
+
+    /**
+     * @brief Returns the expected bus time of one byte in cycles, from the timing profile
+     *        or from the default delays.
+     */
+    uint32_t LCD::byteCycles(void) const {
+      uint32_t per_us = SystemCoreClock / 1000000;
+      uint32_t us = _timing.valid ? ((_timing.command_us > _timing.data_us) ? _timing.command_us : _timing.data_us) + 10
+                                  : 6000;   // two enable pulses of 3 ms
+      return us * (per_us ? per_us : 1);
+    }
+
+    /**
+     * @brief Updates the expected state of a controller for a byte sent to it.
+     * @param ctrl The controller.
+     * @param value The command or data byte.
+     * @param mode GPIO_PIN_RESET for a command, GPIO_PIN_SET for data.
+     * @param shared true to also update the state common to all controllers, false when
+     *        the same byte has already been tracked for another controller.
+     */
+    void LCD::track(uint8_t ctrl, uint8_t value, GPIO_PinState mode, bool shared) {
+      uint8_t linelength = (_displayfunction & LCD_2LINE) ? 40 : 80;
+      uint8_t& ac = _ac[ctrl];
+      bool& ac_cgram = _ac_cgram[ctrl];
+
+      if (mode == GPIO_PIN_SET) {
+        if (ac_cgram) {
+          _cgram[ac] = value;
+          _cg_defined |= 1 << (ac >> 3);
+        } else {
+          _ddram[ctrl][ddramIndex(ac)] = value;
+          if (shared && (_entry & LCD_ENTRYSHIFTINCREMENT)) {
+            _shift = (_entry & LCD_ENTRYLEFT) ? (_shift + 1) % linelength : (_shift + linelength - 1) % linelength;
+          }
+        }
+        stepAddress(ctrl, !(_entry & LCD_ENTRYLEFT));
+        return;
+      }
+
+      if (value & LCD_SETDDRAMADDR) {
+        ac = value & 0x7F;
+        ac_cgram = false;
+      } else if (value & LCD_SETCGRAMADDR) {
+        ac = value & 0x3F;
+        ac_cgram = true;
+      } else if (value & LCD_FUNCTIONSET) {
+        // no effect on addresses or content
+      } else if (value & LCD_CURSORSHIFT) {
+        if (!(value & LCD_DISPLAYMOVE)) {
+          stepAddress(ctrl, !(value & LCD_MOVERIGHT));
+        } else if (!shared) {
+          // the display shift is common to all controllers
+        } else if (value & LCD_MOVERIGHT) {
+          _shift = (_shift + linelength - 1) % linelength;
+        } else {
+          _shift = (_shift + 1) % linelength;
+        }
+      } else if (value & LCD_DISPLAYCONTROL) {
+        // no effect on addresses or content
+      } else if (value & LCD_ENTRYMODESET) {
+        _entry = value & (LCD_ENTRYLEFT | LCD_ENTRYSHIFTINCREMENT);
+      } else if (value & LCD_RETURNHOME) {
+        ac = 0;
+        ac_cgram = false;
+        _shift = 0;
+      } else if (value & LCD_CLEARDISPLAY) {
+        memset(_ddram[ctrl], ' ', sizeof(_ddram[ctrl]));
+        ac = 0;
+        ac_cgram = false;
+        _shift = 0;
+        _entry |= LCD_ENTRYLEFT;  // clear also sets the increment mode
+      }
+    }
+
+    /**
+     * @brief Moves the expected address counter of a controller by one, as the controller
+     *        does after a read or write.
+     * @param ctrl The controller.
+     * @param decrement true to move down, false to move up.
+     */
+    void LCD::stepAddress(uint8_t ctrl, bool decrement) {
+      uint8_t& ac = _ac[ctrl];
+      if (_ac_cgram[ctrl]) {
+        ac = (ac + (decrement ? 63 : 1)) & 0x3F;
+        return;
+      }
+      uint8_t i = ddramIndex(ac);
+      i = decrement ? (i ? i - 1 : sizeof(_ddram[0]) - 1) : (i + 1) % sizeof(_ddram[0]);
+      ac = ddramAddress(i);
+    }
+
+    /**
+     * @brief Converts a DDRAM address to an index of the DDRAM shadow.
+     *
+     * The two lines of a 2-line display are at 0x00-0x27 and 0x40-0x67, the single
+     * line of a 1-line display at 0x00-0x4F. Both map to 0-79.
+     */
+    uint8_t LCD::ddramIndex(uint8_t address) const {
+      if (!(_displayfunction & LCD_2LINE)) return address % 80;
+      return (address >= 0x40) ? 40 + (address - 0x40) % 40 : address % 40;
+    }
+
+    /**
+     * @brief Converts an index of the DDRAM shadow to a DDRAM address.
+     */
+    uint8_t LCD::ddramAddress(uint8_t index) const {
+      if ((_displayfunction & LCD_2LINE) && index >= 40) return 0x40 + index - 40;
+      return index;
+    }
+
+#if LCD_TRACE
+    /**
+     * @brief Attaches a trace that records every change of the bus pins.
+     *
+     * @param trace The trace, or nullptr to stop recording.
+     */
+    void LCD::setTrace(LCDTrace* trace) {
+      _trace = trace;
+    }
+#endif
+
+    /************ performance counters **********/
+
+    /**
+     * @brief Copies the performance counters of this display.
+     *
+     * The counters are only maintained when the library is built with LCD_STATS set to 1,
+     * otherwise all counters read as zero.
+     *
+     * @param stats Receives the counters.
+     */
+    void LCD::getStats(LCD_Stats* stats) const {
+#if LCD_STATS
+      *stats = _stats;
+#else
+      memset(stats, 0, sizeof(*stats));
+#endif
+    }
+
+    /**
+     * @brief Sets all performance counters of this display to zero.
+     */
+    void LCD::resetStats(void) {
+#if LCD_STATS
+      memset(&_stats, 0, sizeof(_stats));
+#endif
+    }
+
+    /**
+     * @brief Returns the DWT cycle counter, enabling it on first use.
+     *
+     * Only used with LCD_STATS, a timing profile or a wait strategy, and by the features that
+     * read the busy flag or keep a time budget. Displays using the default delays never
+     * call it.
+     */
+    uint32_t LCD::cycles(void) {
+      if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR = CoreDebug->DEMCR | CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL = DWT->CTRL | DWT_CTRL_CYCCNTENA_Msk;
+      }
+      return DWT->CYCCNT;
+    }
+
+    /**
+     * @brief Converts core clock cycles to microseconds.
+     */
+    uint32_t LCD::cyclesToUs(uint32_t cycles) {
+      uint32_t per_us = SystemCoreClock / 1000000;
+      return cycles / (per_us ? per_us : 1);
+    }
+
+#if LCD_STATS
+    LCD::StatScope::StatScope(LCD* owner, uint8_t m) : lcd(owner), method(m) {
+      lcd->_stat_depth++;
+      start = cycles();
+    }
+
+    LCD::StatScope::~StatScope() {
+      if (--lcd->_stat_depth) return;   // only the outermost call is recorded
 
+      uint32_t us = cyclesToUs(cycles() - start);
+      LCD_MethodStats& s = lcd->_stats.method[method];
+      s.calls++;
+      s.total_us += us;
+      if (us > s.max_us) s.max_us = us;
+
+      uint8_t bucket = 0;
+      for (uint32_t limit = 4; us >= limit && bucket < LCD_STAT_BUCKETS - 1; limit <<= 2) {
+        bucket++;
+      }
+      s.histogram[bucket]++;
+    }
+#endif
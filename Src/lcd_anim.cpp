@@ -0,0 +1,159 @@
+/**
+ * @file lcd_anim.cpp
+ * @brief Animated custom characters, updated with only the CGRAM rows that change.
+ */
+
+#include "lcd_anim.hpp"
+
+/**
+ * @brief Creates an animator for the given display.
+ *
+ * @param lcd The display, initialized with Begin().
+ */
+LCDAnimator::LCDAnimator(LCD& lcd) : _lcd(lcd) {
+}
+
+/**
+ * @brief Starts an animation in a CGRAM location and uploads its first frame.
+ *
+ * @param location The CGRAM location (0-7). An animation already there is replaced.
+ * @param rows The frame patterns, 8 bytes each.
+ * @param changed For each frame, the rows that differ in the next frame.
+ * @param frames The number of frames.
+ * @param period_ms The time each frame is shown, at least LCD_ANIM_MIN_PERIOD_MS.
+ * @return false if LCD_ANIM_MAX animations are already running.
+ */
+bool LCDAnimator::addFrames(uint8_t location, const uint8_t* rows, const uint8_t* changed, uint8_t frames,
+                            uint16_t period_ms) {
+    location &= 0x7;
+    Entry* e = find(location);
+    if (!e) {
+        if (_count >= LCD_ANIM_MAX) return false;
+        e = &_entries[_count++];
+    }
+    e->rows = rows;
+    e->changed = changed;
+    e->frames = frames;
+    e->frame = 0;
+    e->location = location;
+    e->paused = false;
+    e->period = (period_ms < LCD_ANIM_MIN_PERIOD_MS) ? LCD_ANIM_MIN_PERIOD_MS : period_ms;
+    e->last = HAL_GetTick();
+    _lcd.createChar(location, rows);
+    return true;
+}
+
+/**
+ * @brief Stops the animation in a CGRAM location, which keeps showing its current frame.
+ * @return false if there is no animation in the location.
+ */
+bool LCDAnimator::remove(uint8_t location) {
+    Entry* e = find(location);
+    if (!e) return false;
+    *e = _entries[--_count];
+    return true;
+}
+
+/**
+ * @brief Pauses or resumes an animation. A resumed animation shows its next frame after
+ *        one full period.
+ * @return false if there is no animation in the location.
+ */
+bool LCDAnimator::pause(uint8_t location, bool paused) {
+    Entry* e = find(location);
+    if (!e) return false;
+    if (e->paused && !paused) e->last = HAL_GetTick();
+    e->paused = paused;
+    return true;
+}
+
+/**
+ * @brief Shows a given frame now, e.g. the level of a paused gauge.
+ *
+ * Only the rows that differ from the frame shown are written.
+ *
+ * @param location The CGRAM location of the animation.
+ * @param frame The frame to show.
+ * @return false if there is no animation in the location or no such frame.
+ */
+bool LCDAnimator::show(uint8_t location, uint8_t frame) {
+    Entry* e = find(location);
+    if (!e || frame >= e->frames) return false;
+    e->last = HAL_GetTick();
+    uint8_t ctrl = _lcd._cur, ac = _lcd._ac[ctrl];
+    if (step(*e, frame, 0xFF)) _lcd.restoreCursor(ctrl, ac);
+    return true;
+}
+
+/**
+ * @brief Advances the animations whose frame period has passed.
+ *
+ * An animation that fell behind by several periods skips to the frame it should show
+ * rather than playing the missed ones. The DDRAM address is restored once, after all
+ * updates.
+ *
+ * @return The number of bytes sent to the display.
+ */
+size_t LCDAnimator::tick(void) {
+    uint32_t now = HAL_GetTick();
+    uint8_t ctrl = _lcd._cur, ac = _lcd._ac[ctrl];
+    size_t sent = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        Entry& e = _entries[i];
+        uint32_t elapsed = now - e.last;
+        if (e.paused || elapsed < e.period) continue;
+
+        uint32_t steps = elapsed / e.period;
+        e.last += steps * e.period;
+        uint8_t frame = (e.frame + steps) % e.frames;
+        sent += step(e, frame, (steps == 1) ? e.changed[e.frame] : 0xFF);
+    }
+    if (sent && _lcd.restoreCursor(ctrl, ac)) sent++;
+    return sent;
+}
+
+/**
+ * @brief Finds the animation in a CGRAM location.
+ */
+LCDAnimator::Entry* LCDAnimator::find(uint8_t location) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].location == location) return &_entries[i];
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Writes the rows of a frame that differ from the frame shown.
+ *
+ * The CGRAM address is only set where the address counter of every controller does not
+ * already point to the row, so a run of changed rows takes one address command.
+ *
+ * @param e The animation.
+ * @param frame The frame to show.
+ * @param changed The rows that may differ, one bit each. Rows of other bits are skipped
+ *        without comparing.
+ * @return The number of bytes sent, the address counter is left in CGRAM if not 0.
+ */
+size_t LCDAnimator::step(Entry& e, uint8_t frame, uint8_t changed) {
+    const uint8_t* from = e.rows + 8 * e.frame;
+    const uint8_t* to = e.rows + 8 * frame;
+    size_t sent = 0;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!(changed & (1 << i)) || from[i] == to[i]) continue;
+        uint8_t address = (e.location << 3) | i;
+        bool there = true;
+        for (uint8_t c = 0; c < _lcd._controllers; c++) {
+            there = there && _lcd._ac_cgram[c] && _lcd._ac[c] == address;
+        }
+        if (!there) {
+            _lcd.command(LCD_SETCGRAMADDR | address);
+            sent++;
+        }
+        _lcd.write(to[i]);
+        sent++;
+    }
+    e.frame = frame;
+    return sent;
+}
@@ -0,0 +1,240 @@
+/**
+ * @file lcd_async.cpp
+ * @brief Awaitable LCD operations for cooperative schedulers, built on C++20 coroutines.
+ */
+
+#include "lcd_async.hpp"
+
+#if defined(__cpp_impl_coroutine)
+#include <cstddef>
+
+static_assert(LCD_ASYNC_FRAME_SIZE % alignof(std::max_align_t) == 0,
+              "LCD_ASYNC_FRAME_SIZE must be a multiple of the maximum alignment");
+
+alignas(std::max_align_t) static unsigned char frame_pool[LCD_ASYNC_FRAMES][LCD_ASYNC_FRAME_SIZE];
+static uint32_t frames_used = 0;    // one bit per slot
+static size_t largest_frame = 0;
+
+/**
+ * @brief Takes a free slot of the frame pool for a new coroutine.
+ *
+ * @param size The size of the coroutine frame.
+ * @return The slot, or nullptr if the frame is too large or all slots are in use.
+ */
+void* LCDTask::promise_type::operator new(size_t size) noexcept {
+    if (size > largest_frame) largest_frame = size;
+    if (size > LCD_ASYNC_FRAME_SIZE) return nullptr;
+
+    for (uint8_t i = 0; i < LCD_ASYNC_FRAMES; i++) {
+        if (frames_used & (1UL << i)) continue;
+        frames_used |= 1UL << i;
+        return frame_pool[i];
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Returns the slot of a finished coroutine to the frame pool.
+ */
+void LCDTask::promise_type::operator delete(void* frame) noexcept {
+    size_t i = (static_cast<unsigned char*>(frame) - &frame_pool[0][0]) / LCD_ASYNC_FRAME_SIZE;
+    frames_used &= ~(1UL << i);
+}
+
+/**
+ * @brief Runs a top-level task until its first suspension.
+ *
+ * Call it once. Tasks awaited by another coroutine are started by the co_await.
+ *
+ * @return false if the task could not be created or has already ended.
+ */
+bool LCDTask::start(void) {
+    if (done()) return false;
+    _handle.resume();
+    return true;
+}
+
+/**
+ * @brief Returns the number of frame pool slots in use.
+ */
+uint8_t LCDTask::framesInUse(void) {
+    uint8_t n = 0;
+    for (uint32_t used = frames_used; used; used &= used - 1) n++;
+    return n;
+}
+
+/**
+ * @brief Returns the largest coroutine frame requested so far, for sizing LCD_ASYNC_FRAME_SIZE.
+ */
+size_t LCDTask::largestFrame(void) {
+    return largest_frame;
+}
+
+/**
+ * @brief Creates the awaitable operations of a display.
+ *
+ * @param lcd The display.
+ * @param clock Function returning a free running tick counter that times the waits.
+ *        When nullptr, the DWT cycle counter is used.
+ * @param clock_hz The tick rate of the clock. When 0, SystemCoreClock is used.
+ */
+LCDAsync::LCDAsync(LCD& lcd, uint32_t (*clock)(void), uint32_t clock_hz) : _lcd(lcd) {
+    _clock = clock ? clock : LCD::cycles;
+    _clock_hz = clock_hz ? clock_hz : SystemCoreClock;
+}
+
+/**
+ * @brief Sets a function called each time a coroutine suspends.
+ *
+ * Typically arms a timer, or a task notification, that calls poll() after the delay.
+ *
+ * @param wakeup The function, or nullptr for none.
+ * @param context Passed to the function.
+ */
+void LCDAsync::setWakeup(void (*wakeup)(uint32_t delay_us, void* context), void* context) {
+    _wakeup_context = context;
+    _wakeup = wakeup;
+}
+
+/**
+ * @brief Resumes the waiting coroutine if its wait is over.
+ *
+ * The coroutine runs until its next wait, which usually sends one byte to the display.
+ *
+ * @return true if a coroutine is still waiting afterwards.
+ */
+bool LCDAsync::poll(void) {
+    if (!_waiter) return false;
+    if (_clock() - _start < _ticks) return true;
+
+    std::coroutine_handle<> waiter = _waiter;
+    _waiter = nullptr;
+    waiter.resume();
+    return (bool)_waiter;
+}
+
+/**
+ * @brief Initializes the display like LCD::Begin(), suspending during the power-on waits.
+ *
+ * When the display has no timing profile, the worst case one of LCD_ASYNC_COMMAND_US and
+ * LCD_ASYNC_CLEAR_US is installed and stays installed: the awaitable operations need it to
+ * know how long to suspend. It also applies to the methods of the LCD itself, which then
+ * wait these times instead of the default delays. calibrate() replaces it with measured
+ * times, setTiming() with a profile whose valid is 0 returns to the default delays.
+ *
+ * @param cols The number of columns on the LCD.
+ * @param rows The number of rows on the LCD.
+ */
+LCDTask LCDAsync::begin(int cols, int rows) {
+    if (!_lcd._timing.valid) {
+        const LCD_Timing worst = { LCD_ASYNC_COMMAND_US, LCD_ASYNC_COMMAND_US, LCD_ASYNC_CLEAR_US, 1 };
+        _lcd.setTiming(&worst);
+    }
+    _lcd.prepare(cols, rows);
+    co_await sleep(50000);
+
+    // HD44780 datasheet figure 24: three times 8-bit mode, then 4-bit mode
+    _lcd.write4bits(0x03);
+    co_await sleep(5000);
+    _lcd.write4bits(0x03);
+    co_await sleep(5000);
+    _lcd.write4bits(0x03);
+    co_await sleep(1000);
+    _lcd.write4bits(0x02);
+    co_await sleep(_lcd._timing.command_us);
+
+    _lcd.command(LCD_FUNCTIONSET | _lcd._displayfunction);
+    co_await ready();
+    _lcd._displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+    _lcd.display();
+    co_await ready();
+    _lcd.clear();
+    co_await ready();
+    _lcd._displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+    _lcd.command(LCD_ENTRYMODESET | _lcd._displaymode);
+}
+
+/**
+ * @brief Prints text at the cursor position, like LCD::printLCD().
+ *
+ * @param text The text, up to its terminating 0.
+ */
+LCDTask LCDAsync::print(const char* text) {
+    for (; *text; text++) {
+        co_await ready();
+        _lcd.writeCells(reinterpret_cast<const uint8_t*>(text), 1);
+    }
+}
+
+/**
+ * @brief Writes raw character codes at the cursor position, like LCD::writeCells().
+ *
+ * @param cells The character codes.
+ * @param len The number of character codes.
+ */
+LCDTask LCDAsync::writeCells(const uint8_t* cells, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        co_await ready();
+        _lcd.writeCells(cells + i, 1);
+    }
+}
+
+/**
+ * @brief Sets the cursor position, like LCD::setCursor().
+ *
+ * @param x The column.
+ * @param y The row.
+ */
+LCDTask LCDAsync::setCursor(uint8_t x, uint8_t y) {
+    co_await ready();
+    _lcd.setCursor(x, y);
+}
+
+/**
+ * @brief Defines a custom character, like LCD::createChar().
+ *
+ * @param location The CGRAM location (0-7).
+ * @param charmap The 8 rows of the character.
+ */
+LCDTask LCDAsync::createChar(uint8_t location, const uint8_t charmap[]) {
+    co_await ready();
+    uint8_t ctrl = _lcd._cur, ac = _lcd._ac[_lcd._cur];
+    bool left = _lcd._entry & LCD_ENTRYLEFT;   // right to left text decrements the address
+    _lcd.command(LCD_SETCGRAMADDR | ((location & 0x7) << 3) | (left ? 0 : 7));
+    for (uint8_t i = 0; i < 8; i++) {
+        co_await ready();
+        _lcd.write(charmap[left ? i : 7 - i]);
+    }
+    co_await ready();
+    _lcd.restoreCursor(ctrl, ac);
+}
+
+/**
+ * @brief Runs an LCD method that sends a single command, once the display is ready.
+ */
+LCDTask LCDAsync::call(void (LCD::*method)(void)) {
+    co_await ready();
+    (_lcd.*method)();
+}
+
+/**
+ * @brief Returns a wait for the byte the display is still executing.
+ *
+ * Waits shorter than LCD_ASYNC_SPIN_US do not suspend, the LCD call busy waits them.
+ */
+LCDAsync::Wait LCDAsync::ready(void) {
+    uint32_t us = _lcd.getBusyTime();
+    return Wait{ *this, (us >= LCD_ASYNC_SPIN_US) ? us : 0 };
+}
+
+/**
+ * @brief Records a suspended coroutine, to be resumed by poll() after the given time.
+ */
+void LCDAsync::suspend(std::coroutine_handle<> waiter, uint32_t us) {
+    _waiter = waiter;
+    _start = _clock();
+    _ticks = ((uint64_t)us * _clock_hz + 999999) / 1000000;
+    if (_wakeup) _wakeup(us, _wakeup_context);
+}
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,207 @@
+/**
+ * @file lcd_budget.cpp
+ * @brief Printing in slices of bounded bus time, continued across calls.
+ */
+
+#include "lcd_budget.hpp"
+#include <cstring>
+
+/**
+ * @brief Creates a budgeted printer for the given display.
+ *
+ * @param lcd The display, initialized with Begin() and given a timing profile.
+ */
+LCDBudget::LCDBudget(LCD& lcd) : _lcd(lcd) {
+}
+
+/**
+ * @brief Starts printing a text at the cursor position, within a time budget.
+ *
+ * @param text The text.
+ * @param budget_us The maximum time the call may take.
+ * @param max_bytes The maximum number of bytes sent, commands included, 0 for no limit.
+ * @param mode LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS, see printRows().
+ * @return The rest of the text, for resume().
+ */
+LCDContinuation LCDBudget::print(const char* text, uint32_t budget_us, uint16_t max_bytes, uint8_t mode) {
+    return print(reinterpret_cast<const uint8_t*>(text), strlen(text), budget_us, max_bytes, mode);
+}
+
+/**
+ * @brief Starts writing raw character codes at the cursor position, within a time budget.
+ *
+ * @param cells The character codes, code 0 included.
+ * @param len The number of character codes.
+ * @param budget_us The maximum time the call may take.
+ * @param max_bytes The maximum number of bytes sent, commands included, 0 for no limit.
+ * @param mode LCD_PRINT_WRAP, LCD_PRINT_CLIP or LCD_PRINT_ELLIPSIS, see printRows().
+ * @return The rest of the text, for resume().
+ */
+LCDContinuation LCDBudget::print(const uint8_t* cells, size_t len, uint32_t budget_us, uint16_t max_bytes,
+                                 uint8_t mode) {
+    LCDContinuation next;
+    next.text = cells;
+    next.len = len;
+    next.col = _lcd._col;
+    next.row = _lcd._row;
+    next.mode = mode;
+    return resume(next, budget_us, max_bytes);
+}
+
+/**
+ * @brief Continues printing a text, within a time budget.
+ *
+ * Before each step, a character or a cursor move, the time the controllers still execute
+ * and the bus time of the step are added to the time spent so far, and the step is only
+ * taken when the sum is within the budget. A call that cannot take the next step returns
+ * at once; see minBudget(). The waits for the controllers spin: the busy hook and the
+ * sleep strategy of the display are not called during the call.
+ *
+ * @param next The continuation returned by the previous call.
+ * @param budget_us The maximum time the call may take.
+ * @param max_bytes The maximum number of bytes sent, commands included, 0 for no limit.
+ * @return The rest of the text, done() when all of it is shown.
+ */
+LCDContinuation LCDBudget::resume(LCDContinuation next, uint32_t budget_us, uint16_t max_bytes) {
+    uint32_t start = LCD::cycles();
+    uint32_t per_us = SystemCoreClock / 1000000;
+    uint32_t budget = budget_us * (per_us ? per_us : 1);
+    uint32_t execute = executeCycles();
+    uint16_t sent = 0;
+
+    // the busy hook and the sleep strategy may take longer than the wait they are given,
+    // so the waits within the budget spin
+    void (*busy_hook)(uint32_t us, void* context) = _lcd._busy_hook;
+    LCD_SleepFunc sleep = _lcd._sleep;
+    _lcd._busy_hook = nullptr;
+    _lcd._sleep = nullptr;
+
+    while (next.len) {
+        uint8_t col = next.col, row = next.row;
+        if (col >= _lcd._numcols) {
+            if (next.mode != LCD_PRINT_WRAP || row + 1 >= _lcd._numlines) {
+                next.len = 0;       // the rest is clipped
+                break;
+            }
+            col = 0;
+            row++;
+        }
+
+        // the cursor is moved there first, at the start of a row or when other code printed
+        // since the last call: a DDRAM address command, after two display controls when the
+        // cursor is shown and moves to the other controller
+        bool seek = (_lcd._col != col || _lcd._row != row);
+        uint8_t bytes = seek ? seekBytes(row) : 1;
+        if (max_bytes && sent + bytes > max_bytes) break;
+        uint32_t cost = busyCycles() + bytes * transferCycles() + (bytes - 1) * execute;
+        if (LCD::cycles() - start + cost > budget) break;
+
+        _lcd.waitReady((1 << _lcd._controllers) - 1);
+        uint32_t t = LCD::cycles();
+        bool ellipsis = false;
+        if (seek) {
+            _lcd.setCursor(col, row);
+        } else {
+            ellipsis = (next.mode == LCD_PRINT_ELLIPSIS && col + 1 == _lcd._numcols && next.len > 1);
+            uint8_t code = ellipsis ? LCD_ELLIPSIS_CHAR : *next.text;
+            _lcd.writeCells(&code, 1);
+        }
+
+        // the execution of a command before the last byte was waited for in between
+        uint32_t took = LCD::cycles() - t;
+        uint32_t waited = (bytes - 1) * execute;
+        uint32_t per_byte = (took > waited) ? (took - waited + bytes - 1) / bytes : 0;
+        if (_lcd._timing.valid && per_byte > _byte_cycles) _byte_cycles = per_byte;
+        sent += bytes;
+        if (seek) continue;
+
+        next.col = col + 1;
+        next.row = row;
+        if (ellipsis) {
+            next.len = 0;
+        } else {
+            next.text++;
+            next.len--;
+        }
+    }
+
+    _lcd._busy_hook = busy_hook;
+    _lcd._sleep = sleep;
+
+    _last_call_us = LCD::cyclesToUs(LCD::cycles() - start);
+    if (_last_call_us > _max_call_us) _max_call_us = _last_call_us;
+    return next;
+}
+
+/**
+ * @brief Returns the bus time of one byte assumed by the budget check.
+ *
+ * @return The time in microseconds, without the execution time of the controller.
+ */
+uint32_t LCDBudget::byteTime(void) const {
+    uint32_t per_us = SystemCoreClock / 1000000;
+    if (!per_us) per_us = 1;
+    return (transferCycles() + per_us - 1) / per_us;
+}
+
+/**
+ * @brief Returns the smallest budget that always lets a call send something.
+ *
+ * A call sends nothing when the next step does not fit, so a smaller budget never gets
+ * the text printed. The largest step is one byte, or on panels with two controllers the
+ * three commands that move a shown cursor to the other controller, which is also the
+ * smallest byte limit that always lets a call send something. The wait for the previous
+ * byte is not included, as it passes between calls.
+ *
+ * @return The budget in microseconds.
+ */
+uint32_t LCDBudget::minBudget(void) const {
+    uint32_t per_us = SystemCoreClock / 1000000;
+    if (!per_us) per_us = 1;
+    uint8_t bytes = (_lcd._controllers > 1) ? 3 : 1;
+    return (bytes * transferCycles() + (bytes - 1) * executeCycles() + per_us - 1) / per_us;
+}
+
+/**
+ * @brief Returns the number of commands setCursor() sends to move to a row: moving a shown
+ *        cursor to the other controller hides it on one and shows it on the other first.
+ */
+uint8_t LCDBudget::seekBytes(uint8_t row) const {
+    uint8_t ctrl = (_lcd._controllers > 1 && row >= _lcd._numlines / 2) ? 1 : 0;
+    return (ctrl != _lcd._cur && (_lcd._displaycontrol & (LCD_CURSORON | LCD_BLINKON))) ? 3 : 1;
+}
+
+/**
+ * @brief Returns how long the controllers still execute the last byte sent, in cycles.
+ */
+uint32_t LCDBudget::busyCycles(void) const {
+    uint32_t wait = 0;
+    for (uint8_t c = 0; c < _lcd._controllers; c++) {
+        if (!_lcd._exec[c]) continue;
+        uint32_t elapsed = LCD::cycles() - _lcd._sent[c];
+        if (elapsed < _lcd._exec[c] && _lcd._exec[c] - elapsed > wait) wait = _lcd._exec[c] - elapsed;
+    }
+    return wait;
+}
+
+/**
+ * @brief Returns the bus time of one byte in cycles: the slowest one measured, at least
+ *        LCD_BUDGET_BYTE_US, or the default delays while there is no timing profile.
+ */
+uint32_t LCDBudget::transferCycles(void) const {
+    if (!_lcd._timing.valid) return _lcd.byteCycles();
+    uint32_t per_us = SystemCoreClock / 1000000;
+    uint32_t assumed = LCD_BUDGET_BYTE_US * (per_us ? per_us : 1);
+    return (_byte_cycles > assumed) ? _byte_cycles : assumed;
+}
+
+/**
+ * @brief Returns the longest execution time of a command or data byte in cycles, 0 while
+ *        there is no timing profile, since the default delays include it.
+ */
+uint32_t LCDBudget::executeCycles(void) const {
+    if (!_lcd._timing.valid) return 0;
+    uint32_t per_us = SystemCoreClock / 1000000;
+    uint16_t us = (_lcd._timing.command_us > _lcd._timing.data_us) ? _lcd._timing.command_us : _lcd._timing.data_us;
+    return us * (per_us ? per_us : 1);
+}
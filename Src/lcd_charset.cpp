@@ -0,0 +1,369 @@
+/**
+ * @file lcd_charset.cpp
+ * @brief UTF-8 decoding and character ROM translation tables.
+ */
+
+#include "lcd_charset.hpp"
+
+/*********** translation tables, generated at compile time */
+
+namespace {
+
+struct RomPair {
+    uint16_t cp;
+    uint8_t code;
+};
+
+// Code points outside the generated pages, sorted by code point.
+constexpr RomPair a00_pairs[] = {
+    { 0x00A0, 0x20 },   // no-break space
+    { 0x00A2, 0xEC },   // ¢
+    { 0x00A3, 0xED },   // £
+    { 0x00A5, 0x5C },   // ¥
+    { 0x00B0, 0xDF },   // ° (shares the handakuten glyph)
+    { 0x00B5, 0xE4 },   // µ
+    { 0x00B7, 0xA5 },   // ·
+    { 0x00E4, 0xE1 },   // ä
+    { 0x00F1, 0xEE },   // ñ
+    { 0x00F6, 0xEF },   // ö
+    { 0x00F7, 0xFD },   // ÷
+    { 0x00FC, 0xF5 },   // ü
+    { 0x03A3, 0xF6 },   // Σ
+    { 0x03A9, 0xF4 },   // Ω
+    { 0x03B1, 0xE0 },   // α
+    { 0x03B2, 0xE2 },   // β
+    { 0x03B5, 0xE3 },   // ε
+    { 0x03B8, 0xF2 },   // θ
+    { 0x03BC, 0xE4 },   // μ
+    { 0x03C0, 0xF7 },   // π
+    { 0x03C1, 0xE6 },   // ρ
+    { 0x03C3, 0xE5 },   // σ
+    { 0x2126, 0xF4 },   // Ω ohm sign
+    { 0x2190, 0x7F },   // ←
+    { 0x2192, 0x7E },   // →
+    { 0x221A, 0xE8 },   // √
+    { 0x221E, 0xF3 },   // ∞
+    { 0x2588, 0xFF },   // █
+    { 0x3001, 0xA4 },   // 、
+    { 0x3002, 0xA1 },   // 。
+    { 0x300C, 0xA2 },   // 「
+    { 0x300D, 0xA3 },   // 」
+    { 0x309B, 0xDE },   // ゛
+    { 0x309C, 0xDF },   // ゜
+    { 0x4E07, 0xFB },   // 万
+    { 0x5186, 0xFC },   // 円
+    { 0x5343, 0xFA },   // 千
+};
+
+constexpr RomPair a02_pairs[] = {
+    { 0x00A0, 0x20 },   // no-break space
+};
+
+// Full width katakana for the half width codes 0xA6-0xDD, in code order.
+constexpr uint16_t a00_kana[] = {
+    0x30F2,                                     // ヲ
+    0x30A1, 0x30A3, 0x30A5, 0x30A7, 0x30A9,     // ァィゥェォ
+    0x30E3, 0x30E5, 0x30E7, 0x30C3, 0x30FC,     // ャュョッー
+    0x30A2, 0x30A4, 0x30A6, 0x30A8, 0x30AA,     // アイウエオ
+    0x30AB, 0x30AD, 0x30AF, 0x30B1, 0x30B3,     // カキクケコ
+    0x30B5, 0x30B7, 0x30B9, 0x30BB, 0x30BD,     // サシスセソ
+    0x30BF, 0x30C1, 0x30C4, 0x30C6, 0x30C8,     // タチツテト
+    0x30CA, 0x30CB, 0x30CC, 0x30CD, 0x30CE,     // ナニヌネノ
+    0x30CF, 0x30D2, 0x30D5, 0x30D8, 0x30DB,     // ハヒフヘホ
+    0x30DE, 0x30DF, 0x30E0, 0x30E1, 0x30E2,     // マミムメモ
+    0x30E4, 0x30E6, 0x30E8,                     // ヤユヨ
+    0x30E9, 0x30EA, 0x30EB, 0x30EC, 0x30ED,     // ラリルレロ
+    0x30EF, 0x30F3,                             // ワン
+};
+
+constexpr uint8_t A00_DAKUTEN = 0xDE;
+constexpr uint8_t A00_HANDAKUTEN = 0xDF;
+
+// Direct lookup for U+0000-U+00FF, 0 when the ROM has no glyph.
+struct LatinPage {
+    uint8_t code[256];
+};
+
+template <size_t N>
+constexpr LatinPage makeLatinPage(LCDCharRom rom, const RomPair (&pairs)[N]) {
+    LatinPage page{};
+    // 0x01-0x07 are passed through, so custom characters can still be printed
+    for (uint16_t c = 0x01; c < 0x08; c++) page.code[c] = c;
+    for (uint16_t c = 0x20; c < 0x7F; c++) page.code[c] = c;
+    if (rom == LCD_ROM_A00) {
+        page.code['\\'] = 0;   // A00 has ¥ and → in these places
+        page.code['~'] = 0;
+    } else {
+        for (uint16_t c = 0xA1; c <= 0xFF; c++) page.code[c] = c;
+    }
+    for (size_t i = 0; i < N; i++) {
+        if (pairs[i].cp < 0x100) page.code[pairs[i].cp] = pairs[i].code;
+    }
+    return page;
+}
+
+// Direct lookup for the katakana block U+30A0-U+30FF. The low byte is the character code,
+// the high byte is a voicing mark that follows in the next cell, as the ROM only has the
+// unvoiced forms.
+struct KanaPage {
+    uint16_t code[96];
+};
+
+constexpr KanaPage makeKanaPage() {
+    KanaPage page{};
+    for (uint8_t i = 0; i < sizeof(a00_kana) / sizeof(*a00_kana); i++) {
+        uint8_t code = 0xA6 + i;
+        uint16_t cp = a00_kana[i];
+        page.code[cp - 0x30A0] = code;
+        if (code >= 0xB6 && code <= 0xC4) {
+            // カ-ト: the voiced form follows the base form
+            page.code[cp + 1 - 0x30A0] = code | (A00_DAKUTEN << 8);
+        } else if (code >= 0xCA && code <= 0xCE) {
+            // ハ-ホ: voiced and semi-voiced forms follow the base form
+            page.code[cp + 1 - 0x30A0] = code | (A00_DAKUTEN << 8);
+            page.code[cp + 2 - 0x30A0] = code | (A00_HANDAKUTEN << 8);
+        }
+    }
+    page.code[0x30F4 - 0x30A0] = 0xB3 | (A00_DAKUTEN << 8);    // ヴ
+    page.code[0x30FB - 0x30A0] = 0xA5;                          // ・
+    return page;
+}
+
+constexpr LatinPage a00_latin = makeLatinPage(LCD_ROM_A00, a00_pairs);
+constexpr LatinPage a02_latin = makeLatinPage(LCD_ROM_A02, a02_pairs);
+constexpr KanaPage a00_katakana = makeKanaPage();
+
+template <size_t N>
+uint8_t searchPairs(const RomPair (&pairs)[N], uint32_t cp) {
+    size_t lo = 0, hi = N;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (pairs[mid].cp < cp) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < N && pairs[lo].cp == cp) ? pairs[lo].code : 0;
+}
+
+} // namespace
+
+/*********** UTF-8 decoder */
+
+/**
+ * @brief Feeds one byte to the decoder.
+ *
+ * A sequence that is interrupted by a new lead byte or an ASCII byte is dropped and
+ * decoding continues with that byte.
+ *
+ * @param byte The next byte of UTF-8 input.
+ * @param codepoint Receives the decoded code point when the function returns true.
+ * @return true when a code point is complete.
+ */
+bool LCDUtf8Decoder::feed(uint8_t byte, uint32_t& codepoint) {
+    if (_need) {
+        if ((byte & 0xC0) == 0x80) {
+            _cp = (_cp << 6) | (byte & 0x3F);
+            if (--_need) return false;
+            if (_cp < _min || (_cp >= 0xD800 && _cp <= 0xDFFF) || _cp > 0x10FFFF) {
+                _cp = 0xFFFD;
+            }
+            codepoint = _cp;
+            return true;
+        }
+        _need = 0;
+    }
+
+    if (byte < 0x80) {
+        codepoint = byte;
+        return true;
+    } else if (byte >= 0xC2 && byte <= 0xDF) {
+        _cp = byte & 0x1F;
+        _need = 1;
+        _min = 0x80;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+        _cp = byte & 0x0F;
+        _need = 2;
+        _min = 0x800;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+        _cp = byte & 0x07;
+        _need = 3;
+        _min = 0x10000;
+    } else {
+        codepoint = 0xFFFD;
+        return true;
+    }
+    return false;
+}
+
+/*********** translator */
+
+/**
+ * @brief Creates a translator printing on the given display.
+ *
+ * @param lcd The display to print on.
+ * @param rom The character ROM fitted to the display controller.
+ */
+LCDText::LCDText(LCD& lcd, LCDCharRom rom) : _lcd(lcd), _rom(rom) {
+    for (uint8_t i = 0; i < 8; i++) {
+        _slot_cp[i] = 0;
+        _slot_use[i] = 0;
+    }
+}
+
+/**
+ * @brief Sets the custom glyphs used for code points that are not in the ROM.
+ *
+ * Glyphs are loaded into CGRAM the first time they are printed, into the slots from
+ * firstSlot to 7. When more glyphs are in use than there are slots, the least recently
+ * printed one is replaced, which also changes the cells on screen that show it. A print()
+ * never replaces a glyph it has printed itself, so its own text is always shown as
+ * given: glyphs beyond the free slots show as LCD_CHARSET_REPLACEMENT instead. Slots
+ * below firstSlot are left to the application.
+ *
+ * @param glyphs The glyph set. The array must stay valid, and can be placed in flash.
+ * @param count The number of glyphs in the set.
+ * @param firstSlot The first CGRAM slot (0-7) the translator may use.
+ */
+void LCDText::setGlyphs(const LCDGlyph* glyphs, uint8_t count, uint8_t firstSlot) {
+    _glyphs = glyphs;
+    _glyph_count = count;
+    _first_slot = firstSlot & 0x7;
+    for (uint8_t i = 0; i < 8; i++) {
+        _slot_cp[i] = 0;
+        _slot_use[i] = 0;
+    }
+}
+
+/**
+ * @brief Prints UTF-8 text on the display.
+ *
+ * The text is translated in chunks and each chunk is sent with a single write. Custom
+ * glyphs are loaded before the chunk that uses them. A sequence split between two calls
+ * is completed by the next call.
+ *
+ * @param utf8 The UTF-8 text to print.
+ * @return The number of character cells written.
+ */
+size_t LCDText::print(const char* utf8) {
+    uint8_t buffer[32];
+    size_t n = 0, total = 0;
+    uint32_t cp;
+
+    _print_start = _uses + 1;
+    for (const uint8_t* p = (const uint8_t*)utf8; *p; p++) {
+        if (!_decoder.feed(*p, cp)) continue;
+        if (n + 2 > sizeof(buffer)) {
+            total += _lcd.writeCells(buffer, n);
+            n = 0;
+        }
+        n += translateCodepoint(cp, &buffer[n], true);
+    }
+    total += _lcd.writeCells(buffer, n);
+    return total;
+}
+
+/**
+ * @brief Translates UTF-8 text to character codes without writing to the display.
+ *
+ * Code points that need a custom glyph are only translated when the glyph is already
+ * loaded, otherwise LCD_CHARSET_REPLACEMENT is used.
+ *
+ * @param utf8 The UTF-8 text to translate.
+ * @param out Receives the character codes.
+ * @param outlen The size of the out buffer.
+ * @return The number of character codes stored in out.
+ */
+size_t LCDText::translate(const char* utf8, uint8_t* out, size_t outlen) {
+    LCDUtf8Decoder decoder;
+    uint8_t codes[2];
+    size_t n = 0;
+    uint32_t cp;
+
+    for (const uint8_t* p = (const uint8_t*)utf8; *p; p++) {
+        if (!decoder.feed(*p, cp)) continue;
+        size_t len = translateCodepoint(cp, codes, false);
+        if (n + len > outlen) break;
+        for (size_t i = 0; i < len; i++) out[n++] = codes[i];
+    }
+    return n;
+}
+
+/**
+ * @brief Looks a code point up in the character ROM tables.
+ *
+ * @param rom The character ROM.
+ * @param codepoint The Unicode code point.
+ * @return The character code in the low byte and, for voiced katakana, the voicing mark
+ *         in the high byte. 0 when the ROM has no glyph for the code point.
+ */
+uint16_t LCDText::lookup(LCDCharRom rom, uint32_t codepoint) {
+    if (rom == LCD_ROM_A02) {
+        if (codepoint < 0x100) return a02_latin.code[codepoint];
+        return searchPairs(a02_pairs, codepoint);
+    }
+
+    if (codepoint < 0x100) return a00_latin.code[codepoint];
+    if (codepoint >= 0x30A0 && codepoint < 0x3100) {
+        return a00_katakana.code[codepoint - 0x30A0];
+    }
+    if (codepoint >= 0x3041 && codepoint <= 0x3096) {
+        // No hiragana in the ROM, show the matching katakana
+        return a00_katakana.code[codepoint + 0x60 - 0x30A0];
+    }
+    if (codepoint >= 0xFF61 && codepoint <= 0xFF9F) {
+        return codepoint - 0xFF61 + 0xA1;   // half width forms are the ROM codes
+    }
+    return searchPairs(a00_pairs, codepoint);
+}
+
+/**
+ * @brief Translates one code point to one or two character codes.
+ */
+size_t LCDText::translateCodepoint(uint32_t cp, uint8_t* out, bool upload) {
+    uint16_t code = lookup(_rom, cp);
+    if (code) {
+        out[0] = code & 0xFF;
+        if (code >> 8) {
+            out[1] = code >> 8;
+            return 2;
+        }
+        return 1;
+    }
+
+    int slot = glyphSlot(cp, upload);
+    out[0] = (slot >= 0) ? slot : LCD_CHARSET_REPLACEMENT;
+    return 1;
+}
+
+/**
+ * @brief Finds the CGRAM slot holding the glyph for a code point, loading it if allowed.
+ *
+ * A glyph is loaded into a free slot, or else into the least recently printed one, as
+ * long as the running print() has not used that slot.
+ *
+ * @return The slot, or -1 if there is no glyph for the code point or no slot for it.
+ */
+int LCDText::glyphSlot(uint32_t cp, bool upload) {
+    for (uint8_t slot = _first_slot; slot < 8; slot++) {
+        if (_slot_cp[slot] != cp) continue;
+        if (upload) _slot_use[slot] = ++_uses;
+        return slot;
+    }
+    if (!upload) return -1;
+
+    for (uint8_t i = 0; i < _glyph_count; i++) {
+        if (_glyphs[i].codepoint != cp) continue;
+
+        uint8_t slot = _first_slot;
+        for (uint8_t s = _first_slot + 1; s < 8; s++) {
+            if (_slot_use[s] < _slot_use[slot]) slot = s;
+        }
+        // cells of this print already show the slot, possibly still in the buffer
+        if (_slot_use[slot] >= _print_start) return -1;
+
+        _lcd.createChar(slot, _glyphs[i].rows);
+        _slot_cp[slot] = cp;
+        _slot_use[slot] = ++_uses;
+        return slot;
+    }
+    return -1;
+}
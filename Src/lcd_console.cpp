@@ -0,0 +1,214 @@
+/**
+ * @file lcd_console.cpp
+ * @brief Scrolling text console with control character handling.
+ */
+
+#include "lcd_console.hpp"
+#include <cstdio>
+#include <cstring>
+
+/**
+ * @brief Creates a console covering the whole display.
+ *
+ * The geometry is taken from the display. A console created before LCD::Begin(), e.g. as
+ * a global, takes it at the first print after Begin(), and ignores what is printed before.
+ * Nothing is known about the display content, so the first flush sends every cell.
+ *
+ * @param lcd The display the console prints on.
+ */
+LCDConsole::LCDConsole(LCD& lcd) : _lcd(lcd) {
+    _cols = 0;
+    _rows = 0;
+    memset(_text, ' ', sizeof(_text));
+    invalidate();
+    sized();
+}
+
+/**
+ * @brief Prints text on the console.
+ *
+ * The control characters are interpreted as:
+ * - '\\n' moves to the start of the next line, scrolling up at the bottom row.
+ * - '\\r' moves to the start of the current line.
+ * - '\\t' moves to the next tab stop, filling with spaces.
+ * - '\\b' moves one column back without erasing.
+ * - '\\f' clears the console.
+ *
+ * All other characters are printed, wrapping to the next line after the last column.
+ * The display is updated once, after the whole text has been interpreted.
+ *
+ * @param text The text to print.
+ * @return The number of characters interpreted.
+ */
+size_t LCDConsole::print(const char* text) {
+    size_t n = 0;
+    while (text[n]) {
+        interpret(text[n++]);
+    }
+    flush();
+    return n;
+}
+
+/**
+ * @brief Print formatted string to the console.
+ *
+ * @param format Format string specifying the output format.
+ * @param ... Additional arguments to be formatted and printed.
+ *
+ * @return The number of characters printed on the console.
+ */
+int LCDConsole::printFormatted(const char* format, ...) {
+    char buffer[100];
+    int n;
+
+    va_list args;
+    va_start(args, format);
+    n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (n > 0) {
+        print(buffer);
+    }
+    return n;
+}
+
+/**
+ * @brief Prints a single character on the console and updates the display.
+ *
+ * @param ch The character, interpreted as described for print().
+ */
+void LCDConsole::putch(char ch) {
+    interpret(ch);
+    flush();
+}
+
+/**
+ * @brief Clears the console and moves to the top left corner.
+ *
+ * Only cells that are not already blank are sent, so no 2 ms clear command is needed.
+ */
+void LCDConsole::clear(void) {
+    interpret('\f');
+    flush();
+}
+
+/**
+ * @brief Sends the cells that differ from what is on the display.
+ *
+ * Each run of changed cells costs one DDRAM address command plus one byte per cell.
+ */
+void LCDConsole::flush(void) {
+    if (!sized()) return;
+    for (uint8_t y = 0; y < _rows; y++) {
+        uint8_t* text = &_text[y * _cols];
+        uint8_t* shown = &_shown[y * _cols];
+        uint8_t* known = &_known[y * _cols];
+        uint8_t x = 0;
+
+        while (x < _cols) {
+            if (known[x] && shown[x] == text[x]) {
+                x++;
+                continue;
+            }
+            uint8_t start = x;
+            while (x < _cols && !(known[x] && shown[x] == text[x])) {
+                shown[x] = text[x];
+                known[x] = 1;
+                x++;
+            }
+            _lcd.setCursor(start, y);
+            _lcd.writeCells(&text[start], x - start);
+        }
+    }
+}
+
+/**
+ * @brief Forgets what is on the display.
+ *
+ * Call this after the display has been changed outside the console. The next flush
+ * sends every cell.
+ */
+void LCDConsole::invalidate(void) {
+    memset(_known, 0, sizeof(_known));
+}
+
+/**
+ * @brief Takes the geometry from the display once it has one.
+ * @return false while the display has not been initialized with Begin().
+ */
+bool LCDConsole::sized(void) {
+    if (_cols) return true;
+    _cols = _lcd.getCols();
+    _rows = _lcd.getRows();
+    if (!_cols || !_rows) {
+        _cols = 0;
+        return false;
+    }
+    if (_cols * _rows > LCD_CONSOLE_MAX_CELLS) {
+        _rows = LCD_CONSOLE_MAX_CELLS / _cols;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies one character to the console text, without touching the display.
+ */
+void LCDConsole::interpret(char ch) {
+    if (!sized()) return;
+    switch (ch) {
+    case '\n':
+        newline();
+        break;
+
+    case '\r':
+        _col = 0;
+        break;
+
+    case '\t': {
+        uint8_t stop = (_col / LCD_CONSOLE_TABSIZE + 1) * LCD_CONSOLE_TABSIZE;
+        if (stop > _cols) stop = _cols;
+        while (_col < stop) {
+            _text[_row * _cols + _col++] = ' ';
+        }
+        break;
+    }
+
+    case '\b':
+        if (_col >= _cols) _col = _cols - 1;
+        else if (_col > 0) _col--;
+        break;
+
+    case '\f':
+        memset(_text, ' ', sizeof(_text));
+        _col = 0;
+        _row = 0;
+        break;
+
+    default:
+        // Wrapping is deferred to the next character, so the last column can be used
+        // without scrolling the screen
+        if (_col >= _cols) newline();
+        _text[_row * _cols + _col++] = (uint8_t)ch;
+        break;
+    }
+}
+
+/**
+ * @brief Moves to the start of the next line, scrolling at the bottom row.
+ */
+void LCDConsole::newline(void) {
+    _col = 0;
+    if (_row + 1 < _rows) {
+        _row++;
+    } else {
+        scrollUp();
+    }
+}
+
+/**
+ * @brief Moves the console text up one line and blanks the bottom row.
+ */
+void LCDConsole::scrollUp(void) {
+    memmove(_text, &_text[_cols], (_rows - 1) * _cols);
+    memset(&_text[(_rows - 1) * _cols], ' ', _cols);
+}
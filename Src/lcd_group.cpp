@@ -0,0 +1,217 @@
+/**
+ * @file lcd_group.cpp
+ * @brief Bit-parallel updates of several displays whose data pins share one GPIO port.
+ */
+
+#include "lcd_group.hpp"
+
+/**
+ * @brief Adds a display to the group.
+ *
+ * @param lcd The display, initialized with Begin() and given a timing profile with
+ *        calibrate() or setTiming().
+ * @return false if the group is full, the display has no timing profile or two
+ *         controllers, or it does not match the displays already in the group: other data
+ *         port, data pins or enable line in use, or other geometry.
+ */
+bool LCDGroup::add(LCD& lcd) {
+    if (_count >= LCD_GROUP_MAX || !lcd._timing.valid || lcd._controllers != 1) return false;
+
+    uint16_t pins = lcd._data_pins[0] | lcd._data_pins[1] | lcd._data_pins[2] | lcd._data_pins[3];
+    if (_count) {
+        const LCD& first = *_members[0];
+        if (lcd.vPortData != first.vPortData || (pins & _data_mask) ||
+            lcd._numcols != first._numcols || lcd._numlines != first._numlines) {
+            return false;
+        }
+        // a shared enable line would latch the nibbles of another display as well
+        for (uint8_t m = 0; m < _count; m++) {
+            if (_members[m]->vPortCtrlEN == lcd.vPortCtrlEN && _members[m]->vCtrlEN == lcd.vCtrlEN) {
+                return false;
+            }
+        }
+    }
+    _data_mask |= pins;
+    _members[_count++] = &lcd;
+    return true;
+}
+
+/**
+ * @brief Sets the cursor position of every display, like LCD::setCursor().
+ *
+ * @param x The column.
+ * @param y The row.
+ */
+void LCDGroup::setCursor(uint8_t x, uint8_t y) {
+    uint8_t values[LCD_GROUP_MAX];
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        uint8_t row = (y < lcd._numlines) ? y : lcd._numlines - 1;
+        values[m] = LCD_SETDDRAMADDR | (x + lcd._row_offsets[row] + lcd.drawOffset());
+        lcd._col = x;
+        lcd._row = row;
+    }
+    transfer(values, GPIO_PIN_RESET);
+}
+
+/**
+ * @brief Writes raw character codes to every display at its cursor position.
+ *
+ * @param cells One array of character codes per display, in the order they were added.
+ *        Give the same array to all displays to mirror them.
+ * @param len The number of character codes written to each display.
+ * @return The number of characters written to each display.
+ */
+size_t LCDGroup::writeCells(const uint8_t* const cells[], size_t len) {
+    uint8_t values[LCD_GROUP_MAX];
+    for (size_t i = 0; i < len; i++) {
+        for (uint8_t m = 0; m < _count; m++) values[m] = cells[m][i];
+        transfer(values, GPIO_PIN_SET);
+    }
+    for (uint8_t m = 0; m < _count; m++) _members[m]->advanceCursor(len);
+    return len;
+}
+
+/**
+ * @brief Writes a whole screen to every display, one address command per row.
+ *
+ * @param frames One array of getCols() * getRows() character codes per display, row by row.
+ * @return The number of characters written to each display.
+ */
+size_t LCDGroup::writeFrame(const uint8_t* const frames[]) {
+    if (!_count) return 0;
+
+    uint8_t cols = _members[0]->_numcols;
+    const uint8_t* rows[LCD_GROUP_MAX];
+    size_t n = 0;
+    for (uint8_t y = 0; y < _members[0]->_numlines; y++) {
+        for (uint8_t m = 0; m < _count; m++) rows[m] = frames[m] + y * cols;
+        setCursor(0, y);
+        n += writeCells(rows, cols);
+    }
+    return n;
+}
+
+/**
+ * @brief Clears every display, like LCD::clear().
+ */
+void LCDGroup::clear(void) {
+    uint8_t values[LCD_GROUP_MAX];
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        values[m] = LCD_CLEARDISPLAY;
+        lcd._front_page = 0;
+        lcd._col = 0;
+        lcd._row = 0;
+    }
+    transfer(values, GPIO_PIN_RESET);
+}
+
+/**
+ * @brief Sends one byte to each display at the same time.
+ *
+ * Waits until every display has executed its previous byte, then drives the pins of all
+ * displays together. Each display is then accounted for as if it had sent the byte itself.
+ *
+ * @param values The byte of each display.
+ * @param mode The mode indicating whether they are commands or data (GPIO_PinState).
+ */
+void LCDGroup::transfer(const uint8_t values[], GPIO_PinState mode) {
+    for (uint8_t m = 0; m < _count; m++) _members[m]->waitReady(1);
+
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        stage(lcd, lcd.vPortCtrlRS, lcd.vCtrlRS, LCD_TRACE_RS, mode);
+        if (lcd.vCtrlRW != 255) stage(lcd, lcd.vPortCtrlRW, lcd.vCtrlRW, LCD_TRACE_RW, GPIO_PIN_RESET);
+    }
+    stageNibble(values, 4);
+    flush();
+    pulseEnable();
+    stageNibble(values, 0);
+    flush();
+    pulseEnable();
+
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        lcd.account(1, values[m], mode);
+#if LCD_STATS
+        if (mode == GPIO_PIN_SET)
+            lcd._stats.data_bytes++;
+        else
+            lcd._stats.commands++;
+        lcd._stats.en_pulses += 2;
+#endif
+    }
+}
+
+/**
+ * @brief Adds a pin change to the port stores of the next flush().
+ *
+ * @param lcd The display the pin belongs to, whose trace records the change.
+ * @param port The GPIO port of the pin.
+ * @param pin The GPIO pin.
+ * @param signal The signal number used in the trace.
+ * @param state The new pin state.
+ */
+void LCDGroup::stage(LCD& lcd, GPIO_TypeDef* port, uint16_t pin, uint8_t signal, GPIO_PinState state) {
+#if LCD_TRACE
+    if (lcd._trace) lcd._trace->record(signal, state);
+#else
+    (void)lcd;
+    (void)signal;
+#endif
+    uint32_t bits = (state == GPIO_PIN_SET) ? pin : (uint32_t)pin << 16;
+    for (uint8_t i = 0; i < _write_count; i++) {
+        if (_writes[i].port == port) {
+            _writes[i].bsrr |= bits;
+            return;
+        }
+    }
+    _writes[_write_count].port = port;
+    _writes[_write_count].bsrr = bits;
+    _write_count++;
+}
+
+/**
+ * @brief Stages one nibble of each display on its data pins.
+ *
+ * @param values The byte of each display.
+ * @param shift 4 for the high nibbles, 0 for the low nibbles.
+ */
+void LCDGroup::stageNibble(const uint8_t values[], uint8_t shift) {
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        for (uint8_t i = 0; i < 4; i++) {
+            GPIO_PinState state = ((values[m] >> (shift + i)) & 0x01) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+            stage(lcd, lcd.vPortData, lcd._data_pins[i], LCD_TRACE_D0 + 4 + i, state);
+        }
+    }
+}
+
+/**
+ * @brief Applies the staged pin changes, with one BSRR store per port.
+ */
+void LCDGroup::flush(void) {
+    for (uint8_t i = 0; i < _write_count; i++) {
+        _writes[i].port->BSRR = _writes[i].bsrr;
+    }
+    _write_count = 0;
+}
+
+/**
+ * @brief Generates one pulse on the enable pins of all displays.
+ */
+void LCDGroup::pulseEnable(void) {
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        stage(lcd, lcd.vPortCtrlEN, lcd.vCtrlEN, LCD_TRACE_EN, GPIO_PIN_SET);
+    }
+    flush();
+    _members[0]->delayUs(1);    // enable pulse must be >450ns
+    for (uint8_t m = 0; m < _count; m++) {
+        LCD& lcd = *_members[m];
+        stage(lcd, lcd.vPortCtrlEN, lcd.vCtrlEN, LCD_TRACE_EN, GPIO_PIN_RESET);
+    }
+    flush();
+    _members[0]->delayUs(1);    // enable cycle must be >1000ns
+}
@@ -0,0 +1,143 @@
+/**
+ * @file lcd_isr.cpp
+ * @brief Messages posted from interrupt handlers in bounded time, shown later.
+ */
+
+#include "lcd_isr.hpp"
+
+// Attempts of drain() to read a slot that keeps being rewritten, before leaving it for the next drain.
+#define LCD_ISR_READ_ATTEMPTS 3
+
+/**
+ * @brief Creates the slots for the given display, none reserved.
+ *
+ * @param lcd The display owned by the context that calls drain().
+ */
+LCDIsrPrint::LCDIsrPrint(LCD& lcd) : _lcd(lcd) {
+    for (uint8_t i = 0; i < LCD_ISR_SLOTS; i++) {
+        _slots[i].sequence.store(0, std::memory_order_relaxed);
+        _slots[i].shown = 0;
+        _slots[i].width = 0;
+    }
+}
+
+/**
+ * @brief Reserves the place on the screen where a slot is shown.
+ *
+ * Call before enabling the interrupts that post to the slot.
+ *
+ * @param slot The slot.
+ * @param x The column of the first character.
+ * @param y The row.
+ * @param width The characters shown, up to LCD_ISR_TEXT_MAX.
+ * @return false if there is no such slot.
+ */
+bool LCDIsrPrint::reserve(uint8_t slot, uint8_t x, uint8_t y, uint8_t width) {
+    if (slot >= LCD_ISR_SLOTS) return false;
+    Slot& s = _slots[slot];
+    s.x = x;
+    s.y = y;
+    s.width = (width > LCD_ISR_TEXT_MAX) ? LCD_ISR_TEXT_MAX : width;
+    return true;
+}
+
+/**
+ * @brief Posts a message. Safe in an interrupt handler, constant time.
+ *
+ * @param slot The slot, written only by this interrupt.
+ * @param text The message. Characters after LCD_ISR_TEXT_MAX are not copied.
+ * @return false if there is no such slot.
+ */
+bool LCDIsrPrint::post(uint8_t slot, const char* text) {
+    if (slot >= LCD_ISR_SLOTS) return false;
+    Slot& s = _slots[slot];
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+
+    s.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_release);
+    for (uint8_t i = 0; i < LCD_ISR_TEXT_MAX; i++) {
+        char c = *text;
+        if (c) text++;
+        s.text[i] = c ? c : ' ';
+    }
+    s.sequence.store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Posts a message ending in a value as 8 hex digits, e.g. a fault code. Safe in
+ *        an interrupt handler, constant time.
+ *
+ * @param slot The slot, written only by this interrupt.
+ * @param text The text before the value, up to LCD_ISR_TEXT_MAX - 8 characters.
+ * @param value The value.
+ * @return false if there is no such slot.
+ */
+bool LCDIsrPrint::postHex(uint8_t slot, const char* text, uint32_t value) {
+    static_assert(LCD_ISR_TEXT_MAX >= 8, "a message holds at least the 8 hex digits");
+    static const char digits[] = "0123456789ABCDEF";
+    if (slot >= LCD_ISR_SLOTS) return false;
+    Slot& s = _slots[slot];
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+
+    s.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_release);
+    for (uint8_t i = 0; i < LCD_ISR_TEXT_MAX - 8; i++) {
+        char c = *text;
+        if (c) text++;
+        s.text[i] = c ? c : ' ';
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        s.text[LCD_ISR_TEXT_MAX - 1 - i] = digits[value & 0xF];
+        value >>= 4;
+    }
+    s.sequence.store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Shows the messages posted since the last call at their reserved places.
+ *
+ * Call it regularly from the context that owns the display. The DDRAM address is kept,
+ * and the messages are written left to right without display shift whatever the entry
+ * mode. A slot being rewritten while it is read is left for the next call.
+ *
+ * @return The number of messages shown.
+ */
+size_t LCDIsrPrint::drain(void) {
+    size_t shown = 0;
+    uint8_t col = _lcd._col, row = _lcd._row;
+    uint8_t ctrl = _lcd._cur, ac = _lcd._ac[ctrl];
+
+    for (uint8_t i = 0; i < LCD_ISR_SLOTS; i++) {
+        Slot& s = _slots[i];
+        if (!s.width) continue;
+
+        char text[LCD_ISR_TEXT_MAX];
+        uint32_t seq = 0;
+        bool read = false;
+        for (uint8_t attempt = 0; attempt < LCD_ISR_READ_ATTEMPTS && !read; attempt++) {
+            seq = s.sequence.load(std::memory_order_acquire);
+            if (seq == s.shown || (seq & 1)) break;
+            for (uint8_t c = 0; c < s.width; c++) text[c] = s.text[c];
+            std::atomic_signal_fence(std::memory_order_acquire);
+            read = (s.sequence.load(std::memory_order_relaxed) == seq);
+        }
+        if (!read) continue;
+
+        if (_lcd._entry != LCD_ENTRYLEFT) _lcd.command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+        _lcd.setCursor(s.x, s.y);
+        _lcd.writeCells(reinterpret_cast<const uint8_t*>(text), s.width);
+        s.shown = seq;
+        shown++;
+    }
+    if (shown) {
+        if (_lcd._entry != (_lcd._displaymode & (LCD_ENTRYLEFT | LCD_ENTRYSHIFTINCREMENT))) {
+            _lcd.command(LCD_ENTRYMODESET | _lcd._displaymode);
+        }
+        _lcd._col = col;
+        _lcd._row = row;
+        _lcd.restoreCursor(ctrl, ac);
+    }
+    return shown;
+}
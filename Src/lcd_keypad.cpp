@@ -0,0 +1,145 @@
+/**
+ * @file lcd_keypad.cpp
+ * @brief Key scanning on the LCD data lines, between display transfers.
+ */
+
+#include "lcd_keypad.hpp"
+
+/**
+ * @brief Creates a keypad on the data lines of the given display.
+ *
+ * @param lcd The display sharing its data lines with the keys.
+ */
+LCDKeypad::LCDKeypad(LCD& lcd) : _lcd(lcd) {
+}
+
+/**
+ * @brief Adds a row line. Keys of row r are reported as bits 4 * r to 4 * r + 3.
+ *
+ * @param port The GPIO port of the row line.
+ * @param pin The GPIO pin of the row line.
+ * @return false if LCD_KEYPAD_MAX_ROWS rows are already in use.
+ */
+bool LCDKeypad::addRow(GPIO_TypeDef* port, uint16_t pin) {
+    if (_rows >= LCD_KEYPAD_MAX_ROWS) return false;
+    _row_ports[_rows] = port;
+    _row_pins[_rows] = pin;
+    _rows++;
+    return true;
+}
+
+/**
+ * @brief Configures the row lines and starts scanning in the controller waits.
+ *
+ * Call after LCD::Begin() and addRow(). The display's busy hook is taken over.
+ */
+void LCDKeypad::begin(void) {
+    GPIO_InitTypeDef gpio_init = {};
+    gpio_init.Mode = GPIO_MODE_OUTPUT_OD;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    for (uint8_t r = 0; r < _rows; r++) {
+        _lcd.enableClock2(_row_ports[r]);
+        HAL_GPIO_WritePin(_row_ports[r], _row_pins[r], GPIO_PIN_SET);  // released
+        gpio_init.Pin = _row_pins[r];
+        HAL_GPIO_Init(_row_ports[r], &gpio_init);
+    }
+    _lcd.setBusyHook(busyGap, this);
+}
+
+/**
+ * @brief Stops scanning in the controller waits. poll() still scans.
+ */
+void LCDKeypad::end(void) {
+    _lcd.setBusyHook(nullptr, nullptr);
+}
+
+/**
+ * @brief Scans the keys if LCD_KEYPAD_PERIOD_MS has passed since the last scan.
+ *
+ * Call it regularly, at least while the display is idle, from the context that uses
+ * the display.
+ *
+ * @return true if a scan was done.
+ */
+bool LCDKeypad::poll(void) {
+    if (!due()) return false;
+    scan();
+    return true;
+}
+
+/**
+ * @brief Returns the keys pressed since the last call, one bit each.
+ */
+uint16_t LCDKeypad::takePressed(void) {
+    uint16_t pressed = _pressed;
+    _pressed = 0;
+    return pressed;
+}
+
+/**
+ * @brief Tells whether the next scan is due.
+ */
+bool LCDKeypad::due(void) const {
+    return !_scanned || HAL_GetTick() - _last_scan >= LCD_KEYPAD_PERIOD_MS;
+}
+
+/**
+ * @brief Reads all keys and updates the debounced state.
+ *
+ * The data pins are inputs with pull-ups only during the scan, and outputs again
+ * afterwards, while EN stays low all the time.
+ */
+void LCDKeypad::scan(void) {
+    uint16_t raw = 0;
+
+    _lcd.setDataInput(true, GPIO_PULLUP);
+    if (!_rows) {
+        _lcd.delayUs(LCD_KEYPAD_SETTLE_US);
+        raw = readLines();
+    }
+    for (uint8_t r = 0; r < _rows; r++) {
+        HAL_GPIO_WritePin(_row_ports[r], _row_pins[r], GPIO_PIN_RESET);
+        _lcd.delayUs(LCD_KEYPAD_SETTLE_US);
+        raw |= (uint16_t)readLines() << (4 * r);
+        HAL_GPIO_WritePin(_row_ports[r], _row_pins[r], GPIO_PIN_SET);
+    }
+    _lcd.setDataInput(false);
+
+    _last_scan = HAL_GetTick();
+    _scanned = true;
+    _scans++;
+
+    if (raw == _raw) {
+        if (_stable < LCD_KEYPAD_DEBOUNCE) _stable++;
+    } else {
+        _raw = raw;
+        _stable = 1;
+    }
+    if (_stable >= LCD_KEYPAD_DEBOUNCE && _keys != _raw) {
+        _pressed |= _raw & ~_keys;
+        _keys = _raw;
+    }
+}
+
+/**
+ * @brief Reads the data lines, a low line is a pressed key.
+ * @return One bit per data line, D4 in bit 0.
+ */
+uint8_t LCDKeypad::readLines(void) {
+    uint8_t lines = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (HAL_GPIO_ReadPin(_lcd.vPortData, _lcd._data_pins[i]) == GPIO_PIN_RESET) lines |= 1 << i;
+    }
+    return lines;
+}
+
+/**
+ * @brief Busy hook of the display, scans when the wait is long enough and a scan is due.
+ */
+void LCDKeypad::busyGap(uint32_t us, void* context) {
+    LCDKeypad* keypad = static_cast<LCDKeypad*>(context);
+    if (us < LCD_KEYPAD_GAP_US || !keypad->due()) return;
+    keypad->scan();
+    keypad->_gap_scans++;
+}
@@ -0,0 +1,266 @@
+/**
+ * @file lcd_layout.cpp
+ * @brief Fixed region layout with incremental redraw.
+ */
+
+#include "lcd_layout.hpp"
+#include <cstring>
+
+/**
+ * @brief Creates an empty layout for the given display.
+ *
+ * The geometry is taken from the display, so the layout must be created after LCD::Begin().
+ * Nothing is known about the display content, so the first update of every region sends
+ * all of its cells.
+ *
+ * @param lcd The display the layout draws on.
+ */
+LCDLayout::LCDLayout(LCD& lcd) : _lcd(lcd) {
+    _cols = lcd.getCols();
+    _rows = lcd.getRows();
+    invalidate();
+}
+
+/**
+ * @brief Adds a left aligned text region.
+ *
+ * @param x Column of the first cell.
+ * @param y Row of the region.
+ * @param width Number of cells. Longer text is clipped, shorter text is padded with spaces.
+ * @param text Initial text. The pointer is kept, so the text must stay valid.
+ * @return The region id, or -1 if the region does not fit on the display or in the layout.
+ */
+int LCDLayout::addLabel(uint8_t x, uint8_t y, uint8_t width, const char* text) {
+    int id = addRegion(REGION_LABEL, x, y, width);
+    if (id >= 0) _regions[id].text = text;
+    return id;
+}
+
+/**
+ * @brief Adds a right aligned numeric field.
+ *
+ * The value is a fixed point number: with 2 decimals the value 1234 is shown as 12.34.
+ * A value that does not fit in the field is shown as a row of '*'.
+ *
+ * @param x Column of the first cell.
+ * @param y Row of the region.
+ * @param width Number of cells.
+ * @param decimals Number of digits after the decimal point.
+ * @return The region id, or -1 if the region does not fit on the display or in the layout.
+ */
+int LCDLayout::addNumber(uint8_t x, uint8_t y, uint8_t width, uint8_t decimals) {
+    int id = addRegion(REGION_NUMBER, x, y, width);
+    if (id >= 0) _regions[id].decimals = decimals;
+    return id;
+}
+
+/**
+ * @brief Adds a horizontal bar graph.
+ *
+ * @param x Column of the first cell.
+ * @param y Row of the region.
+ * @param width Number of cells.
+ * @param max The value that fills the whole bar.
+ * @param fill Character code for a filled cell. 0xFF is a full block in the standard ROM.
+ * @return The region id, or -1 if the region does not fit on the display or in the layout.
+ */
+int LCDLayout::addBar(uint8_t x, uint8_t y, uint8_t width, uint16_t max, uint8_t fill) {
+    int id = addRegion(REGION_BAR, x, y, width);
+    if (id >= 0) {
+        _regions[id].max = max ? max : 1;
+        _regions[id].fill = fill;
+    }
+    return id;
+}
+
+/**
+ * @brief Adds a single cell icon.
+ *
+ * @param x Column of the icon.
+ * @param y Row of the icon.
+ * @param glyph Character code, 0-7 for the custom characters in CGRAM.
+ * @return The region id, or -1 if the region does not fit on the display or in the layout.
+ */
+int LCDLayout::addIcon(uint8_t x, uint8_t y, uint8_t glyph) {
+    int id = addRegion(REGION_ICON, x, y, 1);
+    if (id >= 0) _regions[id].value = glyph;
+    return id;
+}
+
+/**
+ * @brief Sets the text of a label region and updates the display.
+ *
+ * @param id The region id returned by addLabel().
+ * @param text The new text. The pointer is kept, so the text must stay valid.
+ */
+void LCDLayout::setText(int id, const char* text) {
+    if (id < 0 || id >= _count || _regions[id].type != REGION_LABEL) return;
+    _regions[id].text = text;
+    update(id);
+}
+
+/**
+ * @brief Sets the value of a numeric field and updates the display.
+ *
+ * @param id The region id returned by addNumber().
+ * @param value The new fixed point value.
+ */
+void LCDLayout::setNumber(int id, int32_t value) {
+    if (id < 0 || id >= _count || _regions[id].type != REGION_NUMBER) return;
+    _regions[id].value = value;
+    update(id);
+}
+
+/**
+ * @brief Sets the value of a bar graph and updates the display.
+ *
+ * @param id The region id returned by addBar().
+ * @param value The new value, clamped to the maximum of the bar.
+ */
+void LCDLayout::setBar(int id, uint16_t value) {
+    if (id < 0 || id >= _count || _regions[id].type != REGION_BAR) return;
+    _regions[id].value = value;
+    update(id);
+}
+
+/**
+ * @brief Sets the glyph of an icon and updates the display.
+ *
+ * @param id The region id returned by addIcon().
+ * @param glyph The new character code.
+ */
+void LCDLayout::setIcon(int id, uint8_t glyph) {
+    if (id < 0 || id >= _count || _regions[id].type != REGION_ICON) return;
+    _regions[id].value = glyph;
+    update(id);
+}
+
+/**
+ * @brief Forgets what is on the display.
+ *
+ * Call this after the display has been changed outside the layout, for example by
+ * LCD::clear(). The next update of each region sends all of its cells.
+ */
+void LCDLayout::invalidate(void) {
+    memset(_known, 0, sizeof(_known));
+}
+
+/**
+ * @brief Draws all regions, sending only cells that differ from the display.
+ */
+void LCDLayout::redraw(void) {
+    for (int id = 0; id < _count; id++) {
+        update(id);
+    }
+}
+
+/**
+ * @brief Adds a region after checking it against the display geometry.
+ */
+int LCDLayout::addRegion(RegionType type, uint8_t x, uint8_t y, uint8_t width) {
+    if (_count >= LCD_LAYOUT_MAX_REGIONS) return -1;
+    if (width == 0 || width > LCD_LAYOUT_MAX_WIDTH) return -1;
+    if (y >= _rows || x + width > _cols) return -1;
+    if ((y + 1) * _cols > LCD_LAYOUT_MAX_CELLS) return -1;
+
+    Region& r = _regions[_count];
+    r.type = type;
+    r.x = x;
+    r.y = y;
+    r.width = width;
+    r.decimals = 0;
+    r.fill = 0xFF;
+    r.max = 1;
+    r.value = 0;
+    r.text = "";
+    return _count++;
+}
+
+/**
+ * @brief Renders a region into its cells.
+ */
+void LCDLayout::render(const Region& r, uint8_t* cells) {
+    memset(cells, ' ', r.width);
+
+    switch (r.type) {
+    case REGION_LABEL:
+        for (uint8_t i = 0; i < r.width && r.text && r.text[i]; i++) {
+            cells[i] = r.text[i];
+        }
+        break;
+
+    case REGION_NUMBER: {
+        // Format right to left, so no intermediate buffer is needed
+        uint32_t v = (r.value < 0) ? -(uint32_t)r.value : r.value;
+        int pos = r.width - 1;
+        uint8_t digits = 0;
+        bool point = false;
+        bool fits = false;
+        while (pos >= 0) {
+            if (r.decimals && digits == r.decimals && !point) {
+                cells[pos--] = '.';
+                point = true;
+                continue;
+            }
+            cells[pos--] = '0' + (v % 10);
+            v /= 10;
+            digits++;
+            if (!v && digits > r.decimals) {
+                fits = true;
+                break;
+            }
+        }
+        if (fits && r.value < 0) {
+            if (pos >= 0) cells[pos] = '-';
+            else fits = false;
+        }
+        if (!fits) {
+            memset(cells, '*', r.width);
+        }
+        break;
+    }
+
+    case REGION_BAR: {
+        uint32_t v = (r.value > r.max) ? r.max : r.value;
+        uint8_t filled = (v * r.width) / r.max;
+        memset(cells, r.fill, filled);
+        break;
+    }
+
+    case REGION_ICON:
+        cells[0] = (uint8_t)r.value;
+        break;
+    }
+}
+
+/**
+ * @brief Sends the cells of a region that differ from the display.
+ *
+ * Runs of changed cells are written with one cursor address command each. The cursor
+ * position is not trusted between updates, since other code may have moved it.
+ */
+void LCDLayout::update(int id) {
+    const Region& r = _regions[id];
+    uint8_t cells[LCD_LAYOUT_MAX_WIDTH];
+    uint8_t* shown = &_shown[r.y * _cols + r.x];
+    uint8_t* known = &_known[r.y * _cols + r.x];
+
+    render(r, cells);
+
+    uint8_t i = 0;
+    while (i < r.width) {
+        if (known[i] && shown[i] == cells[i]) {
+            i++;
+            continue;
+        }
+        uint8_t start = i;
+        while (i < r.width && !(known[i] && shown[i] == cells[i])) {
+            shown[i] = cells[i];
+            known[i] = 1;
+            i++;
+        }
+        _lcd.setCursor(r.x + start, r.y);
+        _lcd.writeCells(&cells[start], i - start);
+        _bytes += 1 + (i - start);
+    }
+}
@@ -0,0 +1,163 @@
+/**
+ * @file lcd_mirror.cpp
+ * @brief Mirrors the display content to a remote viewer as a compact delta stream.
+ */
+
+#include "lcd_mirror.hpp"
+#include <string.h>
+
+/**
+ * @brief Creates a mirror of the given display.
+ *
+ * @param lcd The display, initialized with Begin().
+ * @param write The transport, e.g. a function queueing the bytes for a UART.
+ * @param context Passed to write.
+ */
+LCDMirror::LCDMirror(LCD& lcd, LCDMirrorWrite write, void* context)
+    : _lcd(lcd), _write(write), _context(context) {
+}
+
+/**
+ * @brief Sends what changed on the display since the last flush.
+ *
+ * Reads only the RAM copy of the controller state. If the transport has no room for a
+ * packet, the flush stops there and the rest is sent by a later flush.
+ *
+ * @return The number of bytes sent.
+ */
+size_t LCDMirror::flush(void) {
+    size_t sent = 0;
+    uint8_t cols = _lcd._numcols;
+    uint8_t rows = _lcd._numlines;
+
+    if (!_valid || cols != _cols || rows != _rows) {
+        if (cols * rows > LCD_MIRROR_MAX_CELLS) return 0;
+        uint8_t geometry[2] = { cols, rows };
+        if (!send('G', geometry, 2, nullptr, 0)) return 0;
+        sent += 3 + 2 + 1;
+        _cols = cols;
+        _rows = rows;
+        memset(_cells, ' ', sizeof(_cells));    // the viewer starts with a blank screen
+        _cg_defined = 0;
+        memset(_mode, 0xFF, sizeof(_mode));
+        _valid = true;
+    }
+
+    uint8_t mode[4] = { _lcd._displaycontrol, _lcd._displaymode, _lcd._col, _lcd._row };
+    bool complete = flushCgram(sent) && flushCells(sent);
+    if (complete && memcmp(mode, _mode, sizeof(mode))) {
+        complete = send('M', mode, sizeof(mode), nullptr, 0);
+        if (complete) {
+            memcpy(_mode, mode, sizeof(mode));
+            sent += 3 + sizeof(mode) + 1;
+        }
+    }
+    if (!complete) {
+        if (sent) _end_pending = true;     // the viewer gets what was sent with the next 'E'
+        _bytes += sent;
+        return sent;
+    }
+
+    if (sent || _end_pending) {
+        _end_pending = !send('E', &_seq, 1, nullptr, 0);
+        if (!_end_pending) {
+            _seq++;
+            sent += 3 + 1 + 1;
+        }
+    }
+    _bytes += sent;
+    return sent;
+}
+
+/**
+ * @brief Returns the code of the character shown at a position, after the display shift.
+ */
+uint8_t LCDMirror::visible(uint8_t x, uint8_t y) const {
+    uint8_t linelength = (_lcd._displayfunction & LCD_2LINE) ? 40 : 80;
+    uint8_t ctrl = (_lcd._controllers > 1 && y >= _lcd._numlines / 2) ? 1 : 0;
+    uint8_t line = _lcd._row_offsets[y] & 0x40;
+    uint8_t column = ((_lcd._row_offsets[y] & 0x3F) + x + _lcd._shift) % linelength;
+    return _lcd._ddram[ctrl][_lcd.ddramIndex(line + column)];
+}
+
+/**
+ * @brief Builds a packet and gives it to the transport.
+ *
+ * The payload is head followed by data.
+ *
+ * @return false if the transport did not take it.
+ */
+bool LCDMirror::send(uint8_t type, const uint8_t* head, uint8_t head_len, const uint8_t* data, uint8_t len) {
+    uint8_t n = head_len + len;
+    _packet[0] = LCD_MIRROR_SYNC;
+    _packet[1] = type;
+    _packet[2] = n;
+    memcpy(&_packet[3], head, head_len);
+    if (len) memcpy(&_packet[3 + head_len], data, len);
+
+    uint8_t sum = 0;
+    for (uint8_t i = 1; i < 3 + n; i++) sum += _packet[i];
+    _packet[3 + n] = sum;
+    return _write(_packet, 3 + n + 1, _context);
+}
+
+/**
+ * @brief Sends the CGRAM bytes of defined locations that changed, one packet per run.
+ * @return false if the transport did not take a packet.
+ */
+bool LCDMirror::flushCgram(size_t& sent) {
+    uint8_t defined = _lcd._cg_defined;
+    uint8_t address = 0;
+    while (address < 64) {
+        bool changed = (defined & (1 << (address >> 3))) &&
+                       (!(_cg_defined & (1 << (address >> 3))) || _cgram[address] != _lcd._cgram[address]);
+        if (!changed) {
+            address++;
+            continue;
+        }
+        uint8_t start = address;
+        while (address < 64 && (defined & (1 << (address >> 3))) &&
+               (!(_cg_defined & (1 << (address >> 3))) || _cgram[address] != _lcd._cgram[address])) {
+            address++;
+        }
+        if (!send('R', &start, 1, &_lcd._cgram[start], address - start)) return false;
+        memcpy(&_cgram[start], &_lcd._cgram[start], address - start);
+        sent += 3 + 1 + (address - start) + 1;
+    }
+    _cg_defined |= defined;     // all rows of newly defined locations have been sent
+    return true;
+}
+
+/**
+ * @brief Sends the cells that changed, one packet per run.
+ *
+ * Runs separated by up to LCD_MIRROR_GAP unchanged cells are sent as one.
+ *
+ * @return false if the transport did not take a packet.
+ */
+bool LCDMirror::flushCells(size_t& sent) {
+    uint8_t run[40];
+    for (uint8_t y = 0; y < _rows; y++) {
+        uint8_t* shown = &_cells[y * _cols];
+        uint8_t x = 0;
+        while (x < _cols) {
+            if (visible(x, y) == shown[x]) {
+                x++;
+                continue;
+            }
+            uint8_t start = x;
+            uint8_t end = x;        // one past the last changed cell
+            while (x < _cols && x - end <= LCD_MIRROR_GAP) {
+                run[x - start] = visible(x, y);
+                if (run[x - start] != shown[x]) end = x + 1;
+                x++;
+            }
+            uint8_t head[2] = { y, start };
+            if (!send('C', head, 2, run, end - start)) return false;
+            memcpy(&shown[start], run, end - start);
+            sent += 3 + 2 + (end - start) + 1;
+            x = end;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file lcd_queue.cpp
+ * @brief Lock-free multi-producer, single-consumer operation queue for one LCD.
+ */
+
+#include "lcd_queue.hpp"
+#include <cstring>
+
+/**
+ * @brief Creates an empty queue for the given display.
+ *
+ * @param lcd The display owned by the task that calls process().
+ */
+LCDQueue::LCDQueue(LCD& lcd) : _lcd(lcd), _enqueue_pos(0), _dropped(0) {
+    for (uint32_t i = 0; i < LCD_QUEUE_SIZE; i++) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Submits an operation.
+ *
+ * Never blocks. When the queue is full the operation is dropped and counted.
+ *
+ * @param op The operation, copied into the queue.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::submit(const LCDOperation& op) {
+    uint32_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for (;;) {
+        slot = &_slots[pos & (LCD_QUEUE_SIZE - 1)];
+        uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            // Slot is free for this position, try to claim it
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->op = op;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (_notify) _notify(_notify_context);
+    return true;
+}
+
+/**
+ * @brief Submits text to be printed at the given position.
+ *
+ * @param x The column of the first character.
+ * @param y The row.
+ * @param text The text, truncated to LCD_QUEUE_TEXT_MAX characters.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::printAt(uint8_t x, uint8_t y, const char* text) {
+    return submitText(LCDOperation::PRINT_AT, x, y, text);
+}
+
+/**
+ * @brief Submits text to be printed at the cursor position left by the previous operation.
+ *
+ * @param text The text, truncated to LCD_QUEUE_TEXT_MAX characters.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::print(const char* text) {
+    return submitText(LCDOperation::PRINT, 0, 0, text);
+}
+
+/**
+ * @brief Submits a clear of the display.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::clear(void) {
+    LCDOperation op;
+    op.type = LCDOperation::CLEAR;
+    return submit(op);
+}
+
+/**
+ * @brief Submits moving the cursor to the top left corner.
+ *
+ * Like LCD::home(), this also undoes any display shift.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::home(void) {
+    LCDOperation op;
+    op.type = LCDOperation::HOME;
+    return submit(op);
+}
+
+/**
+ * @brief Submits turning the display on or off.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::display(bool on) {
+    LCDOperation op;
+    op.type = on ? LCDOperation::DISPLAY_ON : LCDOperation::DISPLAY_OFF;
+    return submit(op);
+}
+
+/**
+ * @brief Submits turning the underline cursor on or off.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::cursor(bool on) {
+    LCDOperation op;
+    op.type = on ? LCDOperation::CURSOR_ON : LCDOperation::CURSOR_OFF;
+    return submit(op);
+}
+
+/**
+ * @brief Submits a custom character definition.
+ *
+ * @param location The CGRAM location (0-7).
+ * @param charmap The 8 rows of the character.
+ * @return true if the operation was queued.
+ */
+bool LCDQueue::createChar(uint8_t location, const uint8_t charmap[]) {
+    LCDOperation op;
+    op.type = LCDOperation::CREATE_CHAR;
+    op.x = location;
+    op.len = 8;
+    memcpy(op.text, charmap, 8);
+    return submit(op);
+}
+
+/**
+ * @brief Sets a function called after each successful submit.
+ *
+ * Typically used to wake the bus owner task, for example with a task notification.
+ * The function is called from the submitting context, so it must be safe there.
+ *
+ * The function and its context are read by submit() without synchronization, so set them
+ * before any producer task or interrupt can submit, and do not change them afterwards.
+ *
+ * @param notify The function, or nullptr for none.
+ * @param context Passed to the function.
+ */
+void LCDQueue::setNotify(void (*notify)(void* context), void* context) {
+    _notify_context = context;
+    _notify = notify;
+}
+
+/**
+ * @brief Executes queued operations on the display.
+ *
+ * Must only be called from one task, the owner of the display. Operations are executed
+ * in the order they were queued, each one completely before the next.
+ *
+ * @param max The maximum number of operations to execute.
+ * @return The number of operations executed.
+ */
+size_t LCDQueue::process(size_t max) {
+    size_t n = 0;
+
+    while (n < max) {
+        Slot* slot = &_slots[_dequeue_pos & (LCD_QUEUE_SIZE - 1)];
+        uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (_dequeue_pos + 1)) < 0) break;   // empty
+
+        LCDOperation op = slot->op;
+        slot->sequence.store(_dequeue_pos + LCD_QUEUE_SIZE, std::memory_order_release);
+        _dequeue_pos++;
+
+        execute(op);
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Builds and submits an operation carrying text.
+ */
+bool LCDQueue::submitText(LCDOperation::Type type, uint8_t x, uint8_t y, const char* text) {
+    LCDOperation op;
+    op.type = type;
+    op.x = x;
+    op.y = y;
+    op.len = 0;
+    while (op.len < LCD_QUEUE_TEXT_MAX && text[op.len]) {
+        op.text[op.len] = text[op.len];
+        op.len++;
+    }
+    return submit(op);
+}
+
+/**
+ * @brief Executes one operation on the display.
+ */
+void LCDQueue::execute(const LCDOperation& op) {
+    switch (op.type) {
+    case LCDOperation::PRINT_AT:
+        _lcd.setCursor(op.x, op.y);
+        _lcd.writeCells(op.text, op.len);
+        break;
+    case LCDOperation::PRINT:
+        _lcd.writeCells(op.text, op.len);
+        break;
+    case LCDOperation::CLEAR:
+        _lcd.clear();
+        break;
+    case LCDOperation::HOME:
+        _lcd.home();
+        break;
+    case LCDOperation::DISPLAY_ON:
+        _lcd.display();
+        break;
+    case LCDOperation::DISPLAY_OFF:
+        _lcd.noDisplay();
+        break;
+    case LCDOperation::CURSOR_ON:
+        _lcd.cursor();
+        break;
+    case LCDOperation::CURSOR_OFF:
+        _lcd.noCursor();
+        break;
+    case LCDOperation::CREATE_CHAR:
+        _lcd.createChar(op.x, op.text);
+        break;
+    }
+}
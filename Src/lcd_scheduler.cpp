@@ -0,0 +1,193 @@
+/**
+ * @file lcd_scheduler.cpp
+ * @brief Rate limited display updates with latest-value-wins coalescing.
+ */
+
+#include "lcd_scheduler.hpp"
+#include <cstdio>
+#include <cstring>
+
+/**
+ * @brief Creates a scheduler drawing through the given layout.
+ *
+ * @param layout The layout the fields are added to.
+ * @param clock_us Function returning a free running microsecond clock. When nullptr,
+ *        HAL_GetTick() is used, which limits the budget resolution to 1 ms.
+ */
+LCDScheduler::LCDScheduler(LCDLayout& layout, uint32_t (*clock_us)(void))
+    : _layout(layout), _coalesced(0) {
+    _clock_us = clock_us ? clock_us : tickClock;
+    _frame_start = _clock_us() - _period_us;
+}
+
+/**
+ * @brief Adds a text field.
+ *
+ * @param x Column of the first cell.
+ * @param y Row of the field.
+ * @param width Number of cells, at most LCD_SCHEDULER_FIELD_MAX.
+ * @return The field id, or -1 if the field does not fit.
+ */
+int LCDScheduler::addField(uint8_t x, uint8_t y, uint8_t width) {
+    if (_count >= LCD_LAYOUT_MAX_REGIONS || width > LCD_SCHEDULER_FIELD_MAX) return -1;
+
+    Field& f = _fields[_count];
+    f.shown[0] = 0;
+    f.pending[0] = 0;
+    f.region = _layout.addLabel(x, y, width, f.shown);
+    if (f.region < 0) return -1;
+    f.width = width;
+    f.sequence.store(0, std::memory_order_relaxed);
+    f.dirty.store(false, std::memory_order_relaxed);
+    return _count++;
+}
+
+/**
+ * @brief Posts new text for a field.
+ *
+ * The text replaces any text posted since the last flush of the field. Safe to call from
+ * other tasks than the one calling poll(), as long as each field has one producer.
+ *
+ * @param field The field id returned by addField().
+ * @param text The text, truncated to the width of the field.
+ */
+void LCDScheduler::post(int field, const char* text) {
+    if (field < 0 || field >= _count) return;
+    Field& f = _fields[field];
+
+    f.sequence.fetch_add(1, std::memory_order_acq_rel);
+    uint8_t i = 0;
+    for (; i < f.width && text[i]; i++) f.pending[i] = text[i];
+    f.pending[i] = 0;
+    f.sequence.fetch_add(1, std::memory_order_release);
+
+    if (f.dirty.exchange(true, std::memory_order_acq_rel)) {
+        _coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Posts formatted text for a field.
+ *
+ * @param field The field id returned by addField().
+ * @param format Format string specifying the output format.
+ * @param ... Additional arguments to be formatted.
+ * @return The number of characters formatted.
+ */
+int LCDScheduler::postFormatted(int field, const char* format, ...) {
+    char buffer[LCD_SCHEDULER_FIELD_MAX + 1];
+    int n;
+
+    va_list args;
+    va_start(args, format);
+    n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (n >= 0) post(field, buffer);
+    return n;
+}
+
+/**
+ * @brief Sets the maximum number of frames flushed per second.
+ */
+void LCDScheduler::setFrameRate(uint16_t fps) {
+    _period_us = 1000000UL / (fps ? fps : 1);
+}
+
+/**
+ * @brief Sets the bus time a single frame may use.
+ *
+ * A field is only flushed when its worst case cost fits in what is left of the budget,
+ * except for the first changed field of a frame. A budget below the cost of the widest
+ * field thus leaves one field per frame.
+ *
+ * @param us The budget in microseconds.
+ */
+void LCDScheduler::setBudget(uint32_t us) {
+    _budget_us = us;
+}
+
+/**
+ * @brief Flushes a frame when the frame period has passed.
+ *
+ * Call this often from the task that owns the display. Changed fields are flushed in
+ * round robin order, starting with the first field left over in the previous frame. The
+ * first changed field is always flushed; every other field is skipped when its estimated
+ * cost no longer fits in the budget, so a narrow field after a wide one can still go out.
+ *
+ * @return true if a frame was started.
+ */
+bool LCDScheduler::poll(void) {
+    uint32_t now = _clock_us();
+    if (now - _frame_start < _period_us) return false;
+    _frame_start = now;
+    bool flushed = false, skipped = false;
+
+    for (uint8_t n = 0; n < _count; n++) {
+        uint8_t id = (_next + n) % _count;
+        Field& f = _fields[id];
+        if (!f.dirty.load(std::memory_order_acquire)) continue;
+
+        uint32_t estimate = (1 + f.width) * _byte_us;
+        uint32_t start = _clock_us();
+        if (flushed && start - _frame_start + estimate > _budget_us) {
+            // served first in the next frame
+            if (!skipped) _next = id;
+            skipped = true;
+            continue;
+        }
+        if (!takePending(f)) continue;
+        flushed = true;
+
+        size_t bytes = _layout.bytesSent();
+        _layout.setText(f.region, f.shown);
+        bytes = _layout.bytesSent() - bytes;
+
+        // Replace the default by the slowest byte time seen, so the estimate stays an
+        // upper bound for this display
+        uint32_t elapsed = _clock_us() - start;
+        if (bytes) {
+            uint32_t byte_us = (elapsed + bytes - 1) / bytes;
+            if (!_byte_us_measured || byte_us > _byte_us) _byte_us = byte_us;
+            _byte_us_measured = true;
+        }
+        if (!skipped) _next = (id + 1) % _count;
+    }
+
+    _last_frame_us = _clock_us() - _frame_start;
+    if (_last_frame_us > _max_frame_us) _max_frame_us = _last_frame_us;
+    return true;
+}
+
+/**
+ * @brief Copies the latest posted text of a field for display.
+ *
+ * The text is copied to a local buffer first and only goes to the shown text, which the
+ * layout draws from, once the sequence shows that no producer wrote it meanwhile.
+ *
+ * @return false if a producer was writing the field, which is then left for the next frame.
+ */
+bool LCDScheduler::takePending(Field& f) {
+    char text[LCD_SCHEDULER_FIELD_MAX + 1];
+
+    // cleared first, so a post that is missed here sets it again
+    f.dirty.store(false, std::memory_order_release);
+    uint32_t before = f.sequence.load(std::memory_order_acquire);
+    if (!(before & 1)) {
+        memcpy(text, f.pending, sizeof(text));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (f.sequence.load(std::memory_order_relaxed) == before) {
+            memcpy(f.shown, text, sizeof(f.shown));
+            return true;
+        }
+    }
+    f.dirty.store(true, std::memory_order_release);
+    return false;
+}
+
+/**
+ * @brief Default clock, the HAL millisecond tick in microseconds.
+ */
+uint32_t LCDScheduler::tickClock(void) {
+    return HAL_GetTick() * 1000;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file lcd_screen.cpp
+ * @brief Showing compile-time screen templates and patching their fields.
+ */
+
+#include "lcd_screen.hpp"
+#include <cstdio>
+#include <cstring>
+
+/**
+ * @brief Creates a view that shows templates on the given display.
+ *
+ * @param lcd The display, already initialized with Begin().
+ */
+LCDScreenView::LCDScreenView(LCD& lcd) : _lcd(lcd) {
+}
+
+/**
+ * @brief Sends the fixed text of a template, with empty field slots.
+ *
+ * The text is sent straight from the table, one address command per row. When the
+ * template covers the whole display, it is sent as one frame with LCD::writeFrame().
+ *
+ * @param text The rows of the template, cols characters each.
+ * @param cols The template width.
+ * @param rows The number of rows.
+ * @param fields The field slots.
+ * @param count The number of field slots.
+ * @return false if the template does not fit on the display, which is left unchanged.
+ */
+bool LCDScreenView::enterText(const char* text, uint8_t cols, uint8_t rows, const LCDField* fields, uint8_t count) {
+    if (cols > _lcd.getCols() || rows > _lcd.getRows()) return false;
+
+    _fields = fields;
+    _count = count;
+
+    const uint8_t* cells = reinterpret_cast<const uint8_t*>(text);
+    if (cols == _lcd.getCols() && rows == _lcd.getRows()) {
+        _lcd.writeFrame(cells);
+        return true;
+    }
+    for (uint8_t y = 0; y < rows; y++) {
+        _lcd.setCursor(0, y);
+        _lcd.writeCells(cells + y * cols, cols);
+    }
+    return true;
+}
+
+/**
+ * @brief Shows a value in a field slot of the current template.
+ *
+ * Only the cells of the slot are sent: the value is clipped to the slot width and the
+ * rest of the slot is filled with spaces.
+ *
+ * @param field The field number, counted in reading order from 0.
+ * @param value The text to show.
+ * @return false if there is no such field.
+ */
+bool LCDScreenView::set(uint8_t field, const char* value) {
+    if (field >= _count) return false;
+
+    const LCDField& f = _fields[field];
+    uint8_t cells[40];
+    size_t len = strlen(value);
+    if (len > f.width) len = f.width;
+    memcpy(cells, value, len);
+    memset(cells + len, ' ', f.width - len);
+
+    _lcd.setCursor(f.x, f.y);
+    _lcd.writeCells(cells, f.width);
+    return true;
+}
+
+/**
+ * @brief Shows a formatted value in a field slot of the current template.
+ *
+ * @param field The field number, counted in reading order from 0.
+ * @param format Format string, as for printf. Use a width (for example "%4d") to align.
+ * @param ... Additional arguments to be formatted.
+ * @return The number of characters formatted, or -1 if there is no such field.
+ */
+int LCDScreenView::setFormatted(uint8_t field, const char* format, ...) {
+    if (field >= _count) return -1;
+
+    char buffer[41];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, (size_t)_fields[field].width + 1, format, args);
+    va_end(args);
+
+    if (n < 0) return n;
+    set(field, buffer);
+    return n;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file lcd_stack.cpp
+ * @brief Screen stack with snapshots, for menu navigation without redraws.
+ */
+
+#include "lcd_stack.hpp"
+#include <string.h>
+
+/**
+ * @brief Creates an empty screen stack for the given display.
+ *
+ * @param lcd The display, initialized with Begin().
+ */
+LCDScreenStack::LCDScreenStack(LCD& lcd) : _lcd(lcd) {
+}
+
+/**
+ * @brief Takes a snapshot of the screen.
+ *
+ * With page flipping, the page being drawn is taken.
+ *
+ * @param snapshot Receives the snapshot.
+ * @return false if the display has more than LCD_STACK_MAX_CELLS cells.
+ */
+bool LCDScreenStack::capture(LCDSnapshot& snapshot) {
+    if (!fits()) return false;
+
+    snapshot.cols = _lcd._numcols;
+    snapshot.rows = _lcd._numlines;
+    for (uint8_t y = 0; y < snapshot.rows; y++) {
+        for (uint8_t x = 0; x < snapshot.cols; x++) {
+            snapshot.cells[y * snapshot.cols + x] = shown(x, y);
+        }
+    }
+    memcpy(snapshot.cgram, _lcd._cgram, sizeof(snapshot.cgram));
+    snapshot.cg_defined = _lcd._cg_defined;
+    snapshot.displaycontrol = _lcd._displaycontrol;
+    snapshot.displaymode = _lcd._displaymode;
+    snapshot.col = _lcd._col;
+    snapshot.row = _lcd._row;
+    snapshot.ctrl = _lcd._cur;
+    snapshot.address = _lcd._ac[_lcd._cur];
+    return true;
+}
+
+/**
+ * @brief Brings the screen to a snapshot, sending only what differs.
+ *
+ * Custom characters are updated first, then the cells, then the modes and the cursor.
+ *
+ * @param snapshot The snapshot, taken from a display with the same geometry.
+ * @return The number of bytes sent, 0 if nothing differs or the geometry does not match.
+ */
+size_t LCDScreenStack::show(const LCDSnapshot& snapshot) {
+    if (snapshot.cols != _lcd._numcols || snapshot.rows != _lcd._numlines) return 0;
+
+    size_t sent = showCgram(snapshot);
+    sent += showFrame(snapshot.cells);
+
+    if (_lcd._displaycontrol != snapshot.displaycontrol) {
+        _lcd._displaycontrol = snapshot.displaycontrol;
+        _lcd.command(LCD_DISPLAYCONTROL | _lcd._displaycontrol);
+        sent++;
+    }
+    if (_lcd._displaymode != snapshot.displaymode) {
+        _lcd._displaymode = snapshot.displaymode;
+        _lcd.command(LCD_ENTRYMODESET | _lcd._displaymode);
+        sent++;
+    }
+    _lcd._col = snapshot.col;
+    _lcd._row = snapshot.row;
+    if (_lcd.restoreCursor(snapshot.ctrl, snapshot.address)) sent++;
+    return sent;
+}
+
+/**
+ * @brief Brings the cells of the screen to a frame, sending only the cells that differ.
+ *
+ * Runs of changed cells are written with one cursor address command each. The cells are
+ * written left to right without display shift: an entry mode with shift or decrement is
+ * replaced by the plain one while they are written.
+ *
+ * @param cells getCols() * getRows() character codes, row by row.
+ * @return The number of bytes sent.
+ */
+size_t LCDScreenStack::showFrame(const uint8_t* cells) {
+    if (!fits()) return 0;
+
+    uint8_t cols = _lcd._numcols;
+    size_t sent = 0;
+    for (uint8_t y = 0; y < _lcd._numlines; y++) {
+        const uint8_t* row = cells + y * cols;
+        uint8_t x = 0;
+        while (x < cols) {
+            if (shown(x, y) == row[x]) {
+                x++;
+                continue;
+            }
+            uint8_t start = x;
+            while (x < cols && shown(x, y) != row[x]) x++;
+
+            if (_lcd._entry != LCD_ENTRYLEFT) {
+                _lcd.command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+                sent++;
+            }
+            _lcd.setCursor(start, y);
+            _lcd.writeCells(&row[start], x - start);
+            sent += 1 + (x - start);
+        }
+    }
+    if (_lcd._entry != (_lcd._displaymode & (LCD_ENTRYLEFT | LCD_ENTRYSHIFTINCREMENT))) {
+        _lcd.command(LCD_ENTRYMODESET | _lcd._displaymode);
+        sent++;
+    }
+    return sent;
+}
+
+/**
+ * @brief Saves the screen on the stack and optionally shows another one.
+ *
+ * @param next The screen to show, or nullptr to leave the screen as it is and draw the
+ *        next one by other means.
+ * @return false if the stack is full or the display is too large.
+ */
+bool LCDScreenStack::push(const LCDSnapshot* next) {
+    if (_depth >= LCD_STACK_DEPTH || !capture(_stack[_depth])) return false;
+    _depth++;
+    if (next) show(*next);
+    return true;
+}
+
+/**
+ * @brief Goes back to the screen saved by the last push().
+ * @return false if the stack is empty.
+ */
+bool LCDScreenStack::pop(void) {
+    if (!_depth) return false;
+    show(_stack[--_depth]);
+    return true;
+}
+
+/**
+ * @brief Tells whether the display has at most LCD_STACK_MAX_CELLS cells.
+ */
+bool LCDScreenStack::fits(void) const {
+    return _lcd._numcols * _lcd._numlines <= LCD_STACK_MAX_CELLS;
+}
+
+/**
+ * @brief Returns the shadow of the cell that setCursor(x, y) and a write would change.
+ */
+uint8_t LCDScreenStack::shown(uint8_t x, uint8_t y) {
+    uint8_t ctrl = (_lcd._controllers > 1 && y >= _lcd._numlines / 2) ? 1 : 0;
+    uint8_t address = x + _lcd._row_offsets[y] + _lcd.drawOffset();
+    return _lcd._ddram[ctrl][_lcd.ddramIndex(address)];
+}
+
+/**
+ * @brief Rewrites the CGRAM rows of the snapshot's custom characters that differ.
+ *
+ * Locations the snapshot does not define are left as they are. The CGRAM address is only
+ * set where the address counter does not already point to the row.
+ *
+ * @return The number of bytes sent, the address counter is left in CGRAM if not 0.
+ */
+size_t LCDScreenStack::showCgram(const LCDSnapshot& snapshot) {
+    size_t sent = 0;
+    for (uint8_t address = 0; address < sizeof(snapshot.cgram); address++) {
+        uint8_t location = address >> 3;
+        if (!(snapshot.cg_defined & (1 << location))) continue;
+        if ((_lcd._cg_defined & (1 << location)) && _lcd._cgram[address] == snapshot.cgram[address]) continue;
+
+        bool there = true;
+        for (uint8_t c = 0; c < _lcd._controllers; c++) {
+            there = there && _lcd._ac_cgram[c] && _lcd._ac[c] == address;
+        }
+        if (!there) {
+            _lcd.command(LCD_SETCGRAMADDR | address);
+            sent++;
+        }
+        _lcd.write(snapshot.cgram[address]);
+        sent++;
+    }
+    return sent;
+}
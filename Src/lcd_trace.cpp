@@ -0,0 +1,187 @@
+/**
+ * @file lcd_trace.cpp
+ * @brief Bus signal recording with VCD and binary export.
+ */
+
+#include "lcd.hpp"
+#include "lcd_trace.hpp"
+#include <cstdio>
+#include <cstring>
+
+// Binary trace: "LCDT", version, clock in Hz (4 bytes, little endian), then per event the
+// time since the previous event as a base-128 varint and one byte signal << 1 | level.
+static const uint8_t trace_magic[4] = { 'L', 'C', 'D', 'T' };
+static const uint8_t trace_version = 1;
+static const size_t trace_header = 9;
+
+static const char* const signal_names[LCD_TRACE_SIGNALS] = {
+    "RS", "RW", "EN", "D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7", "EN2", "DIR"
+};
+
+/**
+ * @brief Creates a trace recording into the given buffer.
+ *
+ * @param buffer Storage for the events. Recording stops when it is full.
+ * @param capacity The number of events the buffer holds.
+ * @param clock Function returning a free running tick counter. When nullptr, the DWT
+ *        cycle counter is used.
+ * @param clock_hz The tick rate of the clock. When 0, SystemCoreClock is used.
+ */
+LCDTrace::LCDTrace(LCDTraceEvent* buffer, size_t capacity, uint32_t (*clock)(void), uint32_t clock_hz)
+    : _events(buffer), _capacity(capacity) {
+    _clock = clock ? clock : LCD::cycles;
+    _clock_hz = clock_hz ? clock_hz : SystemCoreClock;
+    reset();
+}
+
+/**
+ * @brief Records the level of a signal, if it changed.
+ *
+ * @param signal The signal number, LCD_TRACE_RS to LCD_TRACE_EN2.
+ * @param level The new level, 0 or 1.
+ */
+void LCDTrace::record(uint8_t signal, uint8_t level) {
+    if (signal >= LCD_TRACE_SIGNALS || _level[signal] == level) return;
+    _level[signal] = level;
+
+    if (_count >= _capacity) {
+        _dropped++;
+        return;
+    }
+    LCDTraceEvent& e = _events[_count++];
+    e.time = _clock();
+    e.signal = signal;
+    e.level = level;
+}
+
+/**
+ * @brief Discards all recorded events.
+ */
+void LCDTrace::reset(void) {
+    _count = 0;
+    _dropped = 0;
+    memset(_level, 0xFF, sizeof(_level));
+}
+
+/**
+ * @brief Writes the trace as a Value Change Dump.
+ *
+ * Times are in nanoseconds from the first event. Signals that never changed are left
+ * undefined.
+ *
+ * @param out Called with each piece of the file, for example to write it to a UART or file.
+ * @param context Passed to out.
+ * @return The number of characters written.
+ */
+size_t LCDTrace::writeVcd(void (*out)(const char* text, size_t len, void* context), void* context) const {
+    char line[64];
+    size_t total = 0;
+    int n;
+
+    auto emit = [&](const char* text, int len) {
+        if (len <= 0) return;
+        out(text, len, context);
+        total += len;
+    };
+
+    n = snprintf(line, sizeof(line), "$timescale 1ns $end\n$scope module lcd $end\n");
+    emit(line, n);
+    for (uint8_t s = 0; s < LCD_TRACE_SIGNALS; s++) {
+        n = snprintf(line, sizeof(line), "$var wire 1 %c %s $end\n", '!' + s, signal_names[s]);
+        emit(line, n);
+    }
+    n = snprintf(line, sizeof(line), "$upscope $end\n$enddefinitions $end\n$dumpvars\n");
+    emit(line, n);
+    for (uint8_t s = 0; s < LCD_TRACE_SIGNALS; s++) {
+        n = snprintf(line, sizeof(line), "x%c\n", '!' + s);
+        emit(line, n);
+    }
+    n = snprintf(line, sizeof(line), "$end\n");
+    emit(line, n);
+
+    uint64_t ticks = 0;
+    uint64_t last_ns = UINT64_MAX;
+    for (size_t i = 0; i < _count; i++) {
+        if (i) ticks += (uint32_t)(_events[i].time - _events[i - 1].time);
+        uint64_t ns = ticks * 1000000000ULL / _clock_hz;
+        if (ns != last_ns) {
+            n = snprintf(line, sizeof(line), "#%llu\n", (unsigned long long)ns);
+            emit(line, n);
+            last_ns = ns;
+        }
+        n = snprintf(line, sizeof(line), "%u%c\n", _events[i].level, '!' + _events[i].signal);
+        emit(line, n);
+    }
+    return total;
+}
+
+/**
+ * @brief Exports the trace in the compact binary form.
+ *
+ * @param out Receives the binary trace.
+ * @param len The size of out.
+ * @return The number of bytes stored, or 0 if out is too small for the whole trace.
+ */
+size_t LCDTrace::exportBinary(uint8_t* out, size_t len) const {
+    if (len < trace_header) return 0;
+
+    memcpy(out, trace_magic, sizeof(trace_magic));
+    out[4] = trace_version;
+    for (uint8_t i = 0; i < 4; i++) out[5 + i] = _clock_hz >> (8 * i);
+
+    size_t n = trace_header;
+    for (size_t i = 0; i < _count; i++) {
+        uint32_t delta = i ? _events[i].time - _events[i - 1].time : 0;
+        do {
+            if (n >= len) return 0;
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            out[n++] = byte | (delta ? 0x80 : 0);
+        } while (delta);
+
+        if (n >= len) return 0;
+        out[n++] = (_events[i].signal << 1) | (_events[i].level & 1);
+    }
+    return n;
+}
+
+/**
+ * @brief Decodes a binary trace into pin changes.
+ *
+ * @param data The binary trace, as produced by exportBinary().
+ * @param len The size of the binary trace.
+ * @param pin Called for each pin change, with the time in nanoseconds from the first event.
+ * @param context Passed to pin.
+ * @return The number of events decoded, 0 if the data is not a binary trace.
+ */
+size_t LCDTrace::replay(const uint8_t* data, size_t len,
+                        void (*pin)(uint64_t time_ns, uint8_t signal, uint8_t level, void* context),
+                        void* context) {
+    if (len < trace_header || memcmp(data, trace_magic, sizeof(trace_magic)) || data[4] != trace_version) {
+        return 0;
+    }
+    uint32_t clock_hz = 0;
+    for (uint8_t i = 0; i < 4; i++) clock_hz |= (uint32_t)data[5 + i] << (8 * i);
+    if (!clock_hz) return 0;
+
+    size_t n = trace_header, count = 0;
+    uint64_t ticks = 0;
+    while (n < len) {
+        uint32_t delta = 0;
+        uint8_t shift = 0;
+        uint8_t byte;
+        do {
+            if (n >= len || shift > 28) return count;
+            byte = data[n++];
+            delta |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        if (n >= len) return count;
+        uint8_t event = data[n++];
+        ticks += delta;
+        pin(ticks * 1000000000ULL / clock_hz, event >> 1, event & 1, context);
+        count++;
+    }
+    return count;
+}
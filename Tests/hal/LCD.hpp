@@ -0,0 +1,3 @@
+/* Host build stub: LCD_wrapper.cpp includes the class header by this name. */
+#pragma once
+#include "lcd.hpp"
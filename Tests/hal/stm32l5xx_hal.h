@@ -0,0 +1,135 @@
+/**
+ * @file stm32l5xx_hal.h
+ * @brief Host build stub of the parts of the STM32 HAL and CMSIS the library uses.
+ *
+ * The functions are implemented by the simulator in Tests/sim, which connects the GPIO
+ * ports to simulated HD44780 controllers and keeps a simulated clock. DWT->CYCCNT and the
+ * BSRR registers are C++ proxies, so reading the cycle counter advances the clock and a
+ * BSRR store reaches the controllers.
+ */
+
+#ifndef STM32L5XX_HAL_STUB_H
+#define STM32L5XX_HAL_STUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+struct SimBsrr {
+    SimBsrr& operator=(uint32_t value);
+};
+struct SimCycleCounter {
+    operator uint32_t() const;
+    SimCycleCounter& operator=(uint32_t value);
+};
+typedef struct {
+    volatile uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR;
+    SimBsrr BSRR;
+    volatile uint32_t LCKR, AFR[2], BRR;
+} GPIO_TypeDef;
+typedef struct {
+    volatile uint32_t CTRL;
+    SimCycleCounter CYCCNT;
+} DWT_Type;
+#else
+typedef struct {
+    volatile uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFR[2], BRR;
+} GPIO_TypeDef;
+typedef struct {
+    volatile uint32_t CTRL, CYCCNT;
+} DWT_Type;
+#endif
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct {
+    uint32_t Pin, Mode, Pull, Speed, Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_MODE_INPUT             0x00u
+#define GPIO_MODE_OUTPUT_PP         0x01u
+#define GPIO_MODE_OUTPUT_OD         0x11u
+#define GPIO_NOPULL                 0x00u
+#define GPIO_PULLUP                 0x01u
+#define GPIO_PULLDOWN               0x02u
+#define GPIO_SPEED_FREQ_LOW         0x00u
+#define GPIO_SPEED_FREQ_MEDIUM      0x01u
+#define GPIO_SPEED_FREQ_HIGH        0x02u
+#define GPIO_SPEED_FREQ_VERY_HIGH   0x03u
+
+#define GPIO_PIN_0  0x0001u
+#define GPIO_PIN_1  0x0002u
+#define GPIO_PIN_2  0x0004u
+#define GPIO_PIN_3  0x0008u
+#define GPIO_PIN_4  0x0010u
+#define GPIO_PIN_5  0x0020u
+#define GPIO_PIN_6  0x0040u
+#define GPIO_PIN_7  0x0080u
+#define GPIO_PIN_8  0x0100u
+#define GPIO_PIN_9  0x0200u
+#define GPIO_PIN_10 0x0400u
+#define GPIO_PIN_11 0x0800u
+#define GPIO_PIN_12 0x1000u
+#define GPIO_PIN_13 0x2000u
+#define GPIO_PIN_14 0x4000u
+#define GPIO_PIN_15 0x8000u
+
+extern GPIO_TypeDef sim_ports[6];
+extern DWT_Type sim_dwt;
+extern CoreDebug_Type sim_core_debug;
+extern SysTick_Type sim_systick;
+extern uint32_t sim_core_clock;
+
+#define GPIOA (&sim_ports[0])
+#define GPIOB (&sim_ports[1])
+#define GPIOC (&sim_ports[2])
+#define GPIOD (&sim_ports[3])
+#define GPIOE (&sim_ports[4])
+#define GPIOF (&sim_ports[5])
+#define DWT (&sim_dwt)
+#define CoreDebug (&sim_core_debug)
+#define SysTick (&sim_systick)
+#define SystemCoreClock sim_core_clock
+
+#define DWT_CTRL_CYCCNTENA_Msk      (1u << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1u << 24)
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOD_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOE_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOF_CLK_ENABLE() do {} while (0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init);
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin);
+void HAL_Delay(uint32_t ms);
+uint32_t HAL_GetTick(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+void __WFI(void);
+void __DSB(void);
+void __ISB(void);
+void __NOP(void);
+uint32_t __get_PRIMASK(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_IPSR(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32L5XX_HAL_STUB_H */
@@ -0,0 +1,2 @@
+/* Host build stub, the LL headers are not used by the library. */
+#pragma once
@@ -0,0 +1,344 @@
+/**
+ * @file sim_lcd.cpp
+ * @brief Simulated HD44780 controllers and clock behind the HAL stub, for host tests.
+ */
+
+#include "sim_lcd.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+GPIO_TypeDef sim_ports[6];
+DWT_Type sim_dwt;
+CoreDebug_Type sim_core_debug;
+SysTick_Type sim_systick;
+uint32_t sim_core_clock = 110000000;
+
+double sim_us = 0;
+long sim_violations = 0;
+long sim_cycle_reads = 0;
+double sim_gpio_us = 0.02;
+double sim_gpio_jitter_us = 0;
+void (*sim_irq_hook)(void) = nullptr;
+long sim_irq_hal_calls = 0;
+void (*sim_read_hook)(GPIO_TypeDef* port) = nullptr;
+
+static std::vector<SimLCD*> controllers;
+static int irq_depth = 0;
+static uint32_t primask = 0;
+
+/**
+ * @brief Advances the simulated clock and runs the interrupt hook.
+ */
+void sim_advance_us(double us) {
+    sim_us += us;
+    if (sim_irq_hook && !irq_depth) {
+        irq_depth++;
+        sim_irq_hook();
+        irq_depth--;
+    }
+}
+
+/**
+ * @brief Accounts a HAL access: counts it when made from the interrupt hook, and lets time pass.
+ */
+static void halAccess(double us) {
+    if (irq_depth) sim_irq_hal_calls++;
+    sim_advance_us(us);
+}
+
+static double gpioTime(void) {
+    double us = sim_gpio_us;
+    if (sim_gpio_jitter_us > 0) us += sim_gpio_jitter_us * (rand() % 1000) / 1000.0;
+    return us;
+}
+
+/**
+ * @brief Passes the edges of an output change to the controllers wired to the port.
+ */
+struct SimBus {
+    static void changed(GPIO_TypeDef* port, uint32_t before) {
+        for (SimLCD* lcd : controllers) {
+            if (port != lcd->_en_port) continue;
+            bool was = before & lcd->_en, now = port->ODR & lcd->_en;
+            if (was != now) lcd->edge(now);
+        }
+    }
+};
+
+SimLCD::SimLCD() {
+    memset(ddram, ' ', sizeof(ddram));
+    memset(cgram, 0, sizeof(cgram));
+    controllers.push_back(this);
+}
+
+SimLCD::~SimLCD() {
+    for (size_t i = 0; i < controllers.size(); i++) {
+        if (controllers[i] == this) controllers.erase(controllers.begin() + i);
+    }
+}
+
+/**
+ * @brief Connects the controller to its pins.
+ */
+void SimLCD::wire(GPIO_TypeDef* data, const uint16_t pins[4], GPIO_TypeDef* rs_port, uint16_t rs,
+                  GPIO_TypeDef* rw_port, uint16_t rw, GPIO_TypeDef* en_port, uint16_t en) {
+    _data = data;
+    memcpy(_pins, pins, sizeof(_pins));
+    _rs_port = rs_port;
+    _rs = rs;
+    _rw_port = rw_port;
+    _rw = rw;
+    _en_port = en_port;
+    _en = en;
+}
+
+/**
+ * @brief Connects the controller to the pins used by the tests: D4-D7 on PC8-PC11, RS on
+ *        PF3, RW on PD2 and EN on PC12 or the given pin of port C.
+ */
+void SimLCD::wireDefault(uint16_t en) {
+    static const uint16_t pins[4] = { GPIO_PIN_8, GPIO_PIN_9, GPIO_PIN_10, GPIO_PIN_11 };
+    wire(GPIOC, pins, GPIOF, GPIO_PIN_3, GPIOD, GPIO_PIN_2, GPIOC, en);
+}
+
+/**
+ * @brief Returns the characters shown in a row of a cols x rows panel.
+ */
+std::string SimLCD::row(int r, int cols, int rows) const {
+    std::string s;
+    if (lines == 1) {
+        for (int x = 0; x < cols; x++) s += (char)ddram[(x + shift) % 80];
+        return s;
+    }
+    int line = (rows > 2) ? (r & 1) : r;
+    int base = (rows > 2 && r >= 2) ? cols : 0;
+    for (int x = 0; x < cols; x++) s += (char)ddram[line * 40 + (base + x + shift) % 40];
+    return s;
+}
+
+/**
+ * @brief Returns the rows shown, each followed by a newline.
+ */
+std::string SimLCD::screen(int cols, int rows) const {
+    std::string s;
+    for (int r = 0; r < rows; r++) {
+        s += row(r, cols, rows);
+        s += '\n';
+    }
+    return s;
+}
+
+void SimLCD::edge(bool rising) {
+    bool rw = _rw_port && (_rw_port->ODR & _rw);
+    bool rs = _rs_port->ODR & _rs;
+
+    if (!rising && !rw) {
+        uint8_t nibble = 0;
+        for (int i = 0; i < 4; i++) {
+            int bit = __builtin_ctz(_pins[i]);
+            if (((_data->MODER >> (2 * bit)) & 3) != 1) {
+                printf("SIM VIOLATION: data pin D%d is not an output when latched\n", 4 + i);
+                sim_violations++;
+            }
+            if (_data->ODR & _pins[i]) nibble |= 1 << i;
+        }
+        if (!four_bit) {
+            // only D4-D7 are wired: in 8-bit mode the low nibble reads as 0
+            execute(nibble << 4, rs);
+        } else if (!_low_half) {
+            _high = nibble;
+            _low_half = true;
+        } else {
+            _low_half = false;
+            execute((_high << 4) | nibble, rs);
+        }
+    } else if (rising && rw) {
+        uint8_t value;
+        if (!rs) {
+            value = (sim_us < _busy_until ? 0x80 : 0) | (ac & 0x7F);
+        } else {
+            value = ac_cgram ? cgram[ac & 63] : ddram[ddramIndex(ac)];
+        }
+        uint8_t nibble = _read_low ? (value & 0xF) : (value >> 4);
+        if (_read_low && rs) stepAddress();
+        _read_low = !_read_low;
+        for (int i = 0; i < 4; i++) {
+            if (nibble & (1 << i)) _data->IDR |= _pins[i];
+            else _data->IDR &= ~_pins[i];
+        }
+    }
+}
+
+void SimLCD::execute(uint8_t value, bool data) {
+    if (sim_us < _busy_until - 1e-9) {
+        printf("SIM VIOLATION: %s 0x%02X written %.2f us before the last byte executed\n",
+               data ? "data" : "command", value, _busy_until - sim_us);
+        sim_violations++;
+    }
+    double us = command_us;
+
+    if (data) {
+        data_bytes++;
+        us = data_us;
+        if (ac_cgram) {
+            cgram[ac & 63] = value;
+        } else {
+            ddram[ddramIndex(ac)] = value;
+            if (entry_shift) shift += increment ? 1 : -1;
+        }
+        stepAddress();
+    } else {
+        commands++;
+        if (value & 0x80) {
+            ac_cgram = false;
+            ac = value & 0x7F;
+        } else if (value & 0x40) {
+            ac_cgram = true;
+            ac = value & 0x3F;
+        } else if (value & 0x20) {
+            if (!(value & 0x10)) {
+                if (!four_bit) _low_half = false;
+                four_bit = true;
+            } else {
+                four_bit = false;
+            }
+            lines = (value & 0x08) ? 2 : 1;
+        } else if (value & 0x10) {
+            if (value & 0x08) shift += (value & 0x04) ? -1 : 1;
+        } else if (value & 0x08) {
+            display_control = value & 0x07;
+        } else if (value & 0x04) {
+            increment = value & 0x02;
+            entry_shift = value & 0x01;
+        } else if (value & 0x02) {
+            ac = 0;
+            ac_cgram = false;
+            shift = 0;
+            us = clear_us;
+        } else if (value & 0x01) {
+            memset(ddram, ' ', sizeof(ddram));
+            ac = 0;
+            ac_cgram = false;
+            shift = 0;
+            increment = true;
+            us = clear_us;
+        }
+    }
+    int width = (lines == 1) ? 80 : 40;
+    shift = ((shift % width) + width) % width;
+    _busy_until = sim_us + us;
+    if (on_execute) on_execute(*this, value, data, context);
+}
+
+void SimLCD::stepAddress(void) {
+    if (ac_cgram) {
+        ac = (ac + (increment ? 1 : -1)) & 63;
+    } else if (lines == 1) {
+        ac = increment ? ((ac + 1) % 80) : (ac ? ac - 1 : 79);
+    } else if (increment) {
+        ac++;
+        if (ac == 0x28) ac = 0x40;
+        else if (ac == 0x68) ac = 0x00;
+    } else {
+        if (ac == 0x00) ac = 0x67;
+        else if (ac == 0x40) ac = 0x27;
+        else ac--;
+    }
+}
+
+int SimLCD::ddramIndex(uint8_t address) const {
+    if (lines == 1) return address % 80;
+    return (address < 0x40) ? address % 40 : 40 + (address - 0x40) % 40;
+}
+
+SimBsrr& SimBsrr::operator=(uint32_t value) {
+    GPIO_TypeDef* port = (GPIO_TypeDef*)((char*)this - offsetof(GPIO_TypeDef, BSRR));
+    halAccess(gpioTime());
+    uint32_t before = port->ODR;
+    port->ODR = (port->ODR & ~(value >> 16)) | (value & 0xFFFF);
+    SimBus::changed(port, before);
+    return *this;
+}
+
+SimCycleCounter::operator uint32_t() const {
+    sim_cycle_reads++;
+    halAccess(0.02);
+    return (uint32_t)(uint64_t)(sim_us * (sim_core_clock / 1e6));
+}
+
+SimCycleCounter& SimCycleCounter::operator=(uint32_t) {
+    return *this;
+}
+
+extern "C" {
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init) {
+    for (int bit = 0; bit < 16; bit++) {
+        if (!(init->Pin & (1u << bit))) continue;
+        port->MODER &= ~(3u << (2 * bit));
+        port->MODER |= (init->Mode & 3) << (2 * bit);
+    }
+    halAccess(0.5);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+    halAccess(gpioTime());
+    uint32_t before = port->ODR;
+    if (state) port->ODR |= pin;
+    else port->ODR &= ~pin;
+    SimBus::changed(port, before);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin) {
+    halAccess(gpioTime());
+    if (sim_read_hook) sim_read_hook(port);
+    return (port->IDR & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+// like the HAL, waits at least one full tick more than asked for
+void HAL_Delay(uint32_t ms) {
+    halAccess(ms * 1000.0 + 1000.0);
+}
+
+uint32_t HAL_GetTick(void) {
+    halAccess(0);
+    return (uint32_t)(sim_us / 1000);
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void) {
+    return sim_core_clock;
+}
+
+void __WFI(void) {
+    sim_advance_us(1);
+}
+
+void __DSB(void) {
+}
+
+void __ISB(void) {
+}
+
+void __NOP(void) {
+    sim_advance_us(1e6 / sim_core_clock);
+}
+
+uint32_t __get_PRIMASK(void) {
+    return primask;
+}
+
+void __disable_irq(void) {
+    primask = 1;
+}
+
+void __enable_irq(void) {
+    primask = 0;
+}
+
+uint32_t __get_IPSR(void) {
+    return irq_depth ? 16 : 0;
+}
+
+}
@@ -0,0 +1,98 @@
+/**
+ * @file sim_lcd.hpp
+ * @brief Simulated HD44780 controllers and clock behind the HAL stub, for host tests.
+ *
+ * A SimLCD watches the GPIO pins it is wired to. On each falling enable edge with RW low
+ * it latches a nibble, and it executes the byte once it has both nibbles in 4-bit mode.
+ * Rising edges with RW high drive the busy flag, the address counter or RAM content
+ * onto the data pins. Every byte starts the execution time of the controller, and a byte
+ * written before that time has passed is counted as a violation, as is a data pin that is
+ * not an output when the nibble is latched.
+ *
+ * Time is simulated: GPIO accesses, cycle counter reads and HAL_Delay() advance it, and a
+ * test can advance it itself to model the work of the application.
+ */
+
+#ifndef SIM_LCD_H
+#define SIM_LCD_H
+
+#include "stm32l5xx_hal.h"
+#include <string>
+
+class SimLCD {
+public:
+    SimLCD();
+    ~SimLCD();
+
+    void wire(GPIO_TypeDef* data, const uint16_t pins[4], GPIO_TypeDef* rs_port, uint16_t rs,
+              GPIO_TypeDef* rw_port, uint16_t rw, GPIO_TypeDef* en_port, uint16_t en);
+    void wireDefault(uint16_t en = GPIO_PIN_12);
+
+    std::string row(int r, int cols, int rows) const;
+    std::string screen(int cols, int rows) const;
+    bool displayOn(void) const { return (display_control & 0x04) != 0; }
+
+    // Execution times of the simulated panel
+    double command_us = 37;
+    double data_us = 41;
+    double clear_us = 1520;
+
+    // Controller state
+    uint8_t ddram[80];              // line 0 at 0-39, line 1 at 40-79
+    uint8_t cgram[64];
+    uint8_t ac = 0;                 // address counter
+    bool ac_cgram = false;
+    int shift = 0;                  // display shift in columns to the left
+    bool increment = true;
+    bool entry_shift = false;
+    uint8_t display_control = 0;
+    bool four_bit = false;
+    int lines = 1;
+    long commands = 0;
+    long data_bytes = 0;
+
+    // Called after each executed byte, e.g. to check what the panel shows
+    void (*on_execute)(SimLCD& lcd, uint8_t value, bool data, void* context) = nullptr;
+    void* context = nullptr;
+
+private:
+    friend struct SimBus;
+
+    GPIO_TypeDef* _data = nullptr;
+    GPIO_TypeDef *_rs_port = nullptr, *_rw_port = nullptr, *_en_port = nullptr;
+    uint16_t _pins[4] = {};
+    uint16_t _rs = 0, _rw = 0, _en = 0;
+    double _busy_until = 0;
+    bool _low_half = false;         // the high nibble of a byte has been latched
+    uint8_t _high = 0;
+    bool _read_low = false;         // the next read drives the low nibble
+
+    void edge(bool rising);
+    void execute(uint8_t value, bool data);
+    void stepAddress(void);
+    int ddramIndex(uint8_t address) const;
+};
+
+// Simulated time in microseconds
+extern double sim_us;
+void sim_advance_us(double us);
+
+// Bytes written while the controller was busy, nibbles latched from input pins
+extern long sim_violations;
+
+// Reads of the DWT cycle counter
+extern long sim_cycle_reads;
+
+// Time of a GPIO access, plus a random part up to sim_gpio_jitter_us
+extern double sim_gpio_us;
+extern double sim_gpio_jitter_us;
+
+// Called as the clock advances, outside of itself, to model an interrupt. HAL functions
+// and cycle counter reads made while it runs are counted in sim_irq_hal_calls.
+extern void (*sim_irq_hook)(void);
+extern long sim_irq_hal_calls;
+
+// Called before GPIO reads, e.g. to drive key inputs
+extern void (*sim_read_hook)(GPIO_TypeDef* port);
+
+#endif // SIM_LCD_H
@@ -0,0 +1,163 @@
+/**
+ * @file test_anim.cpp
+ * @brief Animations keep CGRAM on the expected frame, send fewer bytes per frame than
+ *        createChar(), and leave the DDRAM address where printing left it.
+ */
+
+#include "test_common.hpp"
+#include "lcd_anim.hpp"
+#include <cstring>
+
+constexpr auto battery = lcdGlyphAnimation(
+    lcdCharmap(".###.", "#...#", "#...#", "#...#", "#...#", "#...#", "#####"),
+    lcdCharmap(".###.", "#...#", "#...#", "#...#", "#...#", "#####", "#####"),
+    lcdCharmap(".###.", "#...#", "#...#", "#...#", "#####", "#####", "#####"),
+    lcdCharmap(".###.", "#...#", "#...#", "#####", "#####", "#####", "#####"),
+    lcdCharmap(".###.", "#...#", "#####", "#####", "#####", "#####", "#####"),
+    lcdCharmap(".###.", "#####", "#####", "#####", "#####", "#####", "#####"));
+
+constexpr auto spinner = lcdGlyphAnimation(
+    lcdCharmap("..#..", "..#..", "..#..", "..#..", "..#..", ".....", "....."),
+    lcdCharmap(".....", "....#", "...#.", "..#..", ".#...", "#....", "....."),
+    lcdCharmap(".....", ".....", "#####", ".....", ".....", ".....", "....."),
+    lcdCharmap(".....", "#....", ".#...", "..#..", "...#.", "....#", "....."));
+
+constexpr auto bars = lcdGlyphAnimation(
+    lcdCharmap(".....", ".....", ".....", ".....", ".....", ".....", "#...."),
+    lcdCharmap(".....", ".....", ".....", ".....", ".....", ".#...", "##..."),
+    lcdCharmap(".....", ".....", ".....", ".....", "..#..", ".##..", "###.."),
+    lcdCharmap(".....", ".....", "...#.", "...#.", "..##.", ".###.", "####."),
+    lcdCharmap("....#", "....#", "...##", "...##", "..###", ".####", "#####"));
+
+static_assert(battery.changed[0] == 0x20 && battery.changed[5] == 0x3E, "row deltas");
+
+template <size_t F>
+static bool shows(const SimLCD& sim, int location, const LCDGlyphAnimation<F>& anim, int frame) {
+    return memcmp(&sim.cgram[8 * location], anim.rows[frame], 8) == 0;
+}
+
+static long busBytes(const SimLCD& sim) {
+    return sim.commands + sim.data_bytes;
+}
+
+// Runs one animation alone and returns its bytes per frame, checking CGRAM after each tick.
+template <size_t F>
+static double alone(const LCDGlyphAnimation<F>& anim) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    LCDAnimator animator(lcd);
+    CHECK(animator.add(0, anim, 100));
+    static const uint8_t code = 0;
+    lcd.writeCells(&code, 1);
+
+    long start = busBytes(sim);
+    int frame = 0;
+    for (int t = 0; t < 60; t++) {
+        sim_advance_us(100000);
+        CHECK(animator.tick() > 0);
+        frame = (frame + 1) % F;
+        CHECK(shows(sim, 0, anim, frame));
+    }
+    return (busBytes(sim) - start) / 60.0;
+}
+
+// Printing after a frame update continues at the DDRAM address it left off, past the end
+// of a row and with right to left text.
+static void address(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    LCDAnimator animator(lcd);
+    CHECK(animator.add(3, spinner, 100));
+
+    lcd.printLCD("0123456789ABCDEF");
+    sim_advance_us(100000);
+    CHECK(animator.tick() > 0);
+    lcd.printLCD("xy");
+    CHECK(sim.ddram[16] == 'x' && sim.ddram[17] == 'y');
+
+    lcd.rightToLeft();
+    lcd.setCursor(10, 1);
+    lcd.printLCD("ab");             // cells 10 and 9
+    sim_advance_us(100000);
+    CHECK(animator.tick() > 0);
+    lcd.printLCD("c");
+    CHECK(animator.show(3, 0));
+    lcd.printLCD("d");
+    CHECK(shows(sim, 3, spinner, 0));
+    CHECK(sim.row(1, 16, 2) == "       dcba     ");
+}
+
+int main() {
+    address();
+    double battery_bytes = alone(battery), spinner_bytes = alone(spinner), bars_bytes = alone(bars);
+    printf("bytes per frame: battery %.2f, spinner %.2f, bars %.2f\n", battery_bytes,
+           spinner_bytes, bars_bytes);
+
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+
+    // createChar() sends the address, 8 rows and the cursor restore for every frame
+    long start = busBytes(sim);
+    for (int t = 0; t < 60; t++) lcd.createChar(0, battery.rows[t % 6]);
+    double create_bytes = (busBytes(sim) - start) / 60.0;
+    printf("createChar() per frame: %.2f bytes\n", create_bytes);
+    CHECK(battery_bytes < create_bytes && spinner_bytes < create_bytes && bars_bytes < create_bytes);
+
+    // three animations at once, next to text that must stay in place
+    LCDAnimator animator(lcd);
+    CHECK(animator.add(0, battery, 100));
+    CHECK(animator.add(1, spinner, 100));
+    CHECK(animator.add(2, bars, 100));
+    static const uint8_t codes[3] = { 0, 1, 2 };
+    lcd.setCursor(0, 0);
+    lcd.writeCells(codes, 3);
+    lcd.printLCD(" ok");
+
+    start = busBytes(sim);
+    int fb = 0, fs = 0, fr = 0;
+    for (int t = 0; t < 60; t++) {
+        sim_advance_us(100000);
+        animator.tick();
+        fb = (fb + 1) % 6;
+        fs = (fs + 1) % 4;
+        fr = (fr + 1) % 5;
+        CHECK(shows(sim, 0, battery, fb) && shows(sim, 1, spinner, fs) && shows(sim, 2, bars, fr));
+    }
+    double together = (busBytes(sim) - start) / 180.0;
+    printf("three animations: %.2f bytes per glyph frame\n", together);
+    CHECK(together < create_bytes);
+
+    // falling behind skips to the current frame with one update instead of replaying the
+    // missed ones; the bus time of the ticks so far puts the schedule up to a period behind
+    sim_advance_us(350000);
+    start = busBytes(sim);
+    animator.tick();
+    CHECK(busBytes(sim) - start <= 3 * (1 + 8) + 1);
+    int skipped = -1;
+    for (int f = 0; f < 6; f++) {
+        if (shows(sim, 0, battery, f)) skipped = (f - fb + 6) % 6;
+    }
+    CHECK(skipped == 3 || skipped == 4);
+    fb = (fb + skipped) % 6;
+
+    CHECK(animator.pause(0, true));
+    sim_advance_us(500000);
+    animator.tick();
+    CHECK(shows(sim, 0, battery, fb));
+    CHECK(animator.show(0, 5));
+    CHECK(shows(sim, 0, battery, 5));
+
+    // the cursor is where the text left it
+    lcd.putch('X');
+    CHECK(sim.row(0, 16, 2) == std::string("\0\1\2 okX", 7) + std::string(9, ' '));
+    return testResult("test_anim");
+}
@@ -0,0 +1,162 @@
+/**
+ * @file test_async.cpp
+ * @brief The awaitable operations run on the simulated clock: a UI coroutine suspends at
+ *        every controller wait, leaving the time to other work, never writes to a busy
+ *        controller, and continues printing where it left off after createChar(). Frames
+ *        come from the static pool. Built with C++20.
+ */
+
+#include "test_common.hpp"
+#include "lcd_async.hpp"
+#include <cstring>
+
+#if defined(__cpp_impl_coroutine)
+
+static const uint8_t glyph[8] = { 0x0E, 0x1B, 0x11, 0x11, 0x11, 0x11, 0x1F, 0x00 };
+
+struct Ui {
+    bool begun = false, printed = false, defined = false;
+};
+
+static LCDTask ui(LCDAsync& lcd, Ui& state, bool right_to_left) {
+    state.begun = co_await lcd.begin(16, 2);
+    co_await lcd.setCursor(right_to_left ? 12 : 2, 1);
+    state.printed = co_await lcd.print("async");
+    co_await lcd.cursor();
+    state.defined = co_await lcd.createChar(6, glyph);
+    co_await lcd.print("\x06!");
+}
+
+static void wakeup(uint32_t delay_us, void* context) {
+    *static_cast<uint64_t*>(context) += delay_us;
+}
+
+// Polls like a main loop, doing 5 us of other work between polls.
+static double runLoop(LCDAsync& async, LCDTask& task, double& other_us, bool start_task = true) {
+    double start = sim_us;
+    if (start_task) task.start();
+    while (!task.done()) {
+        async.poll();
+        sim_advance_us(5);
+        other_us += 5;
+    }
+    return sim_us - start;
+}
+
+static void sequence(bool right_to_left) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    lcd.initCtrlPins(GPIO_PIN_2, GPIO_PIN_12, GPIO_PIN_3);
+    lcd.initDataPins(GPIO_PIN_8, GPIO_PIN_9, GPIO_PIN_10, GPIO_PIN_11);
+    LCDAsync async(lcd);
+    uint64_t announced_us = 0;
+    async.setWakeup(wakeup, &announced_us);
+
+    Ui state;
+    LCDTask task = ui(async, state, right_to_left);
+    CHECK(task.valid());
+    if (right_to_left) {
+        // the entry mode is set by begin(), so switch it on the first suspension
+        task.start();
+        CHECK(async.waiting());
+        while (!state.begun) {
+            async.poll();
+            sim_advance_us(5);
+        }
+        lcd.rightToLeft();
+    }
+    double other_us = 0;
+    double total_us = runLoop(async, task, other_us, !right_to_left);
+    CHECK(state.begun && state.printed && state.defined);
+    CHECK(!async.waiting());
+    CHECK(LCDTask::framesInUse() == 1);     // the awaited tasks are gone, ui() is kept until destroyed
+
+    CHECK(sim.four_bit && sim.lines == 2 && (sim.display_control & 0x06) == 0x06);
+    CHECK(memcmp(&sim.cgram[6 * 8], glyph, 8) == 0);
+    if (right_to_left) {
+        CHECK(sim.row(1, 16, 2).substr(6, 7) == "!\x06" "cnysa");
+    } else {
+        CHECK(sim.row(1, 16, 2).substr(2, 7) == "async\x06!");
+    }
+
+    // the waits were left to the other work, and announced to the wakeup hook
+    if (!right_to_left) {
+        CHECK(other_us > total_us * 0.9);
+        CHECK(announced_us > 60000);
+        printf("async sequence: %.1f ms, %.1f ms of it left to other work\n", total_us / 1000,
+               other_us / 1000);
+    }
+}
+
+static void profile(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    LCDAsync async(lcd);
+    LCD_Timing t;
+
+    // without a profile, begin() installs the worst case, and it stays
+    double other_us = 0;
+    LCDTask first = async.begin(16, 2);
+    runLoop(async, first, other_us);
+    lcd.getTiming(&t);
+    CHECK(t.valid && t.command_us == LCD_ASYNC_COMMAND_US && t.clear_us == LCD_ASYNC_CLEAR_US);
+
+    // a measured profile is kept
+    CHECK(lcd.calibrate());
+    LCD_Timing measured;
+    lcd.getTiming(&measured);
+    LCDTask second = async.begin(16, 2);
+    runLoop(async, second, other_us);
+    lcd.getTiming(&t);
+    CHECK(t.command_us == measured.command_us && t.clear_us == measured.clear_us);
+
+    // and the default delays can be restored
+    LCD_Timing none = {};
+    lcd.setTiming(&none);
+    lcd.getTiming(&t);
+    CHECK(!t.valid);
+    lcd.printLCD("sync");
+    CHECK(sim.row(0, 16, 2).substr(0, 4) == "sync");
+}
+
+static void pool(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    LCDAsync async(lcd);
+    {
+        LCDTask tasks[LCD_ASYNC_FRAMES + 1] = {
+#if LCD_ASYNC_FRAMES == 4
+            async.print("a"), async.print("b"), async.print("c"), async.print("d"), async.print("e")
+#else
+#error "pool() expects LCD_ASYNC_FRAMES 4"
+#endif
+        };
+        CHECK(LCDTask::framesInUse() == LCD_ASYNC_FRAMES);
+        for (int i = 0; i < LCD_ASYNC_FRAMES; i++) CHECK(tasks[i].valid());
+        CHECK(!tasks[LCD_ASYNC_FRAMES].valid() && !tasks[LCD_ASYNC_FRAMES].start());
+    }
+    CHECK(LCDTask::framesInUse() == 0);
+    CHECK(LCDTask::largestFrame() <= LCD_ASYNC_FRAME_SIZE);
+}
+
+int main() {
+    sequence(false);
+    sequence(true);
+    profile();
+    pool();
+    return testResult("test_async");
+}
+
+#else
+
+int main() {
+    printf("test_async: skipped, no coroutine support\n");
+    return 0;
+}
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,208 @@
+/**
+ * @file test_budget.cpp
+ * @brief Randomized budgeted printing: no call overruns its budget or byte limit, every
+ *        text completes, and the screen matches what printRows() would show.
+ */
+
+#include "test_common.hpp"
+#include "lcd_budget.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#define ROWS 4
+#define MAX_COLS 40
+
+// Software model of the screen, stepped to where each call left the text
+struct Model {
+    char screen[ROWS][MAX_COLS];
+    int cols;
+
+    void clear(void) { memset(screen, ' ', sizeof(screen)); }
+
+    std::string text(void) const {
+        std::string s;
+        for (int y = 0; y < ROWS; y++) s += std::string(screen[y], cols) + '\n';
+        return s;
+    }
+};
+
+struct Reference {
+    const char* text;
+    size_t len;
+    int col, row, mode;
+
+    // Writes the next character like printRows()
+    void step(Model& m) {
+        if (col >= m.cols) {
+            if (mode != LCD_PRINT_WRAP || row + 1 >= ROWS) {
+                len = 0;
+                return;
+            }
+            col = 0;
+            row++;
+        }
+        if (mode == LCD_PRINT_ELLIPSIS && col + 1 == m.cols && len > 1) {
+            m.screen[row][col++] = (char)LCD_ELLIPSIS_CHAR;
+            len = 0;
+            return;
+        }
+        m.screen[row][col++] = *text++;
+        len--;
+    }
+
+    void follow(Model& m, const LCDContinuation& next) {
+        while (len > next.len) step(m);
+    }
+};
+
+static long calls = 0, over_budget = 0, over_bytes = 0, stalls = 0;
+static double worst_ratio = 0;
+
+// Bytes on the bus: a command sent to both controllers at once executes on both at the
+// same simulated time and is counted once
+static long bus_bytes = 0;
+static double last_execute = -1;
+
+static void countByte(SimLCD&, uint8_t, bool, void*) {
+    if (sim_us != last_execute) bus_bytes++;
+    last_execute = sim_us;
+}
+
+// A sleep strategy and a busy hook that overrun any budget if they were used inside one
+static long hook_calls = 0, sleep_calls = 0, hooked_calls = 0;
+
+static void slowHook(uint32_t, void*) {
+    hook_calls++;
+    sim_advance_us(200);
+}
+
+static uint32_t slowSleep(uint32_t, void*) {
+    sleep_calls++;
+    sim_advance_us(500);
+    return 500;
+}
+
+// Times one call and checks its budget and byte limit
+template <typename Call>
+static LCDContinuation checked(uint32_t budget, uint16_t max_bytes, Call call) {
+    long bytes = bus_bytes, hooks = hook_calls + sleep_calls;
+    double start = sim_us;
+    LCDContinuation next = call();
+    double took = sim_us - start;
+    calls++;
+    if (hook_calls + sleep_calls != hooks) hooked_calls++;
+    if (took > budget) {
+        if (!over_budget) printf("call took %.2f us of a %u us budget\n", took, (unsigned)budget);
+        over_budget++;
+    }
+    if (max_bytes && bus_bytes - bytes > max_bytes) over_bytes++;
+    if (took / budget > worst_ratio) worst_ratio = took / budget;
+    return next;
+}
+
+static void run(int cols, unsigned seed, double jitter_us, bool hooks) {
+    srand(seed);
+    sim_gpio_jitter_us = jitter_us;
+    calls = over_budget = over_bytes = stalls = hooked_calls = 0;
+    worst_ratio = 0;
+
+    SimLCD sims[2];
+    int count = (cols > 20) ? 2 : 1;
+    sims[0].wireDefault(GPIO_PIN_12);
+    if (count > 1) sims[1].wireDefault(GPIO_PIN_7);
+    for (int i = 0; i < count; i++) sims[i].on_execute = countByte;
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    if (count > 1) lcd.initSecondEnable(GPIOC, GPIO_PIN_7);
+    beginLcd(lcd, cols, ROWS);
+    CHECK(lcd.calibrate());
+    if (hooks) {
+        lcd.setBusyHook(slowHook, nullptr);
+        lcd.setWaitStrategy(slowSleep, nullptr, 1);
+    }
+
+    LCDBudget budget(lcd);
+    Model model;
+    model.cols = cols;
+    model.clear();
+    lcd.clear();
+    auto shown = [&]() {
+        return (count > 1) ? sims[0].screen(cols, 2) + sims[1].screen(cols, 2) : sims[0].screen(cols, ROWS);
+    };
+
+    char texts[2][72];
+    bool same = true;
+    for (int it = 0; it < 1500; it++) {
+        char* text = texts[it & 1];
+        int len = 1 + rand() % 70;
+        for (int i = 0; i < len; i++) text[i] = (char)(' ' + rand() % 94);
+        text[len] = 0;
+        int mode = rand() % 3, x = rand() % cols, y = rand() % ROWS;
+        if (rand() % 10 == 0) {
+            if (rand() % 2) lcd.cursor();
+            else lcd.noCursor();
+        }
+        if (rand() % 8 == 0) {
+            lcd.clear();
+            model.clear();
+        }
+        lcd.setCursor(x, y);
+        Reference ref = { text, (size_t)len, x, y, mode };
+
+        uint32_t b = budget.minBudget() + rand() % 300;
+        uint16_t max_bytes = (rand() % 3 == 0) ? 3 + rand() % 7 : 0;
+        LCDContinuation next = checked(b, max_bytes, [&] { return budget.print(text, b, max_bytes, mode); });
+        ref.follow(model, next);
+
+        int loops = 0;
+        while (!next.done()) {
+            // other code uses the display between two calls now and then
+            if (rand() % 5 == 0) {
+                int ox = rand() % cols, oy = rand() % ROWS;
+                char c = 'A' + rand() % 26;
+                lcd.setCursor(ox, oy);
+                lcd.putch(c);
+                model.screen[oy][ox] = c;
+            }
+            sim_advance_us(rand() % 150);       // the control loop runs
+
+            b = budget.minBudget() + rand() % 300;
+            max_bytes = (rand() % 3 == 0) ? 3 + rand() % 7 : 0;
+            size_t before = next.len;
+            next = checked(b, max_bytes, [&] { return budget.resume(next, b, max_bytes); });
+            ref.follow(model, next);
+            if (next.len == before) stalls++;
+            if (++loops > 10000) {
+                printf("text %d does not complete\n", it);
+                CHECK(false);
+                return;
+            }
+        }
+        same = same && shown() == model.text();
+    }
+    CHECK(same);
+    CHECK(over_budget == 0);
+    CHECK(over_bytes == 0);
+    if (hooks) {
+        // not called within a budget, and still in place afterwards
+        CHECK(hooked_calls == 0);
+        long before = hook_calls + sleep_calls;
+        lcd.clear();
+        lcd.printLCD("hooks");
+        CHECK(hook_calls + sleep_calls > before);
+    }
+    printf("%dx%d seed %u jitter %.2f us%s: %ld calls, %ld over budget, %ld over byte limit, "
+           "worst %.1f%% of budget, %ld without progress\n",
+           cols, ROWS, seed, jitter_us, hooks ? " hooks" : "", calls, over_budget, over_bytes,
+           worst_ratio * 100, stalls);
+    sim_gpio_jitter_us = 0;
+}
+
+int main() {
+    run(20, 1, 0, false);
+    run(20, 2, 0.5, false);
+    run(40, 3, 0, false);       // two controllers
+    run(40, 4, 0.5, false);
+    run(20, 5, 0.2, true);      // busy hook and sleep strategy set
+    run(40, 6, 0.2, true);
+    return testResult("test_budget");
+}
@@ -0,0 +1,56 @@
+/**
+ * @file test_calibrate.cpp
+ * @brief Calibration measures the execution times of fast, typical and slow panels, and
+ *        the calibrated profile never writes to a busy controller.
+ */
+
+#include "test_common.hpp"
+
+static void run(double command_us, double data_us, double clear_us) {
+    SimLCD sim;
+    sim.wireDefault();
+    sim.command_us = command_us;
+    sim.data_us = data_us;
+    sim.clear_us = clear_us;
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+
+    double start = sim_us;
+    lcd.printLCD("uncalibrated");
+    double uncalibrated_us = sim_us - start;
+
+    CHECK(lcd.calibrate());
+    LCD_Timing t;
+    lcd.getTiming(&t);
+    CHECK(t.valid);
+    // at least the real time, at most the default 25 % margin on top of it plus the
+    // address update time and the polling granularity
+    CHECK(t.command_us >= command_us && t.command_us <= (command_us + 20) * 1.25 + 1);
+    CHECK(t.data_us >= data_us && t.data_us <= (data_us + 20) * 1.25 + 1);
+    CHECK(t.clear_us >= clear_us && t.clear_us <= (clear_us + 20) * 1.25 + 1);
+
+    start = sim_us;
+    lcd.clear();
+    lcd.printLCD("uncalibrated");
+    double calibrated_us = sim_us - start - t.clear_us;
+    CHECK(sim.row(0, 20, 4) == "uncalibrated        ");
+    CHECK(calibrated_us * 10 < uncalibrated_us);
+
+    // a stored profile skips the calibration on the next start
+    LCD restarted(GPIOC, GPIOD, GPIOC, GPIOF);
+    restarted.setTiming(&t);
+    beginLcd(restarted, 20, 4);
+    restarted.printLCD("stored profile");
+    CHECK(sim.row(0, 20, 4) == "stored profile      ");
+
+    printf("panel %.0f/%.0f/%.0f us: measured %u/%u/%u us, 12 chars %.0f us instead of %.0f us\n",
+           command_us, data_us, clear_us, t.command_us, t.data_us, t.clear_us, calibrated_us,
+           uncalibrated_us);
+}
+
+int main() {
+    run(20, 25, 800);       // fast controller
+    run(37, 41, 1520);      // data sheet values
+    run(80, 100, 3000);     // slow controller, low supply or cold
+    return testResult("test_calibrate");
+}
@@ -0,0 +1,177 @@
+/**
+ * @file test_charset.cpp
+ * @brief UTF-8 decoding, character ROM translation, glyph slots, and the characters per
+ *        second of the translation and of printing.
+ */
+
+#include "test_common.hpp"
+#include "lcd_charset.hpp"
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static std::vector<uint32_t> decode(const char* bytes, size_t len) {
+    LCDUtf8Decoder decoder;
+    std::vector<uint32_t> out;
+    uint32_t cp;
+    for (size_t i = 0; i < len; i++) {
+        if (decoder.feed((uint8_t)bytes[i], cp)) out.push_back(cp);
+    }
+    return out;
+}
+
+#define DECODES(bytes, ...) CHECK(decode(bytes, sizeof(bytes) - 1) == std::vector<uint32_t>({ __VA_ARGS__ }))
+
+static void decoder(void) {
+    DECODES("A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", 'A', 0xE9, 0x20AC, 0x1F600);
+
+    // overlong forms, surrogates and code points past U+10FFFF
+    DECODES("\xC0\x80", 0xFFFD, 0xFFFD);
+    DECODES("\xC1\xBF", 0xFFFD, 0xFFFD);
+    DECODES("\xE0\x80\x80", 0xFFFD);
+    DECODES("\xE0\x9F\xBF", 0xFFFD);
+    DECODES("\xF0\x8F\xBF\xBF", 0xFFFD);
+    DECODES("\xED\xA0\x80", 0xFFFD);
+    DECODES("\xF4\x90\x80\x80", 0xFFFD);
+    DECODES("\xF5\x80", 0xFFFD, 0xFFFD);
+    DECODES("\xFF", 0xFFFD);
+
+    // stray continuation bytes, and sequences cut short by ASCII or a new lead byte
+    DECODES("\x80x", 0xFFFD, 'x');
+    DECODES("\xE2\x82x", 'x');
+    DECODES("\xE2\xC3\xA9", 0xE9);
+    DECODES("\xF0\x9F\x98", );
+
+    // a sequence split between two calls
+    LCDUtf8Decoder split;
+    uint32_t cp = 0;
+    CHECK(!split.feed(0xE2, cp) && !split.feed(0x82, cp));
+    CHECK(split.feed(0xAC, cp) && cp == 0x20AC);
+}
+
+static void rom(void) {
+    CHECK(LCDText::lookup(LCD_ROM_A00, 'A') == 'A');
+    CHECK(LCDText::lookup(LCD_ROM_A00, '\\') == 0);
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0xA5) == 0x5C);          // ¥
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0xB0) == 0xDF);          // °
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x03C0) == 0xF7);        // π
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x2192) == 0x7E);        // →
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x00E9) == 0);           // é is not in A00
+    CHECK(LCDText::lookup(LCD_ROM_A02, 0x00E9) == 0xE9);
+    CHECK(LCDText::lookup(LCD_ROM_A02, '\\') == '\\');
+    CHECK(LCDText::lookup(LCD_ROM_A02, 0x30AB) == 0);
+
+    // katakana: base forms, voiced forms followed by their mark, hiragana and half width
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30AB) == 0xB6);                  // カ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30AC) == (0xB6 | 0xDE << 8));    // ガ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30C5) == (0xC2 | 0xDE << 8));    // ヅ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30D0) == (0xCA | 0xDE << 8));    // バ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30D1) == (0xCA | 0xDF << 8));    // パ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30DD) == (0xCE | 0xDF << 8));    // ポ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30F4) == (0xB3 | 0xDE << 8));    // ヴ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x30C3) == 0xAF);                  // ッ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0x304C) == (0xB6 | 0xDE << 8));    // が
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0xFF76) == 0xB6);                  // ｶ
+    CHECK(LCDText::lookup(LCD_ROM_A00, 0xFF9E) == 0xDE);                  // ﾞ
+
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    LCDText text(lcd);
+    uint8_t out[16];
+    size_t n = text.translate("\xE3\x83\x91\xE3\x83\xB3", out, sizeof(out));      // パン
+    CHECK(n == 3 && out[0] == 0xCA && out[1] == 0xDF && out[2] == 0xDD);
+    n = text.translate("\xE3\x83\x91", out, 1);     // the mark does not fit, nor the base
+    CHECK(n == 0);
+    n = text.translate("a\\\xC0\x80", out, sizeof(out));
+    CHECK(n == 4 && !memcmp(out, "a???", 4));
+}
+
+static const LCDGlyph glyphs[] = {
+    { 0x00E9, { 0x02, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },   // é
+    { 0x00E8, { 0x08, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },   // è
+    { 0x00E0, { 0x08, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 } },   // à
+    { 0x00F8, { 0x00, 0x01, 0x0E, 0x13, 0x15, 0x19, 0x0E, 0x10 } },   // ø
+};
+
+static void glyphSlots(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    LCDText text(lcd);
+    text.setGlyphs(glyphs, 4, 6);       // slots 6 and 7
+
+    // a glyph is loaded on first use, a code point without one is replaced
+    lcd.setCursor(0, 0);
+    CHECK(text.print("caf\xC3\xA9 \xE2\x98\x83") == 6);
+    CHECK(sim.row(0, 16, 2).substr(0, 6) == std::string("caf\x06 ?"));
+    CHECK(!memcmp(&sim.cgram[6 * 8], glyphs[0].rows, 8));
+    long data = sim.data_bytes;
+    CHECK(text.print("\xC3\xA9") == 1);
+    CHECK(sim.data_bytes - data == 1);  // already loaded
+
+    // the least recently printed glyph is replaced: é was printed after è was loaded
+    text.print("\xC3\xA8");             // è into slot 7
+    text.print("\xC3\xA9");             // é used again
+    text.print("\xC3\xA0");             // à replaces è, not é
+    CHECK(!memcmp(&sim.cgram[6 * 8], glyphs[0].rows, 8));
+    CHECK(!memcmp(&sim.cgram[7 * 8], glyphs[2].rows, 8));
+
+    // one print using more glyphs than slots keeps the glyphs of its own cells: the
+    // buffered é is not remapped to ø
+    lcd.setCursor(0, 1);
+    CHECK(text.print("\xC3\xA9\xC3\xA8\xC3\xB8") == 3);
+    CHECK(sim.row(1, 16, 2).substr(0, 3) == std::string("\x06\x07?"));
+    CHECK(!memcmp(&sim.cgram[6 * 8], glyphs[0].rows, 8));
+    CHECK(!memcmp(&sim.cgram[7 * 8], glyphs[1].rows, 8));
+
+    // translate() uses loaded glyphs only
+    uint8_t out[4];
+    CHECK(text.translate("\xC3\xA8\xC3\xB8", out, sizeof(out)) == 2 && out[0] == 7 && out[1] == '?');
+}
+
+static void benchmark(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    LCDText text(lcd);
+    text.setGlyphs(glyphs, 4);
+
+    // mixed text: ASCII, Latin-1, Greek, voiced katakana and a glyph
+    const char* sample = "T=21.5\xC2\xB0" "C \xCE\xA9 \xE3\x82\xAC\xE3\x82\xB9 caf\xC3\xA9 ";
+    size_t chars = 0;
+    for (const uint8_t* p = (const uint8_t*)sample; *p; p++) chars += (*p & 0xC0) != 0x80;
+
+    uint8_t out[64];
+    const int rounds = 200000;
+    size_t cells = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) cells += text.translate(sample, out, sizeof(out));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CHECK(cells == (size_t)rounds * (chars + 1));      // ガ takes two cells
+
+    // printing is bound by the bus: characters per second of simulated time
+    double t0 = sim_us;
+    for (int i = 0; i < 20; i++) {
+        lcd.setCursor(0, 0);
+        text.print(sample);
+    }
+    double printed = 20.0 * chars / ((sim_us - t0) / 1e6);
+    printf("translate: %.1f M characters/s on the host, print: %.0f characters/s on a calibrated panel\n",
+           rounds * chars / seconds / 1e6, printed);
+    CHECK(printed > 1000);
+}
+
+int main() {
+    decoder();
+    rom();
+    glyphSlots();
+    benchmark();
+    return testResult("test_charset");
+}
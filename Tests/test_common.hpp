@@ -0,0 +1,45 @@
+/**
+ * @file test_common.hpp
+ * @brief Checks and setup shared by the host tests.
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include "lcd.hpp"
+#include "sim_lcd.hpp"
+#include <cstdio>
+
+static int test_failures = 0;
+
+// Records a failed condition and goes on, so one run shows all failures.
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);           \
+            test_failures++;                                                          \
+        }                                                                             \
+    } while (0)
+
+/**
+ * @brief Initializes a display wired like SimLCD::wireDefault().
+ */
+static inline void beginLcd(LCD& lcd, int cols, int rows) {
+    lcd.initCtrlPins(GPIO_PIN_2, GPIO_PIN_12, GPIO_PIN_3);
+    lcd.initDataPins(GPIO_PIN_8, GPIO_PIN_9, GPIO_PIN_10, GPIO_PIN_11);
+    lcd.Begin(cols, rows);
+}
+
+/**
+ * @brief Prints the result of a test and returns its exit code.
+ */
+static inline int testResult(const char* name) {
+    if (sim_violations) {
+        printf("%s: %ld bus timing violations\n", name, sim_violations);
+        test_failures++;
+    }
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "passed");
+    return test_failures ? 1 : 0;
+}
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,113 @@
+/**
+ * @file test_console.cpp
+ * @brief Control characters, the bytes a scroll sends, a console created before Begin(),
+ *        and every row of a 40x4 panel with two controllers.
+ */
+
+#include "test_common.hpp"
+#include "lcd_console.hpp"
+
+static long busBytes(const SimLCD& sim) {
+    return sim.commands + sim.data_bytes;
+}
+
+static std::string rows(const char* r0, const char* r1 = "", const char* r2 = "", const char* r3 = "") {
+    std::string s;
+    for (const char* r : { r0, r1, r2, r3 }) {
+        std::string row(r);
+        row.resize(20, ' ');
+        s += row + '\n';
+    }
+    return s;
+}
+
+static void expectScreen(const SimLCD& sim, const std::string& expected) {
+    std::string shown = sim.screen(20, 4);
+    CHECK(shown == expected);
+    if (shown != expected) printf("%s", shown.c_str());
+}
+
+static void controls(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    CHECK(lcd.calibrate());
+    LCDConsole console(lcd);
+
+    console.print("abc\rX");
+    expectScreen(sim, rows("Xbc"));
+    console.print("\fa\tb\tc");
+    expectScreen(sim, rows("a   b   c"));
+    console.print("\fabc\bX\b\b\bY");
+    expectScreen(sim, rows("YbX"));
+    console.print("\fone\ntwo\n\nfour");
+    expectScreen(sim, rows("one", "two", "", "four"));
+
+    // the last column is written without wrapping, \b goes back into it, and the next
+    // character wraps
+    console.print("\f0123456789ABCDEFGHIJ\bZ");
+    expectScreen(sim, rows("0123456789ABCDEFGHIZ"));
+    console.print("k");
+    expectScreen(sim, rows("0123456789ABCDEFGHIZ", "k"));
+    console.print("\r\t\t\t\t\tx");   // the last tab stop is the end of the row
+    expectScreen(sim, rows("0123456789ABCDEFGHIZ", "                    ", "x"));
+
+    // scrolling sends only the cells that differ: the digit of each row
+    console.print("\fline 1\nline 2\nline 3\nline 4");
+    expectScreen(sim, rows("line 1", "line 2", "line 3", "line 4"));
+    long before = busBytes(sim);
+    console.print("\nline 5");
+    expectScreen(sim, rows("line 2", "line 3", "line 4", "line 5"));
+    CHECK(busBytes(sim) - before == 4 * (1 + 1));
+
+    // clearing sends the cells that are not blank, one run per row
+    before = busBytes(sim);
+    console.clear();
+    expectScreen(sim, rows(""));
+    CHECK(busBytes(sim) - before == 4 * (1 + 6));
+}
+
+static void beforeBegin(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    LCDConsole console(lcd);
+    console.print("lost\n");        // no geometry yet, nothing is sent
+
+    beginLcd(lcd, 20, 4);
+    console.print("hello\nworld");
+    expectScreen(sim, rows("hello", "world"));
+}
+
+static void wide(void) {
+    SimLCD top, bottom;
+    top.wireDefault(GPIO_PIN_12);
+    bottom.wireDefault(GPIO_PIN_7);
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    lcd.initSecondEnable(GPIOC, GPIO_PIN_7);
+    beginLcd(lcd, 40, 4);
+
+    LCDConsole console(lcd);
+    for (int i = 0; i < 6; i++) {
+        console.printFormatted("%sline %d", i ? "\n" : "", i);
+    }
+    console.flush();
+
+    std::string shown = top.screen(40, 2) + bottom.screen(40, 2);
+    std::string expected;
+    for (int i = 2; i < 6; i++) {
+        char line[41];
+        snprintf(line, sizeof(line), "line %-35d", i);
+        expected += std::string(line) + '\n';
+    }
+    CHECK(shown == expected);
+    if (shown != expected) printf("%s", shown.c_str());
+}
+
+int main() {
+    controls();
+    beforeBegin();
+    wide();
+    return testResult("test_console");
+}
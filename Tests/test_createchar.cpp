@@ -0,0 +1,69 @@
+/**
+ * @file test_createchar.cpp
+ * @brief Printing after createChar() and createChars() continues at the DDRAM address it
+ *        left off, also past the end of a row and with right to left text.
+ */
+
+#include "test_common.hpp"
+#include <cstring>
+
+static const uint8_t glyph[8] = { 0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F };
+static const uint8_t other[8] = { 0x04, 0x0E, 0x1F, 0x0E, 0x04, 0x00, 0x00, 0x00 };
+static const uint8_t both[16] = { 0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F,
+                                  0x04, 0x0E, 0x1F, 0x0E, 0x04, 0x00, 0x00, 0x00 };
+
+static void define(LCD& lcd, bool several, uint8_t location) {
+    if (several) lcd.createChars(location, both, 2);
+    else lcd.createChar(location, glyph);
+}
+
+static void begin(SimLCD& sim, LCD& lcd) {
+    sim.wireDefault();
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+}
+
+static void pastRowEnd(bool several) {
+    SimLCD sim;
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    begin(sim, lcd);
+
+    lcd.createChar(3, other);
+    lcd.printLCD("0123456789ABCDEF");
+    define(lcd, several, 1);
+    lcd.printLCD("xy");
+
+    CHECK(memcmp(&sim.cgram[8], glyph, 8) == 0);
+    if (several) CHECK(memcmp(&sim.cgram[16], other, 8) == 0);
+    CHECK(memcmp(&sim.cgram[24], other, 8) == 0);   // not overwritten by "xy"
+    CHECK(!sim.ac_cgram);
+    CHECK(sim.ddram[16] == 'x' && sim.ddram[17] == 'y');
+    CHECK(sim.row(0, 16, 2) == "0123456789ABCDEF");
+}
+
+static void rightToLeft(bool shift, bool several) {
+    SimLCD sim;
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    begin(sim, lcd);
+
+    lcd.rightToLeft();
+    if (shift) lcd.autoscroll();
+    lcd.setCursor(10, 1);
+    lcd.printLCD("ab");             // cells 10 and 9
+    define(lcd, several, 0);
+    lcd.printLCD("c");              // cell 8
+
+    CHECK(memcmp(&sim.cgram[0], glyph, 8) == 0);
+    if (several) CHECK(memcmp(&sim.cgram[8], other, 8) == 0);
+    CHECK(sim.ddram[40 + 8] == 'c' && sim.ddram[40 + 9] == 'b' && sim.ddram[40 + 10] == 'a');
+    CHECK(sim.ddram[40 + 12] == ' ');
+}
+
+int main() {
+    for (bool several : { false, true }) {
+        pastRowEnd(several);
+        rightToLeft(false, several);
+        rightToLeft(true, several);
+    }
+    return testResult("test_createchar");
+}
@@ -0,0 +1,106 @@
+/**
+ * @file test_dual.cpp
+ * @brief A 40x4 panel with two controllers: rows 2 and 3 go to the second one, the
+ *        cursor moves between them, glyphs reach both CGRAMs, and an interleaved
+ *        writeFrame() takes less bus time than writing the rows one after the other.
+ */
+
+#include "test_common.hpp"
+#include <cstring>
+#include <string>
+
+static const uint8_t glyph[8] = { 0x1F, 0x15, 0x1F, 0x15, 0x1F, 0x15, 0x1F, 0x00 };
+
+static std::string shown(const SimLCD& top, const SimLCD& bottom) {
+    return top.screen(40, 2) + bottom.screen(40, 2);
+}
+
+static std::string frame(char first) {
+    std::string cells;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 40; x++) cells += (char)(first + (x + 7 * y) % 26);
+    }
+    return cells;
+}
+
+static std::string lines(const std::string& cells) {
+    std::string s;
+    for (int y = 0; y < 4; y++) s += cells.substr(y * 40, 40) + '\n';
+    return s;
+}
+
+static void routing(void) {
+    SimLCD top, bottom;
+    top.wireDefault(GPIO_PIN_12);
+    bottom.wireDefault(GPIO_PIN_7);
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    lcd.initSecondEnable(GPIOC, GPIO_PIN_7);
+    beginLcd(lcd, 40, 4);
+    CHECK(top.four_bit && bottom.four_bit && top.lines == 2 && bottom.lines == 2);
+
+    // rows 0 and 1 on the first controller, rows 2 and 3 on the second
+    for (int y = 0; y < 4; y++) {
+        lcd.setCursor(y, y);
+        lcd.printFormatted("row %d", y);
+    }
+    CHECK(top.row(0, 40, 2).substr(0, 6) == "row 0 " && top.row(1, 40, 2).substr(0, 6) == " row 1");
+    CHECK(bottom.row(0, 40, 2).substr(0, 7) == "  row 2" && bottom.row(1, 40, 2).substr(0, 8) == "   row 3");
+    CHECK(top.ac == 0x40 + 6 && bottom.ac == 0x40 + 8);
+
+    // the cursor is shown by the controller holding it, only
+    lcd.cursor();
+    CHECK((bottom.display_control & 0x02) && !(top.display_control & 0x02));
+    lcd.setCursor(10, 1);
+    CHECK((top.display_control & 0x02) && !(bottom.display_control & 0x02));
+    CHECK(top.ac == 0x40 + 10);
+    lcd.setCursor(39, 2);
+    CHECK((bottom.display_control & 0x02) && !(top.display_control & 0x02));
+    CHECK(bottom.ac == 39);
+    CHECK((top.display_control & 0x04) && (bottom.display_control & 0x04));
+
+    // a glyph is defined in both controllers, and printing goes on where it left off
+    lcd.createChar(4, glyph);
+    CHECK(memcmp(&top.cgram[4 * 8], glyph, 8) == 0);
+    CHECK(memcmp(&bottom.cgram[4 * 8], glyph, 8) == 0);
+    lcd.printLCD("\x04");
+    CHECK(bottom.ddram[39] == 4);
+    lcd.setCursor(0, 0);
+    lcd.printLCD("\x04");
+    CHECK(top.ddram[0] == 4);
+    CHECK((top.display_control & 0x02) && !(bottom.display_control & 0x02));
+}
+
+static void interleaved(void) {
+    SimLCD top, bottom;
+    top.wireDefault(GPIO_PIN_12);
+    bottom.wireDefault(GPIO_PIN_7);
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    lcd.initSecondEnable(GPIOC, GPIO_PIN_7);
+    beginLcd(lcd, 40, 4);
+    CHECK(lcd.calibrate());
+
+    std::string a = frame('A'), b = frame('a');
+    double start = sim_us;
+    CHECK(lcd.writeFrame((const uint8_t*)a.data()) == 160);
+    double frame_us = sim_us - start;
+    CHECK(shown(top, bottom) == lines(a));
+
+    start = sim_us;
+    for (int y = 0; y < 4; y++) {
+        lcd.setCursor(0, y);
+        lcd.printLCD(b.substr(y * 40, 40));
+    }
+    double rows_us = sim_us - start;
+    CHECK(shown(top, bottom) == lines(b));
+
+    // each controller executes while the other is written
+    CHECK(frame_us * 1.5 < rows_us);
+    printf("40x4 frame: %.1f ms interleaved, %.1f ms row by row (%.2fx)\n", frame_us / 1000,
+           rows_us / 1000, rows_us / frame_us);
+}
+
+int main() {
+    routing();
+    interleaved();
+    return testResult("test_dual");
+}
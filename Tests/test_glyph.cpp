@@ -0,0 +1,61 @@
+/**
+ * @file test_glyph.cpp
+ * @brief Glyph sets upload merged patterns to CGRAM, and sets built at run time link and
+ *        stay within CGRAM.
+ */
+
+#include "test_common.hpp"
+#include "lcd_glyph.hpp"
+#include <cstring>
+
+constexpr LCDCharmap bell = lcdCharmap(
+    "..#..",
+    ".###.",
+    ".###.",
+    ".###.",
+    "#####",
+    ".....",
+    "..#..");
+
+enum { GLYPH_BELL, GLYPH_HEART, GLYPH_ALARM };
+constexpr auto icons = lcdGlyphSet(
+    bell,
+    lcdCharmap(".....", ".#.#.", "#####", "#####", ".###.", "..#..", "....."),
+    bell);
+
+static_assert(icons.count == 2, "identical glyphs share a pattern");
+static_assert(icons.code(GLYPH_ALARM, 1) == 1 && icons.code(GLYPH_HEART, 1) == 2, "locations");
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+
+    long bytes = sim.data_bytes + sim.commands;
+    icons.upload(lcd, 1);
+    CHECK(memcmp(&sim.cgram[8], icons.rows, 16) == 0);
+    CHECK(sim.cgram[8] == 0x04 && sim.cgram[12] == 0x1F);
+    // one CGRAM address, 16 pattern bytes and the cursor restore
+    CHECK(sim.data_bytes + sim.commands - bytes <= 1 + 16 + 1);
+
+    lcd.putch(icons.code(GLYPH_HEART, 1));
+    CHECK(sim.row(0, 16, 2)[0] == 2);
+
+    // at run time, bad pixels stay dark and patterns past the 8th share its location
+    volatile char lit = '#';
+    char row[6] = { (char)lit, 'x', '.', '.', '#', 0 };
+    LCDCharmap odd = lcdCharmap(row, row, row, row, row, row, row);
+    CHECK(odd.rows[0] == 0x11);
+
+    LCDCharmap maps[10];
+    for (int i = 0; i < 10; i++) {
+        maps[i] = {};
+        maps[i].rows[0] = (uint8_t)(i + 1);
+    }
+    auto many = lcdGlyphSet(maps[0], maps[1], maps[2], maps[3], maps[4], maps[5], maps[6],
+                            maps[7], maps[8], maps[9]);
+    CHECK(many.count == 8);
+    CHECK(many.slot[7] == 7 && many.slot[8] == 7 && many.slot[9] == 7);
+    return testResult("test_glyph");
+}
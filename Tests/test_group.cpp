@@ -0,0 +1,72 @@
+/**
+ * @file test_group.cpp
+ * @brief A group writes different frames to several displays at once, and rejects
+ *        displays that share an enable line.
+ */
+
+#include "test_common.hpp"
+#include "lcd_group.hpp"
+#include <cstring>
+
+static void wireDisplay(SimLCD& sim, LCD& lcd, int k) {
+    uint16_t pins[4];
+    for (int i = 0; i < 4; i++) pins[i] = 1u << (4 * k + i);
+    sim.wire(GPIOC, pins, GPIOF, GPIO_PIN_3, GPIOD, GPIO_PIN_2, GPIOB, 1u << k);
+    lcd.initCtrlPins(GPIO_PIN_2, 1u << k, GPIO_PIN_3);
+    lcd.initDataPins(pins[0], pins[1], pins[2], pins[3]);
+    lcd.Begin(16, 2);
+    CHECK(lcd.calibrate());
+}
+
+int main() {
+    SimLCD sims[3];
+    LCD a(GPIOC, GPIOD, GPIOB, GPIOF), b(GPIOC, GPIOD, GPIOB, GPIOF), c(GPIOC, GPIOD, GPIOB, GPIOF);
+    LCD* displays[3] = { &a, &b, &c };
+
+    // a display on the enable line of the first one, started before it
+    LCD shared(GPIOC, GPIOD, GPIOB, GPIOF);
+    shared.initCtrlPins(GPIO_PIN_2, GPIO_PIN_0, GPIO_PIN_3);
+    shared.initDataPins(GPIO_PIN_12, GPIO_PIN_13, GPIO_PIN_14, GPIO_PIN_15);
+    shared.Begin(16, 2);
+
+    for (int k = 0; k < 3; k++) wireDisplay(sims[k], *displays[k], k);
+
+    uint8_t frames[3][32];
+    for (int k = 0; k < 3; k++) {
+        for (int i = 0; i < 32; i++) frames[k][i] = 'A' + k * 5 + i % 20;
+    }
+    double start = sim_us;
+    for (int k = 0; k < 3; k++) displays[k]->writeFrame(frames[k]);
+    double sequential_us = sim_us - start;
+
+    LCDGroup group;
+    for (int k = 0; k < 3; k++) CHECK(group.add(*displays[k]));
+
+    LCD_Timing t;
+    a.getTiming(&t);
+    shared.setTiming(&t);
+    CHECK(!group.add(shared));
+    CHECK(group.size() == 3);
+
+    for (int k = 0; k < 3; k++) {
+        for (int i = 0; i < 32; i++) frames[k][i] = 'a' + k * 3 + i % 20;
+    }
+    const uint8_t* parallel[3] = { frames[0], frames[1], frames[2] };
+    start = sim_us;
+    group.writeFrame(parallel);
+    double group_us = sim_us - start;
+
+    for (int k = 0; k < 3; k++) {
+        std::string expected = std::string((const char*)frames[k], 16) + '\n' +
+                               std::string((const char*)frames[k] + 16, 16) + '\n';
+        CHECK(sims[k].screen(16, 2) == expected);
+    }
+    CHECK(group_us * 2 < sequential_us);
+    printf("3 frames: %.0f us one by one, %.0f us as a group\n", sequential_us, group_us);
+
+    // the displays keep working on their own
+    b.setCursor(0, 1);
+    b.printLCD("after");
+    CHECK(sims[1].row(1, 16, 2).compare(0, 5, "after") == 0);
+    return testResult("test_group");
+}
@@ -0,0 +1,120 @@
+/**
+ * @file test_isr.cpp
+ * @brief Posting from interrupts never calls a blocking HAL or bus function and takes a
+ *        time independent of the text, and drain() keeps the DDRAM address, also past the end
+ *        of a row and in right to left text.
+ */
+
+#include "test_common.hpp"
+#include "lcd_isr.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+static LCDIsrPrint* isr;
+static long irqs = 0;
+static uint32_t code = 0;
+
+// Posts a fault now and then, from wherever the simulated interrupt preempts the main loop
+static void faultIrq(void) {
+    if (++irqs % 97) return;
+    isr->postHex(0, "FAULT ", ++code);
+    if (irqs % 3 == 0) isr->post(1, "overcurrent");
+}
+
+static void blockingIrq(void) {
+    HAL_GetTick();
+}
+
+static const char* const texts[] = {
+    "", "E1", "overcurrent", "a much longer text than a slot holds, about sixty characters",
+};
+static int timed_kind = 0, timed_rep = 0;
+static std::vector<double> timed_ns;
+
+static void timedIrq(void) {
+    const char* text = texts[timed_rep % 4];
+    auto start = std::chrono::steady_clock::now();
+    if (timed_kind) isr->postHex(2, text, timed_rep);
+    else isr->post(2, text);
+    auto end = std::chrono::steady_clock::now();
+    timed_ns.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+}
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    CHECK(lcd.calibrate());
+
+    LCDIsrPrint print(lcd);
+    isr = &print;
+    CHECK(print.reserve(0, 0, 3, 20));
+    CHECK(print.reserve(1, 0, 2, 12));
+    CHECK(print.reserve(2, 12, 2, 8));
+
+    // the simulator does count a HAL call made from an interrupt
+    sim_irq_hook = blockingIrq;
+    sim_advance_us(0);
+    sim_irq_hook = nullptr;
+    CHECK(sim_irq_hal_calls == 1);
+    sim_irq_hal_calls = 0;
+
+    // host timing of the post paths, called as interrupts; the timer overhead is included
+    sim_irq_hook = timedIrq;
+    for (timed_kind = 0; timed_kind < 2; timed_kind++) {
+        timed_ns.clear();
+        for (timed_rep = 0; timed_rep < 100000; timed_rep++) sim_advance_us(0);
+        std::sort(timed_ns.begin(), timed_ns.end());
+        printf("%s: median %.0f ns, p99.9 %.0f ns on the host\n", timed_kind ? "postHex" : "post",
+               timed_ns[timed_ns.size() / 2], timed_ns[timed_ns.size() * 999 / 1000]);
+    }
+    sim_irq_hook = nullptr;
+    CHECK(sim_irq_hal_calls == 0);
+
+    // interrupts preempting display traffic at every GPIO access
+    sim_irq_hook = faultIrq;
+    for (int i = 0; i < 200; i++) {
+        lcd.setCursor(0, 0);
+        lcd.printFormatted("main loop %5d", i);
+        lcd.setCursor(0, 1);
+        lcd.printLCD("status: ok");
+        print.drain();
+    }
+    sim_irq_hook = nullptr;
+    print.drain();
+    printf("%ld interrupts posted %u faults, %ld HAL or bus calls inside them\n", irqs,
+           (unsigned)code, sim_irq_hal_calls);
+    CHECK(code > 100);
+    CHECK(sim_irq_hal_calls == 0);
+
+    char last[21];
+    snprintf(last, sizeof(last), "FAULT       %08X", (unsigned)code);
+    CHECK(sim.row(3, 20, 4) == last);
+    CHECK(sim.row(2, 20, 4).compare(0, 12, "overcurrent ") == 0);
+
+    // drain() put the cursor back after "status: ok"
+    lcd.putch('#');
+    CHECK(sim.row(1, 20, 4).compare(0, 11, "status: ok#") == 0);
+
+    // past the end of a row printing continues at the next address, row 0 runs into row 2
+    lcd.setCursor(0, 0);
+    lcd.printLCD("twenty characters...");
+    print.post(2, "past end");
+    CHECK(print.drain() == 1);
+    lcd.putch('Q');
+    CHECK(sim.row(2, 20, 4) == "Qvercurrent past end");
+
+    // right to left text continues leftwards, and the message still reads left to right
+    lcd.setCursor(10, 1);
+    lcd.rightToLeft();
+    lcd.printLCD("ab");
+    print.post(2, "rtl text");
+    CHECK(print.drain() == 1);
+    lcd.printLCD("c");
+    lcd.leftToRight();
+    CHECK(sim.row(1, 20, 4).substr(8, 3) == "cba");
+    CHECK(sim.row(2, 20, 4).substr(12) == "rtl text");
+    return testResult("test_isr");
+}
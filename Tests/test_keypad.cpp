@@ -0,0 +1,134 @@
+/**
+ * @file test_keypad.cpp
+ * @brief Keys on the data lines are debounced, found both by poll() and in the controller
+ *        waits of a calibrated display, and a transfer after a scan still writes correct
+ *        nibbles.
+ */
+
+#include "test_common.hpp"
+#include "lcd_keypad.hpp"
+#include <string>
+
+// Keys held down, row * 4 + data line
+static uint16_t held = 0;
+static bool rows_wired = true;
+
+static const uint16_t data_pins[4] = { GPIO_PIN_8, GPIO_PIN_9, GPIO_PIN_10, GPIO_PIN_11 };
+static const uint16_t row_pins[2] = { GPIO_PIN_0, GPIO_PIN_1 };
+
+// Drives the data lines as the keypad would: pulled up, low where a pressed key
+// connects them to a row line that is pulled low, or to ground without rows.
+static void readKeys(GPIO_TypeDef* port) {
+    if (port != GPIOC) return;
+    uint16_t keys = held;
+    for (int i = 0; i < 4; i++) {
+        int bit = __builtin_ctz(data_pins[i]);
+        if (((port->MODER >> (2 * bit)) & 3) != 0) continue;    // an output, not read
+        bool low = false;
+        for (int r = 0; r < (rows_wired ? 2 : 1); r++) {
+            bool selected = !rows_wired || !(GPIOE->ODR & row_pins[r]);
+            if (selected && (keys & (1 << (r * 4 + i)))) low = true;
+        }
+        if (low) port->IDR &= ~data_pins[i];
+        else port->IDR |= data_pins[i];
+    }
+}
+
+static bool dataOutputs(void) {
+    for (uint16_t pin : data_pins) {
+        if (((GPIOC->MODER >> (2 * __builtin_ctz(pin))) & 3) != 1) return false;
+    }
+    return true;
+}
+
+static void pollFor(LCDKeypad& keypad, int scans) {
+    for (int i = 0; i < scans; i++) {
+        sim_advance_us(LCD_KEYPAD_PERIOD_MS * 1000);
+        CHECK(keypad.poll());
+    }
+}
+
+static void debounce(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    LCDKeypad keypad(lcd);
+    CHECK(keypad.addRow(GPIOE, row_pins[0]) && keypad.addRow(GPIOE, row_pins[1]));
+    keypad.begin();
+    rows_wired = true;
+    sim_read_hook = readKeys;
+
+    // a bouncing key is accepted after LCD_KEYPAD_DEBOUNCE equal scans
+    const uint16_t key = 1 << (4 + 2);      // row 1, D6
+    for (int i = 0; i < 2 * LCD_KEYPAD_DEBOUNCE; i++) {
+        held = (i & 1) ? 0 : key;
+        pollFor(keypad, 1);
+    }
+    CHECK(keypad.keys() == 0);
+    held = key;
+    pollFor(keypad, LCD_KEYPAD_DEBOUNCE - 1);
+    CHECK(keypad.keys() == 0);
+    pollFor(keypad, 1);
+    CHECK(keypad.keys() == held);
+    CHECK(keypad.takePressed() == held && keypad.takePressed() == 0);
+    CHECK(!keypad.poll());     // not due yet
+    CHECK(dataOutputs());
+
+    // a second key in the other row, then both released
+    held |= 1 << 1;
+    pollFor(keypad, LCD_KEYPAD_DEBOUNCE);
+    CHECK(keypad.keys() == ((1 << 6) | (1 << 1)));
+    CHECK(keypad.takePressed() == (1 << 1));
+    held = 0;
+    pollFor(keypad, LCD_KEYPAD_DEBOUNCE - 1);
+    CHECK(keypad.keys() != 0);
+    pollFor(keypad, 1);
+    CHECK(keypad.keys() == 0 && keypad.takePressed() == 0);
+
+    // rows are released between scans
+    CHECK((GPIOE->ODR & (row_pins[0] | row_pins[1])) == (row_pins[0] | row_pins[1]));
+    keypad.end();
+    sim_read_hook = nullptr;
+}
+
+static void inWaits(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    LCDKeypad keypad(lcd);          // keys straight to ground
+    keypad.begin();
+    rows_wired = false;
+    held = 1 << 3;
+    sim_read_hook = readKeys;
+
+    // the scans run in the waits of the display updates, and the bytes after each scan
+    // reach the controller intact
+    long violations = sim_violations;
+    for (int i = 0; i < 200 && keypad.keys() != held; i++) {
+        char line[17];
+        snprintf(line, sizeof(line), "update %04d key ", i);
+        lcd.setCursor(0, i & 1);
+        lcd.printLCD(line);
+        CHECK(sim.row(i & 1, 16, 2) == line);
+    }
+    CHECK(keypad.keys() == held);
+    CHECK(keypad.gapScans() >= LCD_KEYPAD_DEBOUNCE && keypad.gapScans() == keypad.scans());
+    CHECK(sim_violations == violations);
+    CHECK(dataOutputs());
+
+    lcd.setCursor(0, 0);
+    lcd.printLCD("after the scans");
+    CHECK(sim.row(0, 16, 2) == "after the scans ");
+    keypad.end();
+    sim_read_hook = nullptr;
+    printf("keypad: %u scans, all in controller waits\n", (unsigned)keypad.scans());
+}
+
+int main() {
+    debounce();
+    inWaits();
+    return testResult("test_keypad");
+}
@@ -0,0 +1,117 @@
+/**
+ * @file test_layout.cpp
+ * @brief Bytes per update of a 20x4 dashboard, against redrawing the whole screen.
+ */
+
+#include "test_common.hpp"
+#include "lcd_layout.hpp"
+#include <cstdlib>
+#include <string>
+
+static long busBytes(const SimLCD& sim) {
+    return sim.commands + sim.data_bytes;
+}
+
+// A fixed point value as a numeric field shows it, right aligned.
+static std::string fixed(long value, int decimals, int width) {
+    char text[24];
+    long scale = 1;
+    for (int i = 0; i < decimals; i++) scale *= 10;
+    if (decimals) snprintf(text, sizeof(text), "%*ld.%0*ld", width - decimals - 1, value / scale, decimals, value % scale);
+    else snprintf(text, sizeof(text), "%*ld", width, value);
+    return text;
+}
+
+static std::string bar(long value, long max, int width) {
+    int filled = value * width / max;
+    return std::string(filled, '\xFF') + std::string(width - filled, ' ');
+}
+
+static std::string padded(const char* text, int width) {
+    std::string s(text);
+    s.resize(width, ' ');
+    return s;
+}
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    CHECK(lcd.calibrate());
+
+    LCDLayout layout(lcd);
+    layout.addLabel(0, 0, 5, "Temp");
+    int temp = layout.addNumber(6, 0, 6, 1);
+    int alarm = layout.addIcon(19, 0, ' ');
+    layout.addLabel(0, 1, 5, "Pres");
+    int pressure = layout.addNumber(6, 1, 7, 2);
+    int level = layout.addBar(0, 2, 20, 1000);
+    int status = layout.addLabel(0, 3, 20, "starting");
+    CHECK(temp >= 0 && alarm >= 0 && pressure >= 0 && level >= 0 && status >= 0);
+    layout.redraw();
+
+    static const char* states[] = { "running", "running, low flow", "filling", "draining" };
+    long t = 215, p = 101325, l = 400;
+    long incremental = 0, updates = 0;
+    srand(1);
+    for (int i = 0; i < 500; i++) {
+        t += rand() % 3 - 1;
+        p += rand() % 21 - 10;
+        l = (l + rand() % 41 - 20 + 1000) % 1000;
+        const char* state = states[(i / 50) % 4];
+
+        long before = busBytes(sim);
+        size_t counted = layout.bytesSent();
+        layout.setNumber(temp, t);
+        layout.setNumber(pressure, p);
+        layout.setBar(level, l);
+        layout.setIcon(alarm, (t > 220) ? '!' : ' ');
+        layout.setText(status, state);
+        incremental += busBytes(sim) - before;
+        updates++;
+        CHECK(layout.bytesSent() - counted == (size_t)(busBytes(sim) - before));
+
+        std::string expected = padded("Temp", 6) + fixed(t, 1, 6) + std::string(7, ' ') + ((t > 220) ? '!' : ' ') + '\n' +
+                               padded("Pres", 6) + fixed(p, 2, 7) + std::string(7, ' ') + '\n' +
+                               bar(l, 1000, 20) + '\n' + padded(state, 20) + '\n';
+        std::string shown = sim.screen(20, 4);
+        CHECK(shown == expected);
+        if (shown != expected) {
+            printf("%s", shown.c_str());
+            break;
+        }
+    }
+
+    // nothing changed, nothing sent
+    long before = busBytes(sim);
+    layout.redraw();
+    CHECK(busBytes(sim) == before);
+
+    // the same screen drawn from scratch
+    std::string screen = sim.screen(20, 4);
+    before = busBytes(sim);
+    lcd.clear();
+    for (int y = 0; y < 4; y++) {
+        lcd.setCursor(0, y);
+        lcd.printLCD(screen.substr(y * 21, 20));
+    }
+    long full = busBytes(sim) - before;
+    CHECK(sim.screen(20, 4) == screen);
+
+    double per_update = (double)incremental / updates;
+    CHECK(per_update * 4 < full);
+    printf("20x4 dashboard: %.1f bytes per update, %ld for a full redraw\n", per_update, full);
+
+    // rows 2 and 3 of a 40x4 panel are past the default LCD_LAYOUT_MAX_CELLS
+    SimLCD top, bottom;
+    top.wireDefault(GPIO_PIN_12);
+    bottom.wireDefault(GPIO_PIN_7);
+    LCD wide(GPIOC, GPIOD, GPIOC, GPIOF);
+    wide.initSecondEnable(GPIOC, GPIO_PIN_7);
+    beginLcd(wide, 40, 4);
+    LCDLayout wide_layout(wide);
+    CHECK(wide_layout.addLabel(0, 1, 40, "top") >= 0);
+    CHECK(wide_layout.addLabel(0, 2, 40, "bottom") == ((LCD_LAYOUT_MAX_CELLS >= 160) ? 1 : -1));
+    return testResult("test_layout");
+}
@@ -0,0 +1,173 @@
+/**
+ * @file test_mirror.cpp
+ * @brief A viewer decoding the mirror stream always shows what the panel shows, resyncs
+ *        after a corrupt packet, and flush() never touches the bus.
+ */
+
+#include "test_common.hpp"
+#include "lcd_mirror.hpp"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+static std::vector<uint8_t> link;
+static size_t room = SIZE_MAX;
+
+static bool transmit(const uint8_t* data, size_t len, void*) {
+    if (len > room) return false;
+    link.insert(link.end(), data, data + len);
+    if (room != SIZE_MAX) room -= len;
+    return true;
+}
+
+// The decoder of Tools/lcd_mirror.py
+struct Viewer {
+    int cols = 0, rows = 0;
+    std::vector<uint8_t> cells;
+    uint8_t cgram[64] = {};
+    uint8_t control = 0;
+    bool valid = false;
+    int updates = 0, errors = 0;
+    size_t pos = 0;
+
+    void apply(uint8_t type, const uint8_t* p, int n) {
+        if (type == 'G') {
+            cols = p[0];
+            rows = p[1];
+            cells.assign(cols * rows, ' ');
+            memset(cgram, 0, sizeof(cgram));
+            valid = true;
+        } else if (!valid) {
+            return;
+        } else if (type == 'C') {
+            memcpy(&cells[p[0] * cols + p[1]], p + 2, n - 2);
+        } else if (type == 'R') {
+            memcpy(&cgram[p[0]], p + 1, n - 1);
+        } else if (type == 'M') {
+            control = p[0];
+        } else if (type == 'E') {
+            updates++;
+        }
+    }
+
+    void decode(const std::vector<uint8_t>& in) {
+        while (pos < in.size()) {
+            if (in[pos] != LCD_MIRROR_SYNC) {
+                pos++;
+                continue;
+            }
+            if (in.size() - pos < 3 || in.size() - pos < 4u + in[pos + 2]) return;
+            int n = in[pos + 2];
+            uint8_t sum = 0;
+            for (int i = 1; i < 3 + n; i++) sum += in[pos + i];
+            if (sum != in[pos + 3 + n]) {
+                errors++;
+                valid = false;
+                pos++;
+                continue;
+            }
+            apply(in[pos + 1], &in[pos + 3], n);
+            pos += 4 + n;
+        }
+    }
+
+    std::string screen(void) const {
+        std::string s;
+        for (int y = 0; y < rows; y++) {
+            s += std::string((const char*)&cells[y * cols], cols) + '\n';
+        }
+        return s;
+    }
+};
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    CHECK(lcd.calibrate());
+    LCDMirror mirror(lcd, transmit, nullptr);
+    Viewer viewer;
+
+    auto flush = [&]() {
+        double before = sim_us;
+        size_t n = mirror.flush();
+        CHECK(sim_us == before);        // no GPIO access or bus wait
+        viewer.decode(link);
+        return n;
+    };
+
+    static const uint8_t bell[8] = { 4, 14, 14, 14, 31, 0, 4, 0 };
+    static const uint8_t bell_code = 0;
+    lcd.createChar(0, bell);
+    lcd.setCursor(0, 0);
+    lcd.printLCD("Temp:  21.5 C");
+    lcd.setCursor(0, 1);
+    lcd.printLCD("RPM:   1500");
+    lcd.setCursor(0, 2);
+    lcd.printLCD("State: running");
+    lcd.setCursor(19, 0);
+    lcd.writeCells(&bell_code, 1);
+    size_t first = flush();
+    CHECK(viewer.screen() == sim.screen(20, 4));
+    CHECK(memcmp(viewer.cgram, bell, 8) == 0);
+
+    size_t total = 0;
+    bool same = true;
+    double host_us = 0;
+    for (int i = 0; i < 100; i++) {
+        char text[8];
+        snprintf(text, sizeof(text), "%4d.%d", 21 + i / 10, i % 10);
+        lcd.setCursor(6, 0);
+        lcd.printLCD(text);
+        if (i % 5 == 0) {
+            snprintf(text, sizeof(text), "%-5d", 1500 + i);
+            lcd.setCursor(7, 1);
+            lcd.printLCD(text);
+        }
+        auto start = std::chrono::steady_clock::now();
+        total += flush();
+        host_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        same = same && viewer.screen() == sim.screen(20, 4);
+    }
+    CHECK(same);
+    CHECK(flush() == 0);
+
+    lcd.clear();
+    lcd.printLCD("Menu");
+    lcd.setCursor(0, 1);
+    lcd.printLCD("> Settings");
+    size_t change = flush();
+    CHECK(viewer.screen() == sim.screen(20, 4));
+
+    lcd.cursor();
+    lcd.scrollDisplayLeft();
+    size_t shift = flush();
+    CHECK(viewer.screen() == sim.screen(20, 4));
+    CHECK(viewer.control & 0x02);
+
+    // a full transport stops the flush, the next one sends the rest
+    room = 10;
+    lcd.setCursor(0, 3);
+    lcd.printLCD("backpressure test 12");
+    flush();
+    room = SIZE_MAX;
+    flush();
+    CHECK(viewer.screen() == sim.screen(20, 4));
+
+    // a corrupt packet: the viewer drops it and waits for the geometry sent after invalidate()
+    const uint8_t corrupt[] = { LCD_MIRROR_SYNC, 'C', 3, 1, 2, 'x', 0 };
+    link.insert(link.end(), corrupt, corrupt + sizeof(corrupt));
+    mirror.invalidate();
+    lcd.setCursor(0, 2);
+    lcd.printLCD("after resync");
+    flush();
+    CHECK(viewer.errors == 1);
+    CHECK(viewer.valid);
+    CHECK(viewer.screen() == sim.screen(20, 4));
+
+    printf("first flush %zu bytes, %.1f bytes per field update, screen change %zu, shift and "
+           "cursor %zu, %d updates decoded, %.2f us per flush and decode on the host\n",
+           first, total / 100.0, change, shift, viewer.updates, host_us / 100);
+    return testResult("test_mirror");
+}
@@ -0,0 +1,141 @@
+/**
+ * @file test_pageflip.cpp
+ * @brief Page flipping never shows a mixed frame, and drawing after a flip stays hidden.
+ *        With the default delays the cycle counter is never read.
+ */
+
+#include "test_common.hpp"
+#include <string>
+
+struct Watch {
+    int cols, rows;
+    std::string shown;      // the frame on screen
+    std::string next;       // the frame being flipped in, empty outside of flipPage()
+    long checks = 0;
+    long mixed = 0;
+};
+
+// After every executed byte, the panel shows the old or the new frame, or nothing.
+static void check(SimLCD& sim, uint8_t, bool, void* context) {
+    Watch& w = *static_cast<Watch*>(context);
+    if (!sim.displayOn()) return;
+    std::string s = sim.screen(w.cols, w.rows);
+    w.checks++;
+    if (s != w.shown && s != w.next) {
+        if (!w.mixed) printf("mixed frame:\n%s", s.c_str());
+        w.mixed++;
+    }
+}
+
+static std::string frame(int n, int cols, int rows) {
+    std::string s;
+    for (int y = 0; y < rows; y++) {
+        char line[41];
+        snprintf(line, sizeof(line), "F%d/%d %-34s", n, y, "abcdefghijklmnopqrstuvwxyz");
+        s += std::string(line, cols) + '\n';
+    }
+    return s;
+}
+
+static void draw(LCD& lcd, const std::string& f, int cols, int rows) {
+    for (int y = 0; y < rows; y++) {
+        lcd.setCursor(0, y);
+        lcd.printLCD(f.substr(y * (cols + 1), cols));
+    }
+}
+
+static void run(int cols, int rows, bool calibrated) {
+    SimLCD sim;
+    sim.wireDefault();
+    long cycle_reads = sim_cycle_reads;
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, cols, rows);
+    if (calibrated) CHECK(lcd.calibrate());
+    CHECK(lcd.beginPageFlip());
+
+    Watch w;
+    w.cols = cols;
+    w.rows = rows;
+    w.shown = sim.screen(cols, rows);
+    sim.on_execute = check;
+    sim.context = &w;
+
+    for (int n = 0; n < 6; n++) {
+        std::string f = frame(n, cols, rows);
+        draw(lcd, f, cols, rows);
+        CHECK(sim.screen(cols, rows) == w.shown);      // drawn on the hidden page
+
+        w.next = f;
+        lcd.flipPage();
+        w.shown = f;
+        w.next.clear();
+        CHECK(sim.screen(cols, rows) == f);
+
+        // printing right after the flip, without setCursor(), goes to the hidden page
+        lcd.printLCD("xy");
+        CHECK(sim.screen(cols, rows) == f);
+    }
+
+    // ending with page 1 in front keeps its frame on screen, and printing goes on at the
+    // address drawing left off
+    std::string f = frame(6, cols, rows);
+    draw(lcd, f, cols, rows);
+    w.next = f;
+    lcd.flipPage();
+    w.shown = f;
+    w.next.clear();
+    draw(lcd, frame(7, cols, rows), cols, rows);
+    lcd.setCursor(2, 1);
+    lcd.endPageFlip();
+    CHECK(sim.screen(cols, rows) == f);
+    w.shown[(cols + 1) + 2] = 'Q';
+    lcd.printLCD("Q");
+    CHECK(sim.screen(cols, rows) == w.shown);
+
+    CHECK(w.mixed == 0);
+    CHECK(w.checks > 0);
+    if (!calibrated) CHECK(sim_cycle_reads == cycle_reads);    // the default delays need no DWT
+    printf("%dx%d %s: %ld bytes checked, %ld mixed frames\n", cols, rows,
+           calibrated ? "calibrated" : "default delays", w.checks, w.mixed);
+}
+
+/**
+ * @brief Right to left text: the address counter, not the tracked column, is carried over.
+ */
+static void rightToLeft(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    CHECK(lcd.beginPageFlip());
+    lcd.rightToLeft();
+
+    lcd.setCursor(5, 0);
+    lcd.printLCD("ab");             // cells 5 and 4, the address counter at 3
+    lcd.flipPage();
+    CHECK(sim.row(0, 16, 2).substr(3, 3) == " ba");
+    lcd.printLCD("c");              // hidden page, cell 3
+    CHECK(sim.row(0, 16, 2).substr(3, 3) == " ba");
+    lcd.flipPage();
+    CHECK(sim.row(0, 16, 2).substr(3, 3) == "c  ");
+
+    lcd.endPageFlip();              // page 0 was in front, nothing to copy
+    CHECK(sim.row(0, 16, 2).substr(3, 3) == "c  ");
+}
+
+int main() {
+    run(16, 2, true);
+    run(16, 2, false);
+    run(20, 2, true);
+    run(10, 4, true);
+
+    SimLCD sim;
+    sim.wireDefault();
+    LCD wide(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(wide, 20, 4);
+    CHECK(!wide.beginPageFlip());
+
+    rightToLeft();
+    return testResult("test_pageflip");
+}
@@ -0,0 +1,86 @@
+/**
+ * @file test_queue.cpp
+ * @brief Concurrent producers never tear an operation, and home() is executed in order.
+ */
+
+#include "test_common.hpp"
+#include "lcd_queue.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static void countNotify(void* context) {
+    static_cast<std::atomic<long>*>(context)->fetch_add(1);
+}
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+
+    LCDQueue queue(lcd);
+    std::atomic<long> notified(0);
+    queue.setNotify(countNotify, &notified);
+
+    const int producers = 4, count = 3000;
+    std::atomic<int> done(0);
+    std::atomic<long> submitted(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; t++) {
+        threads.emplace_back([&, t] {
+            char text[32];
+            for (int i = 0; i < count;) {
+                snprintf(text, sizeof(text), "T%d:%08d:%c%c%c%c%c", t, i, 'a' + t, 'a' + t,
+                         'a' + t, 'a' + t, 'a' + t);
+                if (queue.printAt(0, t, text)) {
+                    i++;
+                    submitted++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            done++;
+        });
+    }
+
+    // the bus owner checks every row after each operation
+    long processed = 0, torn = 0;
+    for (;;) {
+        bool finished = done == producers;
+        size_t n = queue.process(1);
+        if (!n) {
+            if (finished) break;
+            continue;
+        }
+        processed++;
+        for (int r = 0; r < 4; r++) {
+            std::string s = sim.row(r, 20, 4);
+            if (s[0] == ' ') continue;
+            int t, i;
+            char tail[6];
+            if (sscanf(s.c_str(), "T%d:%d:%5s", &t, &i, tail) != 3 || t != r ||
+                tail[0] != 'a' + t || tail[4] != 'a' + t) {
+                if (!torn) printf("torn row: %s\n", s.c_str());
+                torn++;
+            }
+        }
+    }
+    for (std::thread& t : threads) t.join();
+
+    CHECK(torn == 0);
+    CHECK(processed == producers * count);
+    CHECK(submitted == producers * count);
+    CHECK(notified == producers * count);
+    printf("%ld operations, %u dropped and retried, %ld torn rows\n", processed,
+           (unsigned)queue.dropped(), torn);
+
+    // home() undoes a display shift and moves the cursor to the top left corner
+    lcd.scrollDisplayLeft();
+    CHECK(queue.home());
+    CHECK(queue.print("H"));
+    CHECK(queue.process() == 2);
+    CHECK(sim.shift == 0);
+    CHECK(sim.row(0, 20, 4)[0] == 'H');
+    return testResult("test_queue");
+}
@@ -0,0 +1,69 @@
+/**
+ * @file test_resync.cpp
+ * @brief A stray enable pulse shifts the nibble phase; resync() finds it with one status
+ *        read, brings the controller back to 4-bit mode and repairs DDRAM and CGRAM from
+ *        the shadow.
+ */
+
+#include "test_common.hpp"
+#include <cstring>
+#include <string>
+
+static const uint8_t glyph[8] = { 0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 };
+
+// A glitch on the enable line: one pulse with whatever the other pins hold.
+static void strayPulse(void) {
+    sim_advance_us(5000);
+    HAL_GPIO_WritePin(GPIOC, GPIO_PIN_12, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(GPIOC, GPIO_PIN_12, GPIO_PIN_RESET);
+    sim_advance_us(5000);
+}
+
+static void run(bool calibrated) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+    if (calibrated) CHECK(lcd.calibrate());
+
+    lcd.createChar(5, glyph);
+    lcd.setCursor(0, 0);
+    lcd.printLCD("resync \x05 test");
+    lcd.setCursor(0, 1);
+    lcd.printLCD("second row");
+    lcd.scrollDisplayLeft();
+    CHECK(!lcd.resync());      // aligned: nothing is sent but the status read
+    uint8_t ddram[80], cgram[64];
+    memcpy(ddram, sim.ddram, sizeof(ddram));
+    memcpy(cgram, sim.cgram, sizeof(cgram));
+    std::string screen = sim.screen(16, 2);
+
+    // after the glitch every byte arrives shifted by a nibble
+    strayPulse();
+    lcd.setCursor(4, 1);
+    lcd.printLCD("ROW");
+    CHECK(sim.screen(16, 2) != screen || memcmp(sim.ddram, ddram, sizeof(ddram)));
+
+    double start = sim_us;
+    CHECK(lcd.resync());
+    double resync_us = sim_us - start;
+    CHECK(sim.four_bit && sim.lines == 2);
+    memcpy(&ddram[40 + 4], "ROW", 3);
+    CHECK(memcmp(sim.ddram, ddram, sizeof(ddram)) == 0);
+    CHECK(memcmp(&sim.cgram[5 * 8], &cgram[5 * 8], 8) == 0);
+    CHECK(sim.shift == 1 && sim.increment && !sim.ac_cgram);
+
+    // printing goes on where it left off, and the bus is aligned again
+    lcd.printLCD("!");
+    CHECK(sim.ddram[40 + 7] == '!');
+    CHECK(!lcd.resync());
+
+    printf("%s: resynchronized and repaired in %.1f ms\n", calibrated ? "calibrated" : "default delays",
+           resync_us / 1000);
+}
+
+int main() {
+    run(true);
+    run(false);
+    return testResult("test_resync");
+}
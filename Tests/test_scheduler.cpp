@@ -0,0 +1,71 @@
+/**
+ * @file test_scheduler.cpp
+ * @brief Frames stay within the bus time budget, and updates never stall, also with the
+ *        default settings on an uncalibrated display.
+ */
+
+#include "test_common.hpp"
+#include "lcd_scheduler.hpp"
+
+static uint32_t clockUs(void) {
+    return (uint32_t)sim_us;
+}
+
+static void run(bool calibrated, uint32_t budget_us, double seconds) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    if (calibrated) CHECK(lcd.calibrate());
+
+    LCDLayout layout(lcd);
+    LCDScheduler scheduler(layout, clockUs);
+    int fields[6];
+    for (int i = 0; i < 6; i++) fields[i] = scheduler.addField((i % 2) * 10, i / 2, 10);
+    if (budget_us) scheduler.setBudget(budget_us);
+
+    // producers post far faster than the frame rate
+    long posts = 0;
+    int frames = 0;
+    double end = sim_us + seconds * 1e6;
+    while (sim_us < end) {
+        for (int i = 0; i < 6; i++) scheduler.postFormatted(fields[i], "v%d=%ld", i, posts++ % 997);
+        sim_advance_us(2000);
+        if (scheduler.poll()) frames++;
+    }
+
+    // once the producers stop, every field catches up with its latest text
+    for (int n = 0; n < 12; n++) {
+        sim_advance_us(100000);
+        scheduler.poll();
+    }
+    std::string expected;
+    for (int y = 0; y < 3; y++) {
+        char row[21];
+        long last = posts - 6 + 2 * y;
+        snprintf(row, sizeof(row), "v%d=%-7ldv%d=%-7ld", 2 * y, last % 997, 2 * y + 1,
+                 (last + 1) % 997);
+        expected += std::string(row) + '\n';
+    }
+    expected += std::string(20, ' ') + '\n';
+    std::string shown = sim.screen(20, 4);
+    CHECK(shown == expected);
+    if (shown != expected) printf("%s", shown.c_str());
+    CHECK(frames > 0);
+    CHECK(scheduler.postsCoalesced() > 0);
+
+    printf("%s, budget %u us: %d frames, max frame %u us\n",
+           calibrated ? "calibrated" : "default delays",
+           (unsigned)(budget_us ? budget_us : LCD_SCHEDULER_BUDGET_US), frames,
+           (unsigned)scheduler.maxFrameTime());
+    if (calibrated && budget_us >= LCD_SCHEDULER_BUDGET_US) {
+        CHECK(scheduler.maxFrameTime() <= LCD_SCHEDULER_BUDGET_US);
+    }
+}
+
+int main() {
+    run(true, 0, 5);
+    run(true, 100, 5);      // below one field: one field per frame
+    run(false, 0, 20);      // default settings on an uncalibrated display
+    return testResult("test_scheduler");
+}
@@ -0,0 +1,28 @@
+/**
+ * @file test_screen.cpp
+ * @brief Screen templates find their fields, also when built at run time with too many.
+ */
+
+#include "test_common.hpp"
+#include "lcd_screen.hpp"
+
+constexpr auto status = lcdScreen<16, 2>(
+    "Temp ##### C    ",
+    "Fan  ###  %  ## ");
+
+static_assert(status.count == 3, "three fields");
+static_assert(status.fields[0].x == 5 && status.fields[0].width == 5, "first field");
+static_assert(status.fields[2].x == 13 && status.fields[2].y == 1, "last field");
+
+int main() {
+    // ten one-cell fields: the last two stay plain spaces
+    volatile char marker = LCD_SCREEN_FIELD_CHAR;
+    char row[21];
+    for (int x = 0; x < 20; x++) row[x] = (x % 2) ? '.' : (char)marker;
+    row[20] = 0;
+    auto many = lcdScreen<20, 1>(row);
+    CHECK(many.count == LCD_SCREEN_MAX_FIELDS);
+    for (int f = 0; f < many.count; f++) CHECK(many.fields[f].x == 2 * f && many.fields[f].width == 1);
+    CHECK(many.text[0][18] == ' ');
+    return testResult("test_screen");
+}
@@ -0,0 +1,77 @@
+/**
+ * @file test_scrub.cpp
+ * @brief Corrupted DDRAM and CGRAM cells are found and rewritten by repeated scrub()
+ *        calls, each staying within its time budget, and printing goes on at the address
+ *        it left off.
+ */
+
+#include "test_common.hpp"
+#include <cstring>
+
+static const uint8_t glyph[8] = { 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00 };
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    CHECK(lcd.calibrate());
+    LCD_Timing t;
+    lcd.getTiming(&t);
+
+    lcd.createChar(2, glyph);
+    for (int y = 0; y < 4; y++) {
+        lcd.setCursor(0, y);
+        lcd.printLCD("scrubbed row \x02 0123");
+    }
+    lcd.setCursor(5, 3);
+    uint8_t ddram[80], cgram[64];
+    memcpy(ddram, sim.ddram, sizeof(ddram));
+    memcpy(cgram, sim.cgram, sizeof(cgram));
+
+    // nothing to repair: a whole pass rewrites nothing
+    for (int i = 0; i < 50; i++) CHECK(lcd.scrub(1000) == 0);
+
+    // interference flips a few characters and a glyph row
+    sim.ddram[3] ^= 0x20;
+    sim.ddram[40 + 17] = '#';
+    sim.ddram[20 + 13] = 0x00;
+    sim.ddram[60 + 19] = 'x';
+    sim.cgram[2 * 8 + 3] = 0x11;
+    const size_t corrupted = 5;
+    CHECK(sim.row(0, 20, 4) != "scrubbed row \x02 0123");
+
+    // a budget below one read does nothing
+    double start = sim_us;
+    CHECK(lcd.scrub(1) == 0);
+    CHECK(sim_us - start <= 1);
+
+    // one read, a rewrite and the address restore fit in each call, so each call repairs
+    // at most a few cells
+    const uint32_t budget_us = 400;
+    size_t fixed = 0, calls = 0, most = 0;
+    double slowest = 0;
+    while (fixed < corrupted && calls < 1000) {
+        start = sim_us;
+        size_t n = lcd.scrub(budget_us);
+        double took = sim_us - start;
+        if (took > slowest) slowest = took;
+        if (n > most) most = n;
+        fixed += n;
+        calls++;
+    }
+    CHECK(fixed == corrupted);
+    CHECK(slowest <= budget_us);
+    CHECK(most * (t.data_us + t.command_us) <= budget_us);
+    CHECK(memcmp(sim.ddram, ddram, sizeof(ddram)) == 0);
+    CHECK(memcmp(&sim.cgram[2 * 8], &cgram[2 * 8], 8) == 0);
+    CHECK(lcd.scrub(budget_us) == 0);
+
+    // the address is where setCursor() left it
+    lcd.printLCD("*");
+    CHECK(sim.ddram[40 + 20 + 5] == '*');
+
+    printf("%u cells repaired in %u calls of %u us, slowest call %.0f us\n", (unsigned)fixed,
+           (unsigned)calls, (unsigned)budget_us, slowest);
+    return testResult("test_scrub");
+}
@@ -0,0 +1,136 @@
+/**
+ * @file test_stack.cpp
+ * @brief Menu navigation with the screen stack shows the right screens, costs fewer bytes
+ *        than clearing and reprinting, and printing after pop() goes on where it left off.
+ */
+
+#include "test_common.hpp"
+#include "lcd_stack.hpp"
+#include <cstring>
+
+static const char* const screens[][4] = {
+    { "> Settings          ", "  Status            ", "  Network           ", "  About             " },
+    { "Settings            ", "> Brightness   [80%]", "  Contrast     [50%]", "  Sleep after  [5m] " },
+    { "Brightness          ", "  [#########-----]  ", "  80%               ", "  OK=save  BACK=undo" },
+    { "  Settings          ", "> Status            ", "  Network           ", "  About             " },
+};
+static const uint8_t bar[8] = { 0, 31, 31, 31, 31, 31, 31, 0 };
+static const uint8_t arrow[8] = { 0, 4, 2, 31, 2, 4, 0, 0 };
+
+static void draw(LCD& lcd, int s) {
+    lcd.clear();
+    for (int y = 0; y < 4; y++) {
+        lcd.setCursor(0, y);
+        lcd.printLCD(screens[s][y]);
+    }
+    if (s == 2) lcd.createChar(1, bar);
+}
+
+static std::string expected(int s) {
+    std::string text;
+    for (int y = 0; y < 4; y++) text += std::string(screens[s][y]) + '\n';
+    return text;
+}
+
+static long busBytes(const SimLCD& sim) {
+    return sim.commands + sim.data_bytes;
+}
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 20, 4);
+    CHECK(lcd.calibrate());
+
+    // main -> settings -> brightness -> settings -> main, then a selection move and back
+    const int path[] = { 1, 2, 1, 0, 3, 0 };
+    draw(lcd, 0);
+    long start = busBytes(sim);
+    double start_us = sim_us;
+    for (int s : path) draw(lcd, s);
+    long redraw_bytes = busBytes(sim) - start;
+    double redraw_us = sim_us - start_us;
+
+    LCDScreenStack stack(lcd);
+    LCDSnapshot cache[4];
+    bool cached[4] = {};
+    draw(lcd, 0);
+    CHECK(stack.capture(cache[0]));
+    cached[0] = true;
+    auto forward = [&](int s) {
+        if (cached[s]) {
+            CHECK(stack.push(&cache[s]));
+        } else {
+            CHECK(stack.push());
+            draw(lcd, s);
+            CHECK(stack.capture(cache[s]));
+            cached[s] = true;
+        }
+    };
+    // the first pass draws each screen once and keeps its snapshot
+    forward(1);
+    forward(2);
+    CHECK(stack.pop());
+    CHECK(stack.pop());
+
+    start = busBytes(sim);
+    start_us = sim_us;
+    forward(1);
+    CHECK(sim.screen(20, 4) == expected(1));
+    forward(2);
+    CHECK(sim.screen(20, 4) == expected(2));
+    CHECK(memcmp(&sim.cgram[8], bar, 8) == 0);
+    CHECK(stack.pop());
+    CHECK(sim.screen(20, 4) == expected(1));
+    CHECK(stack.pop());
+    CHECK(sim.screen(20, 4) == expected(0));
+
+    uint8_t frame[80];
+    for (int y = 0; y < 4; y++) memcpy(&frame[20 * y], screens[3][y], 20);
+    stack.showFrame(frame);
+    CHECK(sim.screen(20, 4) == expected(3));
+    for (int y = 0; y < 4; y++) memcpy(&frame[20 * y], screens[0][y], 20);
+    stack.showFrame(frame);
+    CHECK(sim.screen(20, 4) == expected(0));
+    long stack_bytes = busBytes(sim) - start;
+    double stack_us = sim_us - start_us;
+
+    printf("6 transitions: clear and reprint %ld bytes %.1f ms, screen stack %ld bytes %.1f ms\n",
+           redraw_bytes, redraw_us / 1000, stack_bytes, stack_us / 1000);
+    CHECK(stack_bytes * 3 < redraw_bytes * 2);
+    CHECK(stack_us * 2 < redraw_us);
+
+    // pop() brings back CGRAM, the cursor mode and the cursor position
+    lcd.setCursor(2, 3);
+    CHECK(stack.push());
+    lcd.createChar(1, arrow);
+    lcd.cursor();
+    lcd.setCursor(5, 2);
+    CHECK(stack.pop());
+    CHECK(memcmp(&sim.cgram[8], bar, 8) == 0);
+    CHECK(!(sim.display_control & 0x02));
+    lcd.putch('Z');
+    CHECK(sim.row(3, 20, 4)[2] == 'Z');
+
+    // printing after pop() continues at the DDRAM address it left off: past the end of a
+    // row, where it wraps like the controller does, and with right to left text
+    lcd.setCursor(0, 1);
+    lcd.printLCD(screens[1][1]);
+    CHECK(stack.push());
+    draw(lcd, 3);
+    CHECK(stack.pop());
+    lcd.putch('Q');
+    CHECK(sim.row(3, 20, 4)[0] == 'Q');
+
+    lcd.rightToLeft();
+    lcd.setCursor(10, 0);
+    lcd.printLCD("ab");
+    CHECK(stack.push());
+    lcd.leftToRight();
+    draw(lcd, 2);
+    CHECK(stack.pop());
+    lcd.printLCD("c");
+    CHECK(sim.row(0, 20, 4).substr(8, 3) == "cba");
+    return testResult("test_stack");
+}
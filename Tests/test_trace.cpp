@@ -0,0 +1,176 @@
+/**
+ * @file test_trace.cpp
+ * @brief The trace records busy flag reads and data pin direction changes, timestamped
+ *        with the cycle counter by default. A binary export replayed into another
+ *        controller leaves it in the same state, and the VCD output lists every change.
+ */
+
+#include "test_common.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static LCDTraceEvent events[20000];
+static uint8_t binary[100000];
+
+static void busyReads(void) {
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    beginLcd(lcd, 16, 2);
+
+    LCDTrace trace(events, sizeof(events) / sizeof(events[0]));
+    lcd.setTrace(&trace);
+    double start_us = sim_us;
+    CHECK(lcd.calibrate());     // polls the busy flag
+    double elapsed_us = sim_us - start_us;
+    lcd.setTrace(nullptr);
+
+    int inputs = 0, outputs = 0, busy = 0, ready = 0;
+    bool input = false;
+    for (size_t i = 0; i < trace.count(); i++) {
+        const LCDTraceEvent& e = events[i];
+        if (e.signal == LCD_TRACE_DIR) {
+            input = e.level;
+            (e.level ? inputs : outputs)++;
+        } else if (input && e.signal == LCD_TRACE_D0 + 7) {
+            (e.level ? busy : ready)++;
+        }
+    }
+    CHECK(trace.dropped() == 0);
+    CHECK(inputs > 0 && inputs == outputs);
+    CHECK(busy > 0 && ready > 0);
+
+    // the default clock is the cycle counter of the simulated core
+    uint32_t ticks = events[trace.count() - 1].time - events[0].time;
+    double traced_us = ticks / (sim_core_clock / 1e6);
+    CHECK(traced_us > 0 && traced_us <= elapsed_us);
+    CHECK(traced_us > elapsed_us * 0.9);
+
+    printf("%u events, %d reads, D7 read high %d times, %.0f of %.0f us traced\n",
+           (unsigned)trace.count(), inputs, busy, traced_us, elapsed_us);
+}
+
+// The replayed controller: data on GPIOA 8-11, RS on GPIOB 3, RW on GPIOB 2, EN on GPIOE 12
+static const uint16_t replay_pins[4] = { GPIO_PIN_8, GPIO_PIN_9, GPIO_PIN_10, GPIO_PIN_11 };
+
+struct Replay {
+    double start_us;
+    bool input = false;     // the controller drives the data pins
+};
+
+static void replayPin(uint64_t time_ns, uint8_t signal, uint8_t level, void* context) {
+    Replay& r = *static_cast<Replay*>(context);
+    double at = r.start_us + time_ns / 1000.0;
+    if (at > sim_us) sim_advance_us(at - sim_us);
+
+    GPIO_PinState state = level ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    if (signal == LCD_TRACE_DIR) r.input = level;
+    else if (signal == LCD_TRACE_RS) HAL_GPIO_WritePin(GPIOB, GPIO_PIN_3, state);
+    else if (signal == LCD_TRACE_RW) HAL_GPIO_WritePin(GPIOB, GPIO_PIN_2, state);
+    else if (signal == LCD_TRACE_EN) HAL_GPIO_WritePin(GPIOE, GPIO_PIN_12, state);
+    else if (signal >= LCD_TRACE_D0 + 4 && signal <= LCD_TRACE_D0 + 7 && !r.input)
+        HAL_GPIO_WritePin(GPIOA, replay_pins[signal - LCD_TRACE_D0 - 4], state);
+}
+
+static void vcdOut(const char* text, size_t len, void* context) {
+    static_cast<std::string*>(context)->append(text, len);
+}
+
+static void roundTrip(void) {
+    static const uint8_t glyph[8] = { 0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00 };
+    SimLCD sim;
+    sim.wireDefault();
+    LCD lcd(GPIOC, GPIOD, GPIOC, GPIOF);
+    LCDTrace trace(events, sizeof(events) / sizeof(events[0]));
+    lcd.setTrace(&trace);
+
+    // everything from the power on sequence, with busy flag reads and the default delays
+    beginLcd(lcd, 16, 2);
+    CHECK(lcd.calibrate());
+    lcd.createChar(3, glyph);
+    lcd.setCursor(2, 0);
+    lcd.printLCD("trace \x03");
+    lcd.setCursor(0, 1);
+    lcd.printLCD("replayed");
+    lcd.scrollDisplayLeft();
+    lcd.cursor();
+    lcd.setTrace(nullptr);
+    CHECK(trace.dropped() == 0);
+
+    size_t len = trace.exportBinary(binary, sizeof(binary));
+    CHECK(len > 9 && len < trace.count() * 3);
+    CHECK(trace.exportBinary(binary, len - 1) == 0);        // too small for the whole trace
+
+    SimLCD copy;
+    copy.wire(GPIOA, replay_pins, GPIOB, GPIO_PIN_3, GPIOB, GPIO_PIN_2, GPIOE, GPIO_PIN_12);
+    GPIO_InitTypeDef init = {};
+    init.Pin = GPIO_PIN_8 | GPIO_PIN_9 | GPIO_PIN_10 | GPIO_PIN_11;
+    init.Mode = GPIO_MODE_OUTPUT_PP;
+    HAL_GPIO_Init(GPIOA, &init);
+
+    Replay r;
+    r.start_us = sim_us;
+    long violations = sim_violations;
+    CHECK(LCDTrace::replay(binary, len, replayPin, &r) == trace.count());
+    CHECK(sim_violations == violations);
+    CHECK(memcmp(copy.ddram, sim.ddram, sizeof(sim.ddram)) == 0);
+    CHECK(memcmp(copy.cgram, sim.cgram, sizeof(sim.cgram)) == 0);
+    CHECK(copy.ac == sim.ac && copy.ac_cgram == sim.ac_cgram && copy.shift == sim.shift);
+    CHECK(copy.display_control == sim.display_control && copy.four_bit && copy.lines == 2);
+    CHECK(copy.commands == sim.commands && copy.data_bytes == sim.data_bytes);
+    CHECK(copy.row(0, 16, 2) == sim.row(0, 16, 2));
+
+    // a damaged header is not replayed
+    binary[0] = 'X';
+    CHECK(LCDTrace::replay(binary, len, replayPin, &r) == 0);
+
+    // VCD: the header declares every signal, then each event is one value change, after a
+    // timestamp in nanoseconds whenever the time moved on
+    std::string vcd;
+    CHECK(trace.writeVcd(vcdOut, &vcd) == vcd.size());
+    size_t body = vcd.find("$dumpvars\n");
+    CHECK(vcd.compare(0, 43, "$timescale 1ns $end\n$scope module lcd $end\n") == 0);
+    CHECK(vcd.find("$var wire 1 ! RS $end\n") != std::string::npos);
+    CHECK(vcd.find("$var wire 1 # EN $end\n") != std::string::npos);
+    CHECK(vcd.find("$var wire 1 + D7 $end\n") != std::string::npos);
+    CHECK(vcd.find("$var wire 1 - DIR $end\n") != std::string::npos);
+    CHECK(body != std::string::npos && body > vcd.find("$enddefinitions"));
+    body = vcd.find("$end\n", body) + 5;
+
+    std::vector<std::string> lines;
+    for (size_t at = body; at < vcd.size();) {
+        size_t end = vcd.find('\n', at);
+        lines.push_back(vcd.substr(at, end - at));
+        at = end + 1;
+    }
+    size_t changes = 0;
+    long long last = -1;
+    uint64_t ticks = 0;
+    bool ordered = true, matches = true, timed = true;
+    for (const std::string& line : lines) {
+        if (line[0] == '#') {
+            long long ns = atoll(line.c_str() + 1);
+            ordered &= ns > last;
+            last = ns;
+            continue;
+        }
+        if (changes) ticks += (uint32_t)(events[changes].time - events[changes - 1].time);
+        const LCDTraceEvent& e = events[changes++];
+        matches &= line.size() == 2 && line[0] == '0' + e.level && line[1] == '!' + e.signal;
+        timed &= (uint64_t)last == ticks * 1000000000ULL / sim_core_clock;
+    }
+    CHECK(lines[0] == "#0");
+    CHECK(ordered && matches && timed);
+    CHECK(changes == trace.count());
+
+    printf("%u events exported in %u bytes, replayed into the same state; %u bytes of VCD\n",
+           (unsigned)trace.count(), (unsigned)len, (unsigned)vcd.size());
+}
+
+int main() {
+    busyReads();
+    roundTrip();
+    return testResult("test_trace");
+}
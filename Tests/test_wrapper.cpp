@@ -0,0 +1,66 @@
+/**
+ * @file test_wrapper.cpp
+ * @brief The C wrapper creates displays in a static pool of LCD_MAX_INSTANCES objects,
+ *        returns NULL when it is exhausted, and reuses a slot after LCD_destroy().
+ */
+
+#include "test_common.hpp"
+#include "LCD_wrapper.h"
+#include <string>
+
+static LCD* create(void) {
+    return LCD_create(GPIOC, GPIOD, GPIOC, GPIOF);
+}
+
+static void begin(LCD* lcd) {
+    LCD_initCtrlPins(lcd, GPIO_PIN_2, GPIO_PIN_12, GPIO_PIN_3);
+    LCD_initDataPins(lcd, GPIO_PIN_8, GPIO_PIN_9, GPIO_PIN_10, GPIO_PIN_11);
+    LCD_Begin(lcd, 16, 2);
+}
+
+int main() {
+    SimLCD sim;
+    sim.wireDefault();
+
+    // the pool holds LCD_MAX_INSTANCES displays, each in its own slot
+    LCD* lcds[LCD_MAX_INSTANCES];
+    for (int i = 0; i < LCD_MAX_INSTANCES; i++) {
+        lcds[i] = create();
+        CHECK(lcds[i] != NULL);
+        for (int j = 0; j < i; j++) CHECK(lcds[i] != lcds[j]);
+    }
+    CHECK(create() == NULL);
+
+    // pointers that are not from the pool, and NULL, are ignored
+    LCD outside(GPIOC, GPIOD, GPIOC, GPIOF);
+    LCD_destroy(&outside);
+    LCD_destroy(NULL);
+    CHECK(create() == NULL);
+
+    // a destroyed display leaves the panel as it was, and its slot takes a new one
+    begin(lcds[0]);
+    LCD_print(lcds[0], "first");
+    LCD_destroy(lcds[0]);
+    CHECK(sim.row(0, 16, 2) == "first           ");
+    LCD* reused = create();
+    CHECK(reused == lcds[0]);
+    CHECK(create() == NULL);
+
+    // the new display starts from a fresh object
+    begin(reused);
+    LCD_setCursor(reused, 0, 1);
+    LCD_print(reused, "second");
+    CHECK(sim.row(0, 16, 2) == "                ");
+    CHECK(sim.row(1, 16, 2) == "second          ");
+
+    // destroying twice frees the slot once
+    LCD_destroy(reused);
+    LCD_destroy(reused);
+    CHECK(create() == reused);
+    CHECK(create() == NULL);
+
+    for (int i = 0; i < LCD_MAX_INSTANCES; i++) LCD_destroy(lcds[i]);
+    for (int i = 0; i < LCD_MAX_INSTANCES; i++) CHECK(create() != NULL);
+    CHECK(create() == NULL);
+    return testResult("test_wrapper");
+}
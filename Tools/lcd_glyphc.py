@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Converts glyph sources into a header with a constexpr glyph set (see Inc/lcd_glyph.hpp).
+
+Two source formats are read:
+
+  Text art (.txt), one block per glyph, blocks separated by blank lines:
+
+      bell
+      ..#..
+      .###.
+      ...
+
+  The first line of a block is the glyph name, followed by 7 or 8 rows of 5 pixels,
+  '#' lit and '.' dark. Lines starting with ';' are comments.
+
+  BDF fonts (.bdf). Every glyph must fit a 5x8 cell; glyphs are placed in the cell by
+  their bounding box relative to the font bounding box. --chars selects glyphs by name
+  or by encoding (decimal, or U+XXXX), in the order given.
+
+Usage:
+
+  lcd_glyphc.py icons.txt -o icons_glyphs.hpp --name icons
+  lcd_glyphc.py font.bdf --chars U+00B0,U+2192 -o arrows.hpp --name arrows
+
+The header defines an enum of glyph IDs (<NAME>_<GLYPH>) and a constexpr lcdGlyphSet()
+named after --name. Deduplication and the limit of 8 distinct patterns are checked by
+the compiler when the header is built.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+def fail(message):
+    sys.exit("lcd_glyphc: " + message)
+
+
+def parse_text(path):
+    glyphs = []
+    block = []
+    with open(path) as f:
+        lines = [line.rstrip("\n") for line in f] + [""]
+    for number, line in enumerate(lines, 1):
+        if line.startswith(";"):
+            continue
+        if line.strip():
+            block.append((number, line.rstrip()))
+            continue
+        if not block:
+            continue
+        (first, name), rows = block[0], block[1:]
+        if len(rows) not in (7, 8):
+            fail("%s:%d: glyph '%s' has %d rows, expected 7 or 8" % (path, first, name, len(rows)))
+        for number_row, row in rows:
+            if len(row) != 5 or set(row) - set("#."):
+                fail("%s:%d: expected 5 pixels of '#' and '.'" % (path, number_row))
+        glyphs.append((name, [row for _, row in rows]))
+        block = []
+    return glyphs
+
+
+def parse_bdf(path, chars):
+    font_box = None
+    found = {}
+    glyph = None
+    with open(path) as f:
+        for line in f:
+            words = line.split()
+            if not words:
+                continue
+            key = words[0]
+            if key == "FONTBOUNDINGBOX":
+                font_box = [int(w) for w in words[1:5]]
+            elif key == "STARTCHAR":
+                glyph = {"name": " ".join(words[1:]), "bitmap": None}
+            elif glyph is None:
+                continue
+            elif key == "ENCODING":
+                glyph["encoding"] = int(words[1])
+            elif key == "BBX":
+                glyph["bbx"] = [int(w) for w in words[1:5]]
+            elif key == "BITMAP":
+                glyph["bitmap"] = []
+            elif key == "ENDCHAR":
+                found[glyph["name"]] = glyph
+                found[glyph.get("encoding", -1)] = glyph
+                glyph = None
+            elif glyph["bitmap"] is not None:
+                glyph["bitmap"].append((int(key, 16), 4 * len(key)))
+    if font_box is None:
+        fail("%s: no FONTBOUNDINGBOX" % path)
+
+    fbb_w, fbb_h, fbb_x, fbb_y = font_box
+    glyphs = []
+    for char in chars:
+        match = re.fullmatch(r"(?:U\+|0x)([0-9A-Fa-f]+)|(\d+)", char)
+        key = int(match.group(1), 16) if match and match.group(1) else int(char) if match else char
+        if key not in found:
+            fail("%s: no glyph '%s'" % (path, char))
+        g = found[key]
+        w, h, x, y = g["bbx"]
+        top = (fbb_h + fbb_y) - (y + h)
+        left = x - fbb_x
+        if w + left > 5 or top < 0 or top + h > 8 or left < 0:
+            fail("%s: glyph '%s' does not fit a 5x8 cell" % (path, char))
+        rows = ["....."] * 8
+        for i, (bits, width_bits) in enumerate(g["bitmap"][:h]):
+            row = ""
+            for px in range(5):
+                col = px - left
+                lit = 0 <= col < w and bits >> (width_bits - 1 - col) & 1
+                row += "#" if lit else "."
+            rows[top + i] = row
+        glyphs.append((g["name"], rows))
+    return glyphs
+
+
+def identifier(text):
+    name = re.sub(r"[^0-9A-Za-z]+", "_", text).strip("_").upper()
+    return name if name and not name[0].isdigit() else "G_" + name
+
+
+def emit(glyphs, source, name):
+    prefix = identifier(name)
+    guard = prefix + "_GLYPHS_H"
+    out = []
+    out.append("// Generated by lcd_glyphc.py from %s. Do not edit." % os.path.basename(source))
+    out.append("")
+    out.append("#ifndef %s" % guard)
+    out.append("#define %s" % guard)
+    out.append("")
+    out.append('#include "lcd_glyph.hpp"')
+    out.append("")
+    out.append("enum {")
+    for glyph_name, _ in glyphs:
+        out.append("    %s_%s," % (prefix, identifier(glyph_name)))
+    out.append("    %s_COUNT" % prefix)
+    out.append("};")
+    out.append("")
+    out.append("constexpr auto %s = lcdGlyphSet(" % name)
+    for i, (glyph_name, rows) in enumerate(glyphs):
+        out.append("    // %s" % glyph_name)
+        art = ",\n".join('               "%s"' % row for row in rows).lstrip()
+        out.append("    lcdCharmap(%s)%s" % (art, "," if i < len(glyphs) - 1 else ");"))
+    out.append("")
+    out.append("#endif // %s" % guard)
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compiles glyph sources into a constexpr LCD glyph set.")
+    parser.add_argument("source", help="text art (.txt) or BDF font (.bdf)")
+    parser.add_argument("-o", "--output", help="header to write, standard output by default")
+    parser.add_argument("--name", default="glyphs", help="name of the glyph set, also the enum prefix")
+    parser.add_argument("--chars", default="", help="BDF glyphs to take, comma separated names or encodings")
+    args = parser.parse_args()
+
+    if not re.fullmatch(r"[A-Za-z_]\w*", args.name):
+        fail("--name must be a C++ identifier")
+    if args.source.lower().endswith(".bdf"):
+        chars = [c for c in args.chars.split(",") if c]
+        if not chars:
+            fail("--chars is required for BDF fonts")
+        glyphs = parse_bdf(args.source, chars)
+    else:
+        glyphs = parse_text(args.source)
+    if not glyphs:
+        fail("%s: no glyphs" % args.source)
+
+    header = emit(glyphs, args.source, args.name)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(header)
+    else:
+        sys.stdout.write(header)
+
+
+if __name__ == "__main__":
+    main()
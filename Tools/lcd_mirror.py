@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Shows the screen of a display mirrored by LCDMirror (see Inc/lcd_mirror.hpp).
+
+Reads the delta stream from a file, a pipe (standard input) or a serial port and prints
+the screen after every complete update. Custom characters are shown as the digits 0-7,
+their patterns are printed with --glyphs.
+
+Usage:
+
+  lcd_mirror.py capture.bin
+  lcd_mirror.py --port /dev/ttyUSB0 --baud 115200     # needs pyserial
+  some_pipe | lcd_mirror.py --last
+"""
+
+import argparse
+import sys
+
+SYNC = 0xA5
+
+# character ROM codes shown differently from ASCII (A00 ROM)
+SPECIAL = {0x5C: "¥", 0x7E: "→", 0x7F: "←", 0xDF: "°", 0xFF: "█"}
+
+
+class Screen:
+    def __init__(self):
+        self.cols = self.rows = 0
+        self.cells = []
+        self.cgram = [0] * 64
+        self.control = self.mode = 0
+        self.cursor = (0, 0)
+        self.valid = False
+        self.seq = None
+        self.updates = 0
+        self.errors = 0
+
+    def apply(self, kind, payload):
+        if kind == ord("G"):
+            self.cols, self.rows = payload[0], payload[1]
+            self.cells = [0x20] * (self.cols * self.rows)
+            self.cgram = [0] * 64
+            self.valid = True
+            return False
+        if not self.valid:
+            return False    # waiting for the next 'G' after a bad packet
+        if kind == ord("C"):
+            row, col = payload[0], payload[1]
+            start = row * self.cols + col
+            self.cells[start:start + len(payload) - 2] = payload[2:]
+        elif kind == ord("R"):
+            address = payload[0]
+            self.cgram[address:address + len(payload) - 1] = payload[1:]
+        elif kind == ord("M"):
+            self.control, self.mode = payload[0], payload[1]
+            self.cursor = (payload[2], payload[3])
+        elif kind == ord("E"):
+            self.seq = payload[0]
+            self.updates += 1
+            return True
+        return False
+
+    def render(self, glyphs=False):
+        lines = ["+" + "-" * self.cols + "+"]
+        on = self.control & 0x04
+        for y in range(self.rows):
+            text = ""
+            for code in self.cells[y * self.cols:(y + 1) * self.cols]:
+                if not on:
+                    text += " "
+                elif code < 16:
+                    text += str(code & 7)
+                elif code in SPECIAL:
+                    text += SPECIAL[code]
+                elif 0x20 <= code < 0x7F:
+                    text += chr(code)
+                else:
+                    text += "?"
+            lines.append("|" + text + "|")
+        lines.append("+" + "-" * self.cols + "+")
+        flags = []
+        if not on:
+            flags.append("display off")
+        if self.control & 0x02:
+            flags.append("cursor")
+        if self.control & 0x01:
+            flags.append("blink")
+        lines.append("update %d, cursor %d,%d %s" % (self.seq, self.cursor[0], self.cursor[1], " ".join(flags)))
+        if glyphs:
+            for row in range(8):
+                lines.append("  ".join(
+                    "".join("#" if self.cgram[8 * loc + row] & (0x10 >> x) else "." for x in range(5))
+                    for loc in range(8)))
+        return "\n".join(lines)
+
+
+def packets(read, screen):
+    """Yields (type, payload) of every packet with a good checksum."""
+    buf = bytearray()
+    while True:
+        data = read()
+        if not data:
+            return
+        buf += data
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                buf.clear()
+                break
+            del buf[:start]
+            if len(buf) < 3 or len(buf) < 4 + buf[2]:
+                break
+            n = buf[2]
+            if (sum(buf[1:3 + n]) & 0xFF) != buf[3 + n]:
+                screen.errors += 1
+                screen.valid = False
+                del buf[:1]         # resynchronize on the next sync byte
+                continue
+            yield buf[1], bytes(buf[3:3 + n])
+            del buf[:4 + n]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Shows a display mirrored by LCDMirror.")
+    parser.add_argument("source", nargs="?", help="capture file, standard input by default")
+    parser.add_argument("--port", help="serial port to read from")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--last", action="store_true", help="only print the screen at the end")
+    parser.add_argument("--glyphs", action="store_true", help="also print the custom characters")
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)   # blocks until data arrives
+        read = lambda: stream.read(max(1, stream.in_waiting))
+    else:
+        stream = open(args.source, "rb") if args.source else sys.stdin.buffer
+        read = lambda: stream.read1(256) if hasattr(stream, "read1") else stream.read(256)
+
+    screen = Screen()
+    shown = False
+    for kind, payload in packets(read, screen):
+        if screen.apply(kind, payload) and not args.last:
+            print(screen.render(args.glyphs), flush=True)
+            shown = True
+    if args.last and screen.updates:
+        print(screen.render(args.glyphs))
+    elif not shown:
+        print("no complete update received", file=sys.stderr)
+    if screen.errors:
+        print("%d bad packets" % screen.errors, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()